@@ -0,0 +1,453 @@
+/*
+ * _____________________________________________________________________________
+ *
+ * This program measures where the time of a page goes. It writes synthetic
+ * pages (netpbm images with "<image>.letters" sidecar files, see
+ * fake/KernelApi.h) and a to-find file into a working directory, runs the
+ * extractors over them one page after another, and reports the throughput
+ * (pages/s, glyphs/s) and the latency percentiles of every stage: load,
+ * preprocess, zone location, recognize, segmentation, crop export and
+ * metadata write.
+ *
+ * It is built against the stand-in engine ("make bench"), so the numbers
+ * are those of our own code; the engine stages only show the cost of
+ * reading the synthetic pages.
+ *
+ * Optional arguments:
+ *
+ *      -n N : number of pages (default 20)
+ *      -l L : letters per page (default 2000)
+ *      -w W : average word length (default 5)
+ *      -t T : number of to-find strings (default 100)
+ *      -x E : the extractor to run: all, strings, exact or every (default)
+ *      -d D : working directory, created if needed (default bench.tmp)
+ *      -m   : cut the bBoxes in memory and drop them instead of writing
+ *             TIFF files
+ *      -c   : cut the bBoxes in memory and write them with the crop sink
+ *             of -m in the extractors
+ *      -f F : the format of the bBox files: tiff (default), packbits, png,
+ *             or raw (with -c)
+ *      -E N : with -c, encode the bBoxes on N threads of their own
+ *      -s S : random seed (default 1)
+ *
+ * ____________________________________________________________________________
+ */
+
+
+#include "ocrBatch.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <random>
+#include <chrono>
+
+
+using namespace std;
+
+typedef chrono::steady_clock CLOCK;
+
+
+#define PAGE_WIDTH      2480    // A4 at 300 dpi
+#define PAGE_MARGIN     100
+#define LETTER_WIDTH    20
+#define LETTER_HEIGHT   28
+#define LETTER_STEP     24      // distance between letters of a line
+#define LINE_STEP       40      // distance between lines
+
+
+static const char *stageNames[N_STAGES] =
+{
+    "load", "preprocess", "zones", "recognize", "segmentation", "crops",
+    "write"
+};
+
+
+/*
+ * The settings of a benchmark run.
+ */
+struct BENCH_OPTIONS
+{
+    int nPages;
+    int nLetters;
+    int wordLength;
+    int nPatterns;
+    string extractor;
+    string directory;
+    bool inMemory;
+    bool cutFiles;
+    CROP_FORMAT cropFormat;
+    int nEncoders;
+    unsigned seed;
+};
+
+
+/*
+ * Writes one synthetic page: a black and white image with a box for every
+ * letter, and its sidecar letter file. The letters are random words of
+ * capital letters. Returns 0 on success.
+ *
+ * @param path: the image file to write
+ * @param options: the benchmark settings
+ * @param random: the random numbers to use
+ * @param text: set to the letters of the page
+ */
+static int writePage(string path, BENCH_OPTIONS &options, mt19937 &random,
+                     string &text)
+{
+    int perLine = (PAGE_WIDTH - 2 * PAGE_MARGIN) / LETTER_STEP;
+    int nLines = (options.nLetters + perLine - 1) / perLine;
+    int height = 2 * PAGE_MARGIN + nLines * LINE_STEP;
+    int bytesPerLine = (PAGE_WIDTH + 7) / 8;
+    vector<unsigned char> pixels((size_t) bytesPerLine * height, 0);
+    uniform_int_distribution<int> letterCode('A', 'Z');
+    uniform_int_distribution<int> length(1, 2 * options.wordLength - 1);
+    uniform_int_distribution<int> error(0, 120);
+
+    FILE *letters = fopen((path + ".letters").c_str(), "w");
+    if (letters == NULL)
+    {
+        printf("could not write %s.letters\n", path.c_str());
+        return 1;
+    }
+
+    text.clear();
+    int wordLeft = length(random);
+    for (int i = 0; i < options.nLetters; i++)
+    {
+        int left = PAGE_MARGIN + (i % perLine) * LETTER_STEP;
+        int top = PAGE_MARGIN + (i / perLine) * LINE_STEP;
+        int code = letterCode(random);
+        int makeup = 0;
+        int spaces = 0;
+
+        // a black box stands in for the glyph
+        for (int y = top; y < top + LETTER_HEIGHT; y++)
+        {
+            for (int x = left; x < left + LETTER_WIDTH; x++)
+            {
+                pixels[(size_t) y * bytesPerLine + x / 8] |= 0x80 >> (x % 8);
+            }
+        }
+
+        if (--wordLeft == 0 || i == options.nLetters - 1)
+        {
+            makeup |= R_ENDOFWORD;
+            spaces = 1;
+            wordLeft = length(random);
+        }
+        if (i % perLine == perLine - 1 || i == options.nLetters - 1)
+        {
+            makeup |= R_ENDOFLINE;
+        }
+        fprintf(letters, "%d %d %d %d %d %d %d %d\n", left, top, LETTER_WIDTH,
+                LETTER_HEIGHT, code, error(random), makeup, spaces);
+        text += (char) code;
+    }
+    fclose(letters);
+
+    FILE *image = fopen(path.c_str(), "wb");
+    if (image == NULL)
+    {
+        printf("could not write %s\n", path.c_str());
+        return 1;
+    }
+    fprintf(image, "P4\n%d %d\n", PAGE_WIDTH, height);
+    fwrite(&pixels[0], 1, pixels.size(), image);
+    fclose(image);
+    return 0;
+}
+
+
+/*
+ * Writes the synthetic pages, the image list and a to-find file. Half of
+ * the strings to find are taken from the pages, half are random.
+ * Returns 0 on success.
+ *
+ * @param options: the benchmark settings
+ * @param entries: set to the pages, with the to-find file
+ */
+static int writePages(BENCH_OPTIONS &options, vector<BATCH_ENTRY> &entries)
+{
+    mt19937 random(options.seed);
+    vector<string> texts(options.nPages);
+
+    for (int i = 0; i < options.nPages; i++)
+    {
+        BATCH_ENTRY entry;
+        entry.imageFile = "page-" + to_string(i) + ".pbm";
+        entry.findFile = "find.txt";
+        entry.pageNumber = 0;
+        entry.pageCount = 1;
+        entry.line = i;
+        if (writePage(entry.imageFile, options, random, texts[i]) != 0)
+        {
+            return 1;
+        }
+        entries.push_back(entry);
+    }
+
+    FILE *find = fopen("find.txt", "w");
+    if (find == NULL)
+    {
+        printf("could not write find.txt\n");
+        return 1;
+    }
+    uniform_int_distribution<int> page(0, options.nPages - 1);
+    uniform_int_distribution<int> length(3, 8);
+    uniform_int_distribution<int> letterCode('A', 'Z');
+    for (int p = 0; p < options.nPatterns; p++)
+    {
+        int n = length(random);
+        string pattern;
+        const string &text = texts[page(random)];
+        if (p % 2 == 0 && (int) text.size() > n)
+        {
+            uniform_int_distribution<int> start(0, text.size() - n);
+            pattern = text.substr(start(random), n);
+        }
+        else
+        {
+            for (int i = 0; i < n; i++)
+            {
+                pattern += (char) letterCode(random);
+            }
+        }
+        fprintf(find, "%s\n", pattern.c_str());
+    }
+    fclose(find);
+    return 0;
+}
+
+
+/*
+ * Returns the p-th percentile of the values (nearest rank).
+ *
+ * @param values: the values, sorted
+ * @param p: the percentile, 0 to 100
+ */
+static double percentile(const vector<double> &values, double p)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    size_t rank = (size_t) (p / 100.0 * values.size() + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    if (rank > values.size())
+    {
+        rank = values.size();
+    }
+    return values[rank - 1];
+}
+
+
+/*
+ * Runs one extractor over all pages and prints its throughput and the
+ * latency of every stage. Returns 0 if every page was processed.
+ *
+ * @param engine: the running engine session
+ * @param entries: the pages
+ * @param extractor: all, strings or exact
+ * @param options: the benchmark settings
+ */
+static int runExtractor(OCR_ENGINE &engine, vector<BATCH_ENTRY> &entries,
+                        string extractor, BENCH_OPTIONS &options)
+{
+    // the sinks append, so start from empty files
+    remove((extractor + ".letters.txt").c_str());
+    remove((extractor + ".words.txt").c_str());
+
+    OCR_SINK letterSink(extractor + ".letters.txt");
+    OCR_SINK wordSink(extractor + ".words.txt");
+    OUTPUT_SINKS sinks;
+    CROP_COUNTERS counters = {0, 0};
+    vector<PAGE_TIMES> times(entries.size());
+    int failed = 0;
+    FUZZY_OPTIONS exact;
+
+    sinks.letters = &letterSink;
+    sinks.words = &wordSink;
+    exact.maxEdits = 0;
+    exact.errWeight = 0;
+    if (options.inMemory)
+    {
+        sinks.crops = new CALLBACK_CROP_SINK(
+            [](const OCR_CROP &crop, string &ref)
+            {
+                ref = crop.name;
+                return 0;
+            });
+    }
+    else if (options.cutFiles)
+    {
+        sinks.crops = new FILE_CROP_SINK("", options.cropFormat,
+                                         options.nEncoders);
+    }
+
+    PAGE_ARENA arena;
+    CLOCK::time_point start = CLOCK::now();
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        PAGE_CONTEXT page;
+        page.useArena(arena);
+        page.sid = engine.getSID();
+        page.imageFile = entries[i].imageFile;
+        page.index = i;
+        page.namePrefix = extractor + "-";
+        page.counters = counters;
+        page.cropSink = sinks.crops;
+        page.cropFormat = options.cropFormat;
+        page.times = &times[i];
+
+        if (processPage(page, [&](PAGE_CONTEXT &p)
+                        {
+                            if (extractor == "all")
+                            {
+                                return exportAll(p, 2);
+                            }
+                            if (extractor == "strings")
+                            {
+                                return exportStrings(p, 2,
+                                                     entries[i].findFile,
+                                                     exact);
+                            }
+                            return exportExact(p, 2, entries[i].findFile,
+                                               exact);
+                        }) != 0)
+        {
+            failed++;
+        }
+        counters = page.counters;
+        appendPageRecords(page, sinks);
+    }
+    letterSink.flush();
+    wordSink.flush();
+    if (sinks.crops != NULL)
+    {
+        sinks.crops->flush();   // the encoders finish within the run time
+    }
+    double seconds = chrono::duration<double>(CLOCK::now() - start).count();
+    delete sinks.crops;
+
+    double glyphs = (double) options.nLetters * entries.size();
+    printf("\n%s: %d pages in %.3f s, %.1f pages/s, %.0f glyphs/s",
+           extractor.c_str(), (int) entries.size(), seconds,
+           entries.size() / seconds, glyphs / seconds);
+    if (failed > 0)
+    {
+        printf(", %d pages failed", failed);
+    }
+    printf("\n  %-13s %10s %10s %10s %10s %10s\n", "stage", "p50 ms",
+           "p90 ms", "p99 ms", "max ms", "total s");
+    for (int s = 0; s < N_STAGES; s++)
+    {
+        vector<double> values;
+        double total = 0;
+        for (size_t i = 0; i < times.size(); i++)
+        {
+            values.push_back(times[i].seconds[s] * 1000);
+            total += times[i].seconds[s];
+        }
+        sort(values.begin(), values.end());
+        printf("  %-13s %10.3f %10.3f %10.3f %10.3f %10.3f\n", stageNames[s],
+               percentile(values, 50), percentile(values, 90),
+               percentile(values, 99), percentile(values, 100), total);
+    }
+    return (failed == 0 ? 0 : 1);
+}
+
+
+/* Write the synthetic pages and time the extractors on them
+ */
+int main(int argc, char *argv[])
+{
+    BENCH_OPTIONS options;
+    string option;
+
+    options.nPages = 20;
+    options.nLetters = 2000;
+    options.wordLength = 5;
+    options.nPatterns = 100;
+    options.extractor = "every";
+    options.directory = "bench.tmp";
+    options.inMemory = false;
+    options.cutFiles = false;
+    options.cropFormat = CROP_TIFF;
+    options.nEncoders = 0;
+    options.seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        option = argv[i];
+        if (option == "-n" && i + 1 < argc) { options.nPages = atoi(argv[++i]); }
+        else if (option == "-l" && i + 1 < argc) { options.nLetters = atoi(argv[++i]); }
+        else if (option == "-w" && i + 1 < argc) { options.wordLength = atoi(argv[++i]); }
+        else if (option == "-t" && i + 1 < argc) { options.nPatterns = atoi(argv[++i]); }
+        else if (option == "-x" && i + 1 < argc) { options.extractor = argv[++i]; }
+        else if (option == "-d" && i + 1 < argc) { options.directory = argv[++i]; }
+        else if (option == "-m") { options.inMemory = true; }
+        else if (option == "-c") { options.cutFiles = true; }
+        else if (option == "-E" && i + 1 < argc) { options.nEncoders = atoi(argv[++i]); }
+        else if (option == "-f" && i + 1 < argc &&
+                 parseCropFormat(argv[i + 1], options.cropFormat) == 0) { i++; }
+        else if (option == "-s" && i + 1 < argc) { options.seed = atoi(argv[++i]); }
+        else
+        {
+            printf("ERROR, unknown option %s\n"
+                   "usage: benchmark [-n pages] [-l letters per page]"
+                   " [-w word length] [-t to-find strings]"
+                   " [-x all|strings|exact|every] [-d directory] [-m | -c]"
+                   " [-f tiff|packbits|png|raw] [-E encoders] [-s seed]\n",
+                   argv[i]);
+            return 1;
+        }
+    }
+    if (options.nPages < 1 || options.nLetters < 1 ||
+        options.wordLength < 1 || options.nPatterns < 0 ||
+        (options.extractor != "all" && options.extractor != "strings" &&
+         options.extractor != "exact" && options.extractor != "every") ||
+        (options.inMemory && options.cutFiles) || options.nEncoders < 0 ||
+        (options.nEncoders > 0 && !options.cutFiles) ||
+        (options.cropFormat == CROP_RAW && !options.cutFiles))
+    {
+        printf("ERROR, invalid benchmark settings\n");
+        return 1;
+    }
+
+    // the pages, the outputs and the bBox images all go to the directory
+    mkdir(options.directory.c_str(), 0777);
+    if (chdir(options.directory.c_str()) != 0)
+    {
+        printf("could not use directory %s\n", options.directory.c_str());
+        return 1;
+    }
+
+    vector<BATCH_ENTRY> entries;
+    printf("writing %d pages of %d letters...\n", options.nPages,
+           options.nLetters);
+    if (writePages(options, entries) != 0)
+    {
+        return 1;
+    }
+
+    OCR_ENGINE engine;
+    if (!engine.isReady())
+    {
+        printf("Unable to set up engine, quitting.\n");
+        return 1;
+    }
+
+    int err = 0;
+    const char *extractors[] = {"all", "strings", "exact"};
+    for (int e = 0; e < 3; e++)
+    {
+        if (options.extractor == "every" || options.extractor == extractors[e])
+        {
+            err |= runExtractor(engine, entries, extractors[e], options);
+        }
+    }
+    return err;
+}
@@ -0,0 +1,186 @@
+/*
+ * _____________________________________________________________________________
+ *
+ * This program runs several extractors over a list of images in one pass:
+ * every page is loaded and recognized once, and then all extractors of the
+ * manifest (extractAll, extractStrings, extractExact or extractRegions
+ * style) export from the same recognition result, each into its own output
+ * files.
+ *
+ * This program takes 2 command line argumerts:
+ *
+ * 1. file of image paths: paths to images should be listed in
+ *                         this file. The paths should be newline separated
+ *                         (every page of a multi-page TIFF or PDF is
+ *                         processed)
+ *
+ * 2. manifest:            the extractors to run, one per line:
+ *
+ *          all     <letter file> <word file> <-l|-w|-b>
+ *          strings <letter file> <word file> <-l|-w|-b> <to-find list>
+ *          exact   <letter file> <word file> <-l|-w|-b> <to-find list>
+ *          regions <letter file> <word file> <-l|-w|-b> <region list>
+ *
+ *                         a to-find list names the strings-to-find file of
+ *                         every image, a region list its region file, in
+ *                         the order of the image list
+ *
+ * Optional arguments can follow the required ones:
+ *
+ *      -j N : process the images on N worker threads
+ *      -p   : overlap loading, recognition and export in a pipeline
+ *      -q D : let each pipeline queue hold up to D pages
+ *      -g   : let the all and regions extractors find words from the
+ *             letter bBoxes (gaps, baselines, font height) instead of the
+ *             engine's word flags
+ *      -m D : cut the bBox images out of the page bitmap in memory and
+ *             write them to the directory D
+ *      -a P : cut the bBox images in memory and pack them into the archive
+ *             P-<k>.pack with the index P.idx
+ *      -f F : write the bBox images as tiff (default), packbits (packbits
+ *             TIFF), png, or raw (8-bit grayscale PGM, with -m only)
+ *      -t N : with -m, compress and write the bBox images on N threads of
+ *             their own
+ *      -u F : store equal bBox images once (with -m or -a); F maps every
+ *             image name to the image that holds its pixels
+ *      -d D : with -u, also treat images whose perceptual hashes differ in
+ *             at most D bits as equal (see ocrDedup.h)
+ *      -c D : keep the recognition results in the cache directory D, pages
+ *             recognized by an earlier run are not recognized again
+ *      -M F : count and time the run and write the metrics to F at the
+ *             end, as Prometheus text if F ends in ".prom", as JSON otherwise
+ *      -N N : with -M, write the metrics every N pages as well
+ *      -n F : also export every text line as a bBox image n-<k>, with its
+ *             records (image, name, line, error, bBox, text) in the file F
+ *      -z F : also export every recognized zone as a bBox image z-<k>, with
+ *             its records in the file F
+ *      -k K : let the strings and exact extractors also find strings that
+ *             are up to K edits away (fuzzy search)
+ *      -e W : with -k, substitutions on letters with error err cost
+ *             1 - W * err / 255 instead of 1
+ *
+ * The bBox images of all extractors are numbered together, so their names
+ * do not clash.
+ *
+ * ____________________________________________________________________________
+ */
+
+
+#include "ocrBatch.h"
+
+using namespace std;
+
+
+/* Run every extractor of the manifest for all files in the given fileList
+ */
+int main(int argc, char *argv[])
+{
+    string imageList;
+    string manifest;
+    RUN_OPTIONS options;
+
+    if (argc < 3)
+    {
+        printf("ERROR: requires 2 arguments:"
+               "\n  1.file of image paths list"
+               "\n  2.manifest of the extractors to run");
+        printRunOptions("jpqgmaftudcMNnzke");
+        return 1;
+    }
+    imageList = argv[1];
+    manifest = argv[2];
+
+    if (parseRunOptions(argc, argv, 3, options) != 0)
+    {
+        return 1;
+    }
+    if (!options.binaryPrefix.empty() || !options.journalPath.empty() ||
+        !options.tensorPrefix.empty())
+    {
+        printf("ERROR, -B, -r and -T cannot be used with a manifest\n");
+        return 1;
+    }
+
+    vector<BATCH_ENTRY> entries;
+    if (readBatchEntries(imageList, "", entries) != 0)
+    {
+        return 1;
+    }
+
+    vector<MANIFEST_ENTRY> extractors;
+    if (readManifest(manifest, imageList, extractors) != 0)
+    {
+        return 1;
+    }
+
+    // start the engine once, it shuts down when main returns
+    OCR_ENGINE engine;
+    if (!engine.isReady())
+    {
+        printf("Unable to set up engine, quitting.\n");
+        return 1;
+    }
+
+    // the extractors' output files and the sinks the options ask for
+    RUN_SINKS run;
+    if (openManifestSinks(engine, options, entries, extractors, run) != 0)
+    {
+        return 1;
+    }
+
+    // recognize each page once and run every extractor over the result
+    int failed = runBatch(engine, entries, run.sinks, options,
+        [&](PAGE_CONTEXT &page, const BATCH_ENTRY &entry)
+        {
+            int err = 0;
+
+            page.extractorRecords.resize(extractors.size());
+            for (size_t k = 0; k < extractors.size(); k++)
+            {
+                MANIFEST_ENTRY &extractor = extractors[k];
+                int rc;
+
+                if (extractor.extractor == "all")
+                {
+                    rc = exportAll(page, extractor.modeInt,
+                                   options.segmenter);
+                }
+                else if (extractor.extractor == "strings")
+                {
+                    rc = exportStrings(page, extractor.modeInt,
+                                       extractor.findFiles[entry.line],
+                                       options.fuzzy);
+                }
+                else if (extractor.extractor == "regions")
+                {
+                    rc = exportRegions(page, extractor.modeInt,
+                                       extractor.findFiles[entry.line],
+                                       options.segmenter);
+                }
+                else
+                {
+                    rc = exportExact(page, extractor.modeInt,
+                                     extractor.findFiles[entry.line],
+                                     options.fuzzy);
+                }
+                if (err == 0)
+                {
+                    err = rc;
+                }
+
+                // move the records out of the way of the next extractor
+                page.extractorRecords[k].letterRecords.swap(
+                    page.letterRecords);
+                page.extractorRecords[k].wordRecords.swap(
+                    page.wordRecords);
+            }
+            return err;
+        });
+
+    // the sinks write what they still hold when they are deleted on return
+    if (finishRunSinks(run) != 0)
+    {
+        return 1;
+    }
+    return failed != 0 ? 1 : 0;
+}
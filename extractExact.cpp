@@ -13,6 +13,8 @@
  *
  * 1. file of image paths: paths to images should be listed in
  *                         this file. The paths should be newline separated
+ *                         (every page of a multi-page TIFF or PDF is
+ *                         processed)
  *
  * 2. letter output file:  name of file to write the letter info to
  *
@@ -30,40 +32,72 @@
  *                              should be listed in the order corresponding
  *                              to the one in the image-paths file.
  *
+ * Optional arguments can follow the required ones:
+ *
+ *      -j N : process the images on N worker threads
+ *      -p   : overlap loading, recognition and export in a pipeline
+ *      -q D : let each pipeline queue hold up to D pages
+ *      -B P : write binary tables P.letters.bin, P.words.bin, P.images.txt
+ *             instead of the letter and word output files
+ *      -m D : cut the bBox images out of the page bitmap in memory and
+ *             write them to the directory D
+ *      -a P : cut the bBox images in memory and pack them into the archive
+ *             P-<k>.pack with the index P.idx
+ *      -f F : write the bBox images as tiff (default), packbits (packbits
+ *             TIFF), png, or raw (8-bit grayscale PGM, with -m only)
+ *      -t N : with -m, compress and write the bBox images on N threads of
+ *             their own
+ *      -u F : store equal bBox images once (with -m or -a); F maps every
+ *             image name to the image that holds its pixels
+ *      -d D : with -u, also treat images whose perceptual hashes differ in
+ *             at most D bits as equal (see ocrDedup.h)
+ *      -c D : keep the recognition results in the cache directory D, pages
+ *             recognized by an earlier run are not recognized again
+ *      -M F : count and time the run and write the metrics to F at the
+ *             end, as Prometheus text if F ends in ".prom", as JSON otherwise
+ *      -N N : with -M, write the metrics every N pages as well
+ *      -T P : also write every exported letter as an N x N tensor to
+ *             P.tensors.bin, with labels in P.labels.bin (see ocrTensor.h)
+ *      -S N : the size N of the -T tensors (default 32)
+ *      -n F : also export every text line as a bBox image n-<k>, with its
+ *             records (image, name, line, error, bBox, text) in the file F
+ *      -z F : also export every recognized zone as a bBox image z-<k>, with
+ *             its records in the file F
+ *      -r J : keep a checkpoint journal J; started again with the same
+ *             arguments, a stopped run goes on after the last page it finished
+ *             (not with -a, -u, -T, -n or -z)
+ *      -k K : also find strings that are up to K edits away (fuzzy search)
+ *      -e W : with -k, substitutions on letters with error err cost
+ *             1 - W * err / 255 instead of 1
+ *
  * ____________________________________________________________________________
  */
 
 
-#include "ocrExtraction.h"
+#include "ocrBatch.h"
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
-    RECERR rc;
-    int err;
-    
     string imageList;
     string findList;
     string outputFileLetter;
     string outputFileWord;
-    string imageIn;
-    string findIn;
 
     string mode;
     int modeInt;
+    RUN_OPTIONS options;
     
-    HPAGE  hPage;
-    
-    if (argc != 6)
+    if (argc < 6)
     {
         printf("ERROR: requires 5 arguments:"
                "\n  1.file of image paths list"
                "\n  2.output filename for letters"
                "\n  3.output filename for words"
                "\n  4. -l or -w or -b to print letters only, words only, or both"
-               "\n  5.file of to-find-strings paths list"
-               "\n");
+               "\n  5.file of to-find-strings paths list");
+        printRunOptions("jpqBmaftudcMNTSnzrke");
         return 1;
     }
     else
@@ -84,43 +118,47 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    string imgPathLine;
-    string findPathLine;
-    string findLine;
-    ifstream fileList(imageList); // open the file with the image paths
-    ifstream findFileList(findList);
+    if (parseRunOptions(argc, argv, 6, options) != 0)
+    {
+        return 1;
+    }
+
+    vector<BATCH_ENTRY> entries;
+    if (readBatchEntries(imageList, findList, entries) != 0)
+    {
+        return 1;
+    }
 
-    while (getline(fileList, imgPathLine))
+    // start the engine once, it shuts down when main returns
+    OCR_ENGINE engine;
+    if (!engine.isReady())
     {
-    	getline(findFileList, findPathLine);
-        imgPathLine.erase(remove(imgPathLine.begin(), imgPathLine.end(), '\n'),
-                          imgPathLine.end());
-        findPathLine.erase(remove(findPathLine.begin(), findPathLine.end(), '\n'),
-                          findPathLine.end());
+        printf("Unable to set up engine, quitting.\n");
+        return 1;
+    }
 
-        // set the current image and the current file of strings to find
-        imageIn = imgPathLine;
-        findIn = findPathLine;
+    // the output files and the sinks the options ask for
+    RUN_SINKS run;
+    if (openRunSinks(engine, options, entries, outputFileLetter,
+                     outputFileWord, run) != 0)
+    {
+        return 1;
+    }
 
-        err = setUp();
-        if (err != 0)
+    // Process each page for every string in its toFind file.
+    int failed = runBatch(engine, entries, run.sinks, options,
+        [&](PAGE_CONTEXT &page, const BATCH_ENTRY &entry)
         {
-            printf("Unable to set up engine, quitting.\n");
-            kRecQuit();
-            return 1;
-        }
-
-        // Process the page for every string in the toFind file.
-        printf("processing file: %s\n\n", imageIn.c_str());
-        extractExact(hPage, imageIn, outputFileLetter,
-                     outputFileWord, modeInt, findIn);
-     
-        
-       
+            printf("processing file: %s\n\n", entry.imageFile.c_str());
+            return exportExact(page, modeInt, entry.findFile,
+                               options.fuzzy);
+        });
 
-       
+    // the sinks write what they still hold when they are deleted on return
+    if (finishRunSinks(run) != 0)
+    {
+        return 1;
     }
-    
-    return 0;
+    return failed != 0 ? 1 : 0;
 }
 
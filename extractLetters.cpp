@@ -9,6 +9,8 @@
  *
  * 1. file of image paths: paths to images should be listed in
  *                         this file. The paths should be newline separated
+ *                         (every page of a multi-page TIFF or PDF is
+ *                         processed)
  *
  * 2. letter output file:  name of file to write the letter info to
  *
@@ -19,13 +21,50 @@
  *                              -w : export words only
  *                              -b : export both letters and words
  *
+ * Optional arguments can follow the required ones:
+ *
+ *      -j N : process the images on N worker threads
+ *      -p   : overlap loading, recognition and export in a pipeline
+ *      -q D : let each pipeline queue hold up to D pages
+ *      -g   : find the words from the letter bBoxes (gaps, baselines,
+ *             font height) instead of the engine's word flags
+ *      -B P : write binary tables P.letters.bin, P.words.bin, P.images.txt
+ *             instead of the letter and word output files
+ *      -m D : cut the bBox images out of the page bitmap in memory and
+ *             write them to the directory D
+ *      -a P : cut the bBox images in memory and pack them into the archive
+ *             P-<k>.pack with the index P.idx
+ *      -f F : write the bBox images as tiff (default), packbits (packbits
+ *             TIFF), png, or raw (8-bit grayscale PGM, with -m only)
+ *      -t N : with -m, compress and write the bBox images on N threads of
+ *             their own
+ *      -u F : store equal bBox images once (with -m or -a); F maps every
+ *             image name to the image that holds its pixels
+ *      -d D : with -u, also treat images whose perceptual hashes differ in
+ *             at most D bits as equal (see ocrDedup.h)
+ *      -c D : keep the recognition results in the cache directory D, pages
+ *             recognized by an earlier run are not recognized again
+ *      -M F : count and time the run and write the metrics to F at the
+ *             end, as Prometheus text if F ends in ".prom", as JSON otherwise
+ *      -N N : with -M, write the metrics every N pages as well
+ *      -T P : also write every exported letter as an N x N tensor to
+ *             P.tensors.bin, with labels in P.labels.bin (see ocrTensor.h)
+ *      -S N : the size N of the -T tensors (default 32)
+ *      -n F : also export every text line as a bBox image n-<k>, with its
+ *             records (image, name, line, error, bBox, text) in the file F
+ *      -z F : also export every recognized zone as a bBox image z-<k>, with
+ *             its records in the file F
+ *      -r J : keep a checkpoint journal J; started again with the same
+ *             arguments, a stopped run goes on after the last page it finished
+ *             (not with -a, -u, -T, -n or -z)
+ *
  * All letters/words recognized by the ocr for each image will be exported
  *
  * ____________________________________________________________________________
  */
  
 
-#include "ocrExtraction.h"
+#include "ocrBatch.h"
 
 using namespace std;
 
@@ -35,26 +74,21 @@ using namespace std;
 int main(int argc, char *argv[])
 {
     
-    RECERR rc;
-    int err;
-    
     string imageList;
     string outputFileLetter;
     string outputFileWord;
-    string imageIn;
     string mode;
     int modeInt;
+    RUN_OPTIONS options;
     
-    HPAGE  hPage;
-    
-    if (argc != 5)
+    if (argc < 5)
     {
         printf("ERROR: requires 4 arguments:"
                "\n  1.file of image paths list"
                "\n  2.output filename for letters"
                "\n  3.output filename for words"
-               "\n  4. -l or -w or -b to print letters only, words only, or both"
-               "\n");
+               "\n  4. -l or -w or -b to print letters only, words only, or both");
+        printRunOptions("jpqgBmaftudcMNTSnzr");
         return 1;
     }
     else
@@ -74,23 +108,49 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    string line;
-    ifstream fileList(imageList); // open the file with the image paths
-    while (getline(fileList, line))
+    if (parseRunOptions(argc, argv, 5, options) != 0)
+    {
+        return 1;
+    }
+    if (options.fuzzy.maxEdits > 0)
+    {
+        printf("ERROR, -k and -e only apply to string searches\n");
+        return 1;
+    }
+
+    vector<BATCH_ENTRY> entries;
+    if (readBatchEntries(imageList, "", entries) != 0)
+    {
+        return 1;
+    }
+
+    // start the engine once, it shuts down when main returns
+    OCR_ENGINE engine;
+    if (!engine.isReady())
     {
-        line.erase(remove(line.begin(), line.end(), '\n'),
-                          line.end());
-        imageIn = line;
-        err = setUp();
-        if (err != 0)
+        printf("Unable to set up engine, quitting.\n");
+        return 1;
+    }
+
+    // the output files and the sinks the options ask for
+    RUN_SINKS run;
+    if (openRunSinks(engine, options, entries, outputFileLetter,
+                     outputFileWord, run) != 0)
+    {
+        return 1;
+    }
+
+    // process each image file individually
+    int failed = runBatch(engine, entries, run.sinks, options,
+        [&](PAGE_CONTEXT &page, const BATCH_ENTRY &entry)
         {
-            printf("Unable to set up engine, quitting.\n");
-            kRecQuit();
-            return 1;
-        }
-        // process each image file individually
-        extractAll(hPage, imageIn, outputFileLetter, outputFileWord, modeInt);
+            return exportAll(page, modeInt, options.segmenter);
+        });
+
+    // the sinks write what they still hold when they are deleted on return
+    if (finishRunSinks(run) != 0)
+    {
+        return 1;
     }
-    
-    return 0;
+    return failed != 0 ? 1 : 0;
 }
@@ -0,0 +1,167 @@
+/*
+ * _____________________________________________________________________________
+ *
+ * This program lets the user specify a list of images and, for each
+ * image, the regions of interest (form fields, for example) to extract
+ * letters/words from. Only the words and letters that lie inside a region
+ * are exported; they are found with a spatial index of the page's letters
+ * instead of a pass over the page for every region.
+ *
+ * This program takes 5 command line argumerts:
+ *
+ * 1. file of image paths: paths to images should be listed in
+ *                         this file. The paths should be newline separated
+ *                         (every page of a multi-page TIFF or PDF is
+ *                         processed)
+ *
+ * 2. letter output file:  name of file to write the letter info to
+ *
+ * 3. word output file:    name of file to write the word info to
+ *
+ * 4. output mode:         the mode should be one of the following:
+ *                              -l : export letters only
+ *                              -w : export words only
+ *                              -b : export both letters and words
+ *
+ * 5. file of region filepaths: each image must have its own region file,
+ *                              one region per line as
+ *                              "<left> <top> <right> <bottom>" in pixels
+ *                              of the preprocessed page (see ocrSpatial.h).
+ *                              The paths to these files should be listed in
+ *                              the order corresponding to the one in the
+ *                              image-paths file.
+ *
+ * Optional arguments can follow the required ones:
+ *
+ *      -j N : process the images on N worker threads
+ *      -p   : overlap loading, recognition and export in a pipeline
+ *      -q D : let each pipeline queue hold up to D pages
+ *      -g   : find the words from the letter bBoxes (gaps, baselines,
+ *             font height) instead of the engine's word flags
+ *      -B P : write binary tables P.letters.bin, P.words.bin, P.images.txt
+ *             instead of the letter and word output files
+ *      -m D : cut the bBox images out of the page bitmap in memory and
+ *             write them to the directory D
+ *      -a P : cut the bBox images in memory and pack them into the archive
+ *             P-<k>.pack with the index P.idx
+ *      -f F : write the bBox images as tiff (default), packbits (packbits
+ *             TIFF), png, or raw (8-bit grayscale PGM, with -m only)
+ *      -t N : with -m, compress and write the bBox images on N threads of
+ *             their own
+ *      -u F : store equal bBox images once (with -m or -a); F maps every
+ *             image name to the image that holds its pixels
+ *      -d D : with -u, also treat images whose perceptual hashes differ in
+ *             at most D bits as equal (see ocrDedup.h)
+ *      -c D : keep the recognition results in the cache directory D, pages
+ *             recognized by an earlier run are not recognized again
+ *      -M F : count and time the run and write the metrics to F at the
+ *             end, as Prometheus text if F ends in ".prom", as JSON otherwise
+ *      -N N : with -M, write the metrics every N pages as well
+ *      -T P : also write every exported letter as an N x N tensor to
+ *             P.tensors.bin, with labels in P.labels.bin (see ocrTensor.h)
+ *      -S N : the size N of the -T tensors (default 32)
+ *      -n F : also export every text line as a bBox image n-<k>, with its
+ *             records (image, name, line, error, bBox, text) in the file F
+ *      -z F : also export every recognized zone as a bBox image z-<k>, with
+ *             its records in the file F
+ *      -r J : keep a checkpoint journal J; started again with the same
+ *             arguments, a stopped run goes on after the last page it finished
+ *             (not with -a, -u, -T, -n or -z)
+ *
+ * ____________________________________________________________________________
+ */
+
+
+#include "ocrBatch.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    string imageList;
+    string regionList;
+    string outputFileLetter;
+    string outputFileWord;
+
+    string mode;
+    int modeInt;
+    RUN_OPTIONS options;
+    
+    if (argc < 6)
+    {
+        printf("ERROR: requires 5 arguments:"
+               "\n  1.file of image paths list"
+               "\n  2.output filename for letters"
+               "\n  3.output filename for words"
+               "\n  4. -l or -w or -b to print letters only, words only, or both"
+               "\n  5.file of region file paths list");
+        printRunOptions("jpqgBmaftudcMNTSnzr");
+        return 1;
+    }
+    else
+    {
+        imageList = argv[1];
+        outputFileLetter = argv[2];
+        outputFileWord = argv[3];
+        mode = argv[4];
+        regionList = argv[5];
+    }
+    
+    if (mode == "-l") { modeInt = 0; }
+    else if (mode == "-w") { modeInt = 1; }
+    else if (mode == "-b") { modeInt = 2; }
+    else 
+    { 
+        printf("ERROR, modes can only be -l, -w, or -b\n");
+        return 1;
+    }
+
+    if (parseRunOptions(argc, argv, 6, options) != 0)
+    {
+        return 1;
+    }
+    if (options.fuzzy.maxEdits > 0)
+    {
+        printf("ERROR, -k and -e only apply to string searches\n");
+        return 1;
+    }
+
+    vector<BATCH_ENTRY> entries;
+    if (readBatchEntries(imageList, regionList, entries) != 0)
+    {
+        return 1;
+    }
+
+    // start the engine once, it shuts down when main returns
+    OCR_ENGINE engine;
+    if (!engine.isReady())
+    {
+        printf("Unable to set up engine, quitting.\n");
+        return 1;
+    }
+
+    // the output files and the sinks the options ask for
+    RUN_SINKS run;
+    if (openRunSinks(engine, options, entries, outputFileLetter,
+                     outputFileWord, run) != 0)
+    {
+        return 1;
+    }
+
+    // set the current image and its region file, then process the page
+    int failed = runBatch(engine, entries, run.sinks, options,
+        [&](PAGE_CONTEXT &page, const BATCH_ENTRY &entry)
+        {
+            printf("processing file: %s\n\n", entry.imageFile.c_str());
+            return exportRegions(page, modeInt, entry.findFile,
+                                 options.segmenter);
+        });
+
+    // the sinks write what they still hold when they are deleted on return
+    if (finishRunSinks(run) != 0)
+    {
+        return 1;
+    }
+    return failed != 0 ? 1 : 0;
+}
+
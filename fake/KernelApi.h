@@ -0,0 +1,180 @@
+/*
+ * _____________________________________________________________________________
+ * A stand-in for the KernelApi.h of the OmniPage Capture SDK
+ *
+ * This header declares the part of the KernelApi that the extraction tools
+ * use, with a local implementation in fakeKernelApi.cpp, so the tools can
+ * be built and run without the SDK runtime or a license ("make fake"). It
+ * is for profiling and testing our own code; nothing is recognized:
+ *
+ *  - images are binary netpbm files (P4 black and white, P5 gray, P6
+ *    color). A file can hold several images one after the other, which are
+ *    its pages.
+ *  - the recognition result of an image is read from the sidecar file
+ *    "<image>.letters": one letter per line,
+ *
+ *          <left> <top> <width> <height> <code> <err> <makeup> <spaces>
+ *
+ *    (integers, 0x for hex, so 0x41 is 'A'). A line "page <n>" starts the
+ *    letters of page n; lines before the first one belong to page 0. Empty
+ *    lines and lines starting with '#' are skipped.
+ *  - bBoxes are cut out of the image in memory and written as packbits
+ *    TIFF for FF_TIFPB, PNG for FF_PNG and uncompressed TIFF for any other
+ *    format.
+ *
+ * Only the names the tools use are declared; the types follow the SDK's
+ * layout closely enough for our code, not byte for byte.
+ * ____________________________________________________________________________
+ */
+
+#ifndef FAKE_KERNELAPI_H
+#define FAKE_KERNELAPI_H
+
+#include <stddef.h>
+
+
+typedef int RECERR;
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned int DWORD;
+typedef unsigned short WCHAR;
+typedef BYTE *LPBYTE;
+
+#define TRUE    1
+#define FALSE   0
+
+// return codes
+#define REC_OK                      0
+#define API_INIT_WARN               0x00010001
+#define API_LICENSEVALIDATION_WARN  0x00010002
+#define NO_TXT_WARN                 0x00010003
+#define FAKE_FILE_ERR               0x00020001  // file missing or unreadable
+#define FAKE_FORMAT_ERR             0x00020002  // not a supported netpbm file
+#define FAKE_PAGE_ERR               0x00020003  // no such page in the file
+#define FAKE_PARAM_ERR              0x00020004  // bad handle or argument
+#define FAKE_MEMORY_ERR             0x00020005
+
+// LETTER.makeup flags
+#define R_ENDOFWORD     0x0001
+#define R_ENDOFLINE     0x0002
+#define R_ENDOFPARA     0x0004
+#define R_ENDOFZONE     0x0008
+
+// kRecOpenImgFile modes
+#define IMGF_READ       0
+
+typedef struct FAKE_PAGE *HPAGE;
+typedef struct FAKE_IMGFILE *HIMGFILE;
+
+typedef struct
+{
+    long cx;
+    long cy;
+} SIZE;
+
+typedef struct
+{
+    long left;
+    long top;
+    long right;
+    long bottom;
+} RECT;
+
+typedef const RECT *LPCRECT;
+
+typedef struct
+{
+    SIZE Size;                  // in pixels
+    SIZE DPI;
+    WORD BitsPerPixel;          // 1, 8 or 24
+    WORD BytesPerLine;          // rows are padded to 4 bytes
+    BOOL IsPalette;
+} IMG_INFO;
+
+typedef struct
+{
+    BYTE spcCount;              // spaces after the letter
+} SPCINFO;
+
+typedef struct
+{
+    WORD left;
+    WORD top;
+    WORD width;
+    WORD height;
+    WORD zone;
+    WCHAR code;
+    BYTE err;
+    DWORD makeup;
+    SPCINFO spcInfo;
+} LETTER;
+
+typedef enum
+{
+    II_UNDEFINED = -1,
+    II_CURRENT = 0,
+    II_ORIGINAL
+} IMAGEINDEX;
+
+typedef enum
+{
+    FF_TIFNO,
+    FF_TIFPB,
+    FF_TIFHU,
+    FF_TIFLZW,
+    FF_PNG,
+    FF_GIF,
+    FF_TIFJPGNEW
+} IMF_FORMAT;
+
+typedef enum
+{
+    RM_AUTO,
+    RM_OMNIFONT_PLUS3W
+} RECOGNITIONMODULE;
+
+typedef enum
+{
+    DTXT_TXTS
+} DTXTOUTPUTFORMATS;
+
+
+// engine
+RECERR kRecSetLicense(const char *licenseFile, const char *oemCode);
+RECERR kRecInit(const char *company, const char *product);
+RECERR kRecQuit();
+
+// settings
+RECERR kRecSetDefaults(int sid);
+RECERR kRecSetDefaultRecognitionModule(int sid, RECOGNITIONMODULE module);
+RECERR kRecGetDefaultRecognitionModule(int sid, RECOGNITIONMODULE *module);
+RECERR kRecSetDTXTFormat(int sid, DTXTOUTPUTFORMATS format);
+RECERR kRecCreateSettingsCollection(int *sid);
+RECERR kRecDeleteSettingsCollection(int sid);
+
+// image files and pages
+RECERR kRecOpenImgFile(const char *fileName, HIMGFILE *hFile, int mode,
+                       IMF_FORMAT format);
+RECERR kRecGetImgFilePageCount(HIMGFILE hFile, int *nPages);
+RECERR kRecCloseImgFile(HIMGFILE hFile);
+RECERR kRecLoadImgF(int sid, const char *fileName, HPAGE *hPage, int page);
+RECERR kRecFreeImg(HPAGE hPage);
+RECERR kRecGetImgInfo(int sid, HPAGE hPage, IMAGEINDEX index, IMG_INFO *info);
+RECERR kRecGetImgArea(int sid, HPAGE hPage, IMAGEINDEX index, LPCRECT rect,
+                      IMG_INFO *info, LPBYTE *bitmap);
+RECERR kRecSaveImgAreaF(int sid, const char *fileName, IMF_FORMAT format,
+                        HPAGE hPage, IMAGEINDEX index, const RECT *rect,
+                        BOOL append);
+
+// recognition
+RECERR kRecPreprocessImg(int sid, HPAGE hPage);
+RECERR kRecLocateZones(int sid, HPAGE hPage);
+RECERR kRecRecognize(int sid, HPAGE hPage, void *reserved);
+RECERR kRecGetLetters(HPAGE hPage, IMAGEINDEX index, LETTER **letters,
+                      int *nLetters);
+
+// memory handed out by the calls above
+RECERR kRecFree(void *memory);
+
+#endif
@@ -0,0 +1,561 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for the stand-in KernelApi.h
+ *
+ * Pages are netpbm images held in memory, "recognition" reads the sidecar
+ * letter file, and bBoxes are cut with cutCrop() and written with
+ * encodeCrop(), the same code the -m crop sink uses. All calls are
+ * thread-safe as long as a page is used by one thread at a time, like with
+ * the real engine.
+ * ____________________________________________________________________________
+ */
+
+#include "KernelApi.h"
+#include "../ocrCrop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+
+using namespace std;
+
+
+#define FAKE_DPI    300     // netpbm files have no resolution
+
+
+/*
+ * A loaded page: the image and, once recognized, its letters.
+ */
+struct FAKE_PAGE
+{
+    string fileName;
+    int pageNumber;
+    IMG_INFO info;
+    vector<BYTE> pixels;        // info.BytesPerLine * info.Size.cy bytes
+    vector<LETTER> letters;
+};
+
+
+/*
+ * An opened image file.
+ */
+struct FAKE_IMGFILE
+{
+    int nPages;
+};
+
+
+// the recognition module of every settings collection
+static map<int, RECOGNITIONMODULE> modules;
+static int nextSID = 1;
+static mutex settingsLock;
+
+
+/*
+ * Reads a decimal number of a netpbm header, skipping white space and
+ * comments before it. The white space character after the number is read
+ * as well. Returns false if there is no number.
+ *
+ * @param in: the image file
+ * @param value: set to the number
+ */
+static bool readNumber(FILE *in, long &value)
+{
+    int c = fgetc(in);
+
+    while (c == '#' || (c != EOF && isspace(c)))
+    {
+        if (c == '#')
+        {
+            while (c != EOF && c != '\n')
+            {
+                c = fgetc(in);
+            }
+        }
+        c = fgetc(in);
+    }
+    if (c == EOF || !isdigit(c))
+    {
+        return false;
+    }
+
+    value = 0;
+    while (c != EOF && isdigit(c))
+    {
+        value = value * 10 + (c - '0');
+        c = fgetc(in);
+    }
+    return true;
+}
+
+
+/*
+ * Reads the next image of a netpbm file (P4, P5 or P6). Returns REC_OK,
+ * FAKE_PAGE_ERR if there is no further image, or FAKE_FORMAT_ERR.
+ *
+ * @param in: the image file, at the start of an image
+ * @param info: set to the size and layout of the image
+ * @param pixels: set to the rows of the image, or NULL to skip them
+ */
+static RECERR readImage(FILE *in, IMG_INFO &info, vector<BYTE> *pixels)
+{
+    int c;
+    long width, height, maxValue = 1;
+
+    do
+    {
+        c = fgetc(in);
+    } while (c != EOF && isspace(c));
+    if (c == EOF)
+    {
+        return FAKE_PAGE_ERR;
+    }
+
+    int kind = fgetc(in);
+    if (c != 'P' || (kind != '4' && kind != '5' && kind != '6'))
+    {
+        return FAKE_FORMAT_ERR;
+    }
+    if (!readNumber(in, width) || !readNumber(in, height) ||
+        (kind != '4' && !readNumber(in, maxValue)) ||
+        width <= 0 || height <= 0 || width > 65535 || height > 65535 ||
+        maxValue <= 0 || maxValue > 255)
+    {
+        return FAKE_FORMAT_ERR;
+    }
+
+    memset(&info, 0, sizeof(info));
+    info.Size.cx = width;
+    info.Size.cy = height;
+    info.DPI.cx = FAKE_DPI;
+    info.DPI.cy = FAKE_DPI;
+    info.BitsPerPixel = (kind == '4' ? 1 : kind == '5' ? 8 : 24);
+    info.IsPalette = FALSE;
+
+    size_t rowBytes = (width * info.BitsPerPixel + 7) / 8;
+    info.BytesPerLine = (rowBytes + 3) & ~(size_t) 3;
+    if (info.BytesPerLine < rowBytes)
+    {
+        return FAKE_FORMAT_ERR;
+    }
+
+    if (pixels == NULL)
+    {
+        return (fseek(in, rowBytes * height, SEEK_CUR) == 0 ? REC_OK
+                                                            : FAKE_FORMAT_ERR);
+    }
+    pixels->assign((size_t) info.BytesPerLine * height, 0);
+    for (long y = 0; y < height; y++)
+    {
+        if (fread(&(*pixels)[y * info.BytesPerLine], 1, rowBytes, in) !=
+            rowBytes)
+        {
+            return FAKE_FORMAT_ERR;
+        }
+    }
+    return REC_OK;
+}
+
+
+/*
+ * Reads the letters of one page from the sidecar file "<image>.letters".
+ * Returns REC_OK, or FAKE_FILE_ERR / FAKE_FORMAT_ERR.
+ *
+ * @param fileName: the image file
+ * @param pageNumber: the page whose letters are read
+ * @param letters: set to the letters of the page
+ */
+static RECERR readLetters(const string &fileName, int pageNumber,
+                          vector<LETTER> &letters)
+{
+    string sidecar = fileName + ".letters";
+    FILE *in = fopen(sidecar.c_str(), "r");
+    char line[512];
+    int page = 0;
+    int lineNumber = 0;
+
+    letters.clear();
+    if (in == NULL)
+    {
+        printf("fake engine: no sidecar file %s\n", sidecar.c_str());
+        return FAKE_FILE_ERR;
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        long values[9];
+        char *next = line;
+        int n = 0;
+
+        lineNumber++;
+        while (isspace((unsigned char) *next))
+        {
+            next++;
+        }
+        if (*next == '\0' || *next == '#')
+        {
+            continue;
+        }
+        if (strncmp(next, "page", 4) == 0)
+        {
+            page = atoi(next + 4);
+            continue;
+        }
+
+        while (n < 9)
+        {
+            char *end;
+            values[n] = strtol(next, &end, 0);
+            if (end == next)
+            {
+                break;
+            }
+            next = end;
+            n++;
+        }
+        if (n < 8)
+        {
+            printf("fake engine: %s line %d is not a letter\n",
+                   sidecar.c_str(), lineNumber);
+            fclose(in);
+            return FAKE_FORMAT_ERR;
+        }
+        if (page != pageNumber)
+        {
+            continue;
+        }
+
+        LETTER letter;
+        memset(&letter, 0, sizeof(letter));
+        letter.left = values[0];
+        letter.top = values[1];
+        letter.width = values[2];
+        letter.height = values[3];
+        letter.code = values[4];
+        letter.err = values[5];
+        letter.makeup = values[6];
+        letter.spcInfo.spcCount = values[7];
+        letter.zone = (n == 9 ? values[8] : 0);
+        letters.push_back(letter);
+    }
+    fclose(in);
+    return REC_OK;
+}
+
+
+RECERR kRecSetLicense(const char *licenseFile, const char *oemCode)
+{
+    return REC_OK;
+}
+
+
+RECERR kRecInit(const char *company, const char *product)
+{
+    return REC_OK;
+}
+
+
+RECERR kRecQuit()
+{
+    return REC_OK;
+}
+
+
+RECERR kRecSetDefaults(int sid)
+{
+    lock_guard<mutex> guard(settingsLock);
+
+    modules[sid] = RM_AUTO;
+    return REC_OK;
+}
+
+
+RECERR kRecSetDefaultRecognitionModule(int sid, RECOGNITIONMODULE module)
+{
+    lock_guard<mutex> guard(settingsLock);
+
+    modules[sid] = module;
+    return REC_OK;
+}
+
+
+RECERR kRecGetDefaultRecognitionModule(int sid, RECOGNITIONMODULE *module)
+{
+    lock_guard<mutex> guard(settingsLock);
+
+    if (module == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    *module = (modules.count(sid) != 0 ? modules[sid] : RM_AUTO);
+    return REC_OK;
+}
+
+
+RECERR kRecSetDTXTFormat(int sid, DTXTOUTPUTFORMATS format)
+{
+    return REC_OK;
+}
+
+
+RECERR kRecCreateSettingsCollection(int *sid)
+{
+    lock_guard<mutex> guard(settingsLock);
+
+    if (sid == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    *sid = nextSID++;
+    modules[*sid] = RM_AUTO;
+    return REC_OK;
+}
+
+
+RECERR kRecDeleteSettingsCollection(int sid)
+{
+    lock_guard<mutex> guard(settingsLock);
+
+    modules.erase(sid);
+    return REC_OK;
+}
+
+
+RECERR kRecOpenImgFile(const char *fileName, HIMGFILE *hFile, int mode,
+                       IMF_FORMAT format)
+{
+    IMG_INFO info;
+    RECERR rc;
+    int nPages = 0;
+
+    if (fileName == NULL || hFile == NULL || mode != IMGF_READ)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    FILE *in = fopen(fileName, "rb");
+    if (in == NULL)
+    {
+        return FAKE_FILE_ERR;
+    }
+    while ((rc = readImage(in, info, NULL)) == REC_OK)
+    {
+        nPages++;
+    }
+    fclose(in);
+    if (rc != FAKE_PAGE_ERR || nPages == 0)
+    {
+        return FAKE_FORMAT_ERR;
+    }
+
+    *hFile = new FAKE_IMGFILE;
+    (*hFile)->nPages = nPages;
+    return REC_OK;
+}
+
+
+RECERR kRecGetImgFilePageCount(HIMGFILE hFile, int *nPages)
+{
+    if (hFile == NULL || nPages == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    *nPages = hFile->nPages;
+    return REC_OK;
+}
+
+
+RECERR kRecCloseImgFile(HIMGFILE hFile)
+{
+    delete hFile;
+    return REC_OK;
+}
+
+
+RECERR kRecLoadImgF(int sid, const char *fileName, HPAGE *hPage, int page)
+{
+    RECERR rc = REC_OK;
+
+    if (fileName == NULL || hPage == NULL || page < 0)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    FILE *in = fopen(fileName, "rb");
+    if (in == NULL)
+    {
+        return FAKE_FILE_ERR;
+    }
+
+    FAKE_PAGE *loaded = new FAKE_PAGE;
+    loaded->fileName = fileName;
+    loaded->pageNumber = page;
+    for (int p = 0; p <= page && rc == REC_OK; p++)
+    {
+        rc = readImage(in, loaded->info, (p == page ? &loaded->pixels : NULL));
+    }
+    fclose(in);
+
+    if (rc != REC_OK)
+    {
+        delete loaded;
+        return rc;
+    }
+    *hPage = loaded;
+    return REC_OK;
+}
+
+
+RECERR kRecFreeImg(HPAGE hPage)
+{
+    delete hPage;
+    return REC_OK;
+}
+
+
+RECERR kRecGetImgInfo(int sid, HPAGE hPage, IMAGEINDEX index, IMG_INFO *info)
+{
+    if (hPage == NULL || info == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    *info = hPage->info;
+    return REC_OK;
+}
+
+
+RECERR kRecGetImgArea(int sid, HPAGE hPage, IMAGEINDEX index, LPCRECT rect,
+                      IMG_INFO *info, LPBYTE *bitmap)
+{
+    if (hPage == NULL || info == NULL || bitmap == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+
+    const BYTE *source = &hPage->pixels[0];
+    size_t bytes = hPage->pixels.size();
+    OCR_CROP crop;
+
+    *info = hPage->info;
+    if (rect != NULL)
+    {
+        if (cutCrop(&hPage->pixels[0], hPage->info, *rect, crop) != 0)
+        {
+            return FAKE_PARAM_ERR;
+        }
+        info->Size.cx = crop.width;
+        info->Size.cy = crop.height;
+        info->BytesPerLine = crop.bytesPerLine;
+        source = &crop.pixels[0];
+        bytes = crop.pixels.size();
+    }
+
+    *bitmap = (LPBYTE) malloc(bytes);
+    if (*bitmap == NULL)
+    {
+        return FAKE_MEMORY_ERR;
+    }
+    memcpy(*bitmap, source, bytes);
+    return REC_OK;
+}
+
+
+RECERR kRecSaveImgAreaF(int sid, const char *fileName, IMF_FORMAT format,
+                        HPAGE hPage, IMAGEINDEX index, const RECT *rect,
+                        BOOL append)
+{
+    OCR_CROP crop;
+    string data;
+    CROP_FORMAT cropFormat = CROP_TIFF;
+
+    if (hPage == NULL || fileName == NULL || rect == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    if (format == FF_TIFPB)
+    {
+        cropFormat = CROP_TIFF_PACKBITS;
+    }
+    else if (format == FF_PNG)
+    {
+        cropFormat = CROP_PNG;
+    }
+    if (cutCrop(&hPage->pixels[0], hPage->info, *rect, crop) != 0 ||
+        encodeCrop(crop, cropFormat, data) != 0)
+    {
+        return FAKE_PARAM_ERR;
+    }
+
+    FILE *out = fopen(fileName, "wb");
+    if (out == NULL)
+    {
+        return FAKE_FILE_ERR;
+    }
+    bool ok = (fwrite(data.data(), 1, data.size(), out) == data.size());
+    if (fclose(out) != 0 || !ok)
+    {
+        return FAKE_FILE_ERR;
+    }
+    return REC_OK;
+}
+
+
+RECERR kRecPreprocessImg(int sid, HPAGE hPage)
+{
+    return (hPage == NULL ? FAKE_PARAM_ERR : REC_OK);
+}
+
+
+RECERR kRecLocateZones(int sid, HPAGE hPage)
+{
+    return (hPage == NULL ? FAKE_PARAM_ERR : REC_OK);
+}
+
+
+RECERR kRecRecognize(int sid, HPAGE hPage, void *reserved)
+{
+    if (hPage == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+    RECERR rc = readLetters(hPage->fileName, hPage->pageNumber,
+                            hPage->letters);
+    if (rc != REC_OK)
+    {
+        return rc;
+    }
+    return (hPage->letters.empty() ? NO_TXT_WARN : REC_OK);
+}
+
+
+RECERR kRecGetLetters(HPAGE hPage, IMAGEINDEX index, LETTER **letters,
+                      int *nLetters)
+{
+    if (hPage == NULL || letters == NULL || nLetters == NULL)
+    {
+        return FAKE_PARAM_ERR;
+    }
+
+    *nLetters = hPage->letters.size();
+    *letters = NULL;
+    if (*nLetters > 0)
+    {
+        *letters = (LETTER *) malloc(sizeof(LETTER) * *nLetters);
+        if (*letters == NULL)
+        {
+            return FAKE_MEMORY_ERR;
+        }
+        memcpy(*letters, &hPage->letters[0], sizeof(LETTER) * *nLetters);
+    }
+    return REC_OK;
+}
+
+
+RECERR kRecFree(void *memory)
+{
+    free(memory);
+    return REC_OK;
+}
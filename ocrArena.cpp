@@ -0,0 +1,157 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrArena.h
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrArena.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+using namespace std;
+
+
+PATH_TABLE imagePaths;
+
+
+/*
+ * PAGE_ARENA constructor
+ *
+ * @param blockBytes: the size of the blocks the arena hands out
+ */
+PAGE_ARENA::PAGE_ARENA(size_t blockBytes)
+{
+    blockSize = blockBytes;
+    current = 0;
+    used = 0;
+    total = 0;
+}
+
+
+/*
+ * Returns bytes of memory aligned to align, from the current block if it
+ * has room, otherwise from the next block. Requests larger than a block
+ * get their own allocation.
+ *
+ * @param bytes: the size of the memory
+ * @param align: the alignment of the memory, a power of two
+ */
+void *PAGE_ARENA::allocate(size_t bytes, size_t align)
+{
+    total += bytes;
+    if (bytes + align > blockSize)
+    {
+        char *memory = (char *) malloc(bytes);
+        if (memory == NULL)
+        {
+            throw bad_alloc();
+        }
+        large.push_back(memory);
+        return memory;
+    }
+
+    while (true)
+    {
+        if (current < blocks.size())
+        {
+            uintptr_t base = (uintptr_t) blocks[current];
+            uintptr_t next = (base + used + align - 1) & ~(uintptr_t) (align - 1);
+            size_t offset = next - base;
+            if (offset + bytes <= blockSize)
+            {
+                used = offset + bytes;
+                return blocks[current] + offset;
+            }
+            // the block is full, go on with the next one
+            current++;
+            used = 0;
+            continue;
+        }
+
+        char *block = (char *) malloc(blockSize);
+        if (block == NULL)
+        {
+            throw bad_alloc();
+        }
+        blocks.push_back(block);
+    }
+}
+
+
+/*
+ * Copies a string into the arena.
+ *
+ * @param text: the string to copy
+ */
+const char *PAGE_ARENA::copyString(const string &text)
+{
+    char *copy = createArray<char>(text.size() + 1);
+    memcpy(copy, text.c_str(), text.size() + 1);
+    return copy;
+}
+
+
+/*
+ * Drops every object in the arena. The blocks are kept, large allocations
+ * are freed.
+ */
+void PAGE_ARENA::reset()
+{
+    for (size_t i = 0; i < large.size(); i++)
+    {
+        free(large[i]);
+    }
+    large.clear();
+    current = 0;
+    used = 0;
+    total = 0;
+}
+
+
+/*
+ * PAGE_ARENA destructor
+ */
+PAGE_ARENA::~PAGE_ARENA()
+{
+    reset();
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        free(blocks[i]);
+    }
+}
+
+
+/*
+ * Returns the id of the string, adding it to the table if it is new.
+ *
+ * @param path: the string to intern
+ */
+uint32_t PATH_TABLE::intern(const string &path)
+{
+    lock_guard<mutex> guard(lock);
+
+    map<string, uint32_t>::iterator it = ids.find(path);
+    if (it != ids.end())
+    {
+        return it->second;
+    }
+    uint32_t id = paths.size();
+    paths.push_back(path);
+    ids.insert(make_pair(path, id));
+    return id;
+}
+
+
+/*
+ * Returns the string with the given id.
+ *
+ * @param id: an id returned by intern()
+ */
+const string &PATH_TABLE::get(uint32_t id)
+{
+    lock_guard<mutex> guard(lock);
+
+    return paths[id];
+}
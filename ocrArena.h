@@ -0,0 +1,118 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrArena.cpp program
+ *
+ * A page creates one OCR_LETTER per recognized glyph and one OCR_WORD per
+ * word. Instead of a heap allocation per object, they are carved out of an
+ * arena: a few large blocks that are handed out front to back and reset in
+ * one step when the page is done. The runners keep one arena per thread
+ * that exports pages and hand it to every page (PAGE_CONTEXT::useArena),
+ * so the blocks are reused by the next page and a long run does not keep
+ * allocating.
+ *
+ * Objects in the arena are never destroyed one by one, so they must be
+ * trivially destructible. Strings they need (bBox names, image paths) are
+ * copied into the arena or interned in a PATH_TABLE.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_ARENA_H
+#define OCR_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+
+#define ARENA_BLOCK_SIZE    (64 * 1024)
+
+
+/*
+ * A bump allocator for the objects of one page.
+ */
+class PAGE_ARENA
+{
+private:
+
+    std::vector<char *> blocks;     // blocks of blockSize bytes
+    std::vector<char *> large;      // allocations larger than a block
+    size_t blockSize;
+    size_t current;                 // the block being handed out
+    size_t used;                    // bytes handed out of the current block
+    size_t total;                   // bytes handed out since the last reset
+
+public:
+    // constructor, no memory is taken until the first allocation
+    PAGE_ARENA(size_t blockBytes = ARENA_BLOCK_SIZE);
+
+    // returns bytes of memory aligned to align (a power of two)
+    void *allocate(size_t bytes, size_t align);
+
+    // creates an object in the arena
+    template <class T, class... ARGS>
+    T *create(ARGS &&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T)))
+                   T(std::forward<ARGS>(args)...);
+    }
+
+    // creates an uninitialized array of n elements in the arena
+    template <class T>
+    T *createArray(size_t n)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "arena objects are never destroyed");
+        return (T *) allocate(sizeof(T) * (n > 0 ? n : 1), alignof(T));
+    }
+
+    // copies a string into the arena, returns the null terminated copy
+    const char *copyString(const std::string &text);
+
+    // drops every object in the arena, keeps the blocks for reuse
+    void reset();
+
+    size_t getBytesUsed() { return total; }
+
+    // destructor, frees the blocks
+    ~PAGE_ARENA();
+
+    PAGE_ARENA(const PAGE_ARENA &) = delete;
+    PAGE_ARENA &operator=(const PAGE_ARENA &) = delete;
+};
+
+
+/*
+ * Interned strings: every distinct string is stored once and referred to
+ * by a small id. Ids stay valid (and get() references stay valid) for the
+ * whole run. intern() and get() are thread-safe.
+ */
+class PATH_TABLE
+{
+private:
+
+    std::deque<std::string> paths;          // by id, never moved
+    std::map<std::string, uint32_t> ids;
+    std::mutex lock;
+
+public:
+    // returns the id of the string, adding it if it is new
+    uint32_t intern(const std::string &path);
+
+    // returns the string with the given id
+    const std::string &get(uint32_t id);
+};
+
+
+// the image paths of the run, shared by all pages
+extern PATH_TABLE imagePaths;
+
+#endif
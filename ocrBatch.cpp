@@ -0,0 +1,885 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrBatch.h
+ *
+ * The batch runner processes the pages of an image list either serially or
+ * on a pool of worker threads, and merges the page records into the letter
+ * and word output files in list order.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrBatch.h"
+#include "ocrPipeline.h"
+#include "ocrJournal.h"
+#include "ocrCache.h"
+#include "ocrDedup.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+
+using namespace std;
+
+
+/*
+ * Reads the image list (and the to-find list, if one is given) into a vector
+ * of batch entries. This function returns 0 on success.
+ *
+ * @param imageList: file of newline separated image paths
+ * @param findList: file of newline separated to-find paths, or "" for none
+ * @param entries: the vector to fill
+ */
+int readBatchEntries(string imageList, string findList,
+                     vector<BATCH_ENTRY> &entries)
+{
+    string imgPathLine;
+    string findPathLine;
+    ifstream fileList(imageList); // open the file with the image paths
+    ifstream findFileList;
+
+    if (!fileList.is_open())
+    {
+        printf("could not open image list %s\n", imageList.c_str());
+        return 1;
+    }
+    if (!findList.empty())
+    {
+        findFileList.open(findList);
+        if (!findFileList.is_open())
+        {
+            printf("could not open to-find list %s\n", findList.c_str());
+            return 1;
+        }
+    }
+
+    while (getline(fileList, imgPathLine))
+    {
+        BATCH_ENTRY entry;
+
+        imgPathLine.erase(remove(imgPathLine.begin(), imgPathLine.end(), '\n'),
+                          imgPathLine.end());
+        entry.imageFile = imgPathLine;
+        entry.pageNumber = 0;
+        entry.pageCount = 1;
+        entry.line = entries.size();
+
+        if (!findList.empty())
+        {
+            findPathLine = "";
+            getline(findFileList, findPathLine);
+            findPathLine.erase(remove(findPathLine.begin(), findPathLine.end(),
+                                      '\n'),
+                               findPathLine.end());
+            entry.findFile = findPathLine;
+        }
+        entries.push_back(entry);
+    }
+    return 0;
+}
+
+
+/*
+ * Reads a batch manifest, and the to-find and region lists it names.
+ * This function returns 0 on success.
+ *
+ * @param manifest: the manifest file
+ * @param imageList: the image list of the run
+ * @param extractors: the vector to fill, in manifest order
+ */
+int readManifest(string manifest, string imageList,
+                 vector<MANIFEST_ENTRY> &extractors)
+{
+    ifstream in(manifest);
+    string line;
+    int lineNumber = 0;
+
+    if (!in.is_open())
+    {
+        printf("could not open manifest %s\n", manifest.c_str());
+        return 1;
+    }
+
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        MANIFEST_ENTRY entry;
+        string mode;
+        string findList;
+
+        lineNumber++;
+        if (!(fields >> entry.extractor) || entry.extractor[0] == '#')
+        {
+            continue;
+        }
+        fields >> entry.letterFile >> entry.wordFile >> mode >> findList;
+
+        if (mode == "-l") { entry.modeInt = 0; }
+        else if (mode == "-w") { entry.modeInt = 1; }
+        else if (mode == "-b") { entry.modeInt = 2; }
+        else
+        {
+            printf("ERROR, %s line %d: modes can only be -l, -w, or -b\n",
+                   manifest.c_str(), lineNumber);
+            return 1;
+        }
+
+        if (entry.extractor == "strings" || entry.extractor == "exact" ||
+            entry.extractor == "regions")
+        {
+            vector<BATCH_ENTRY> lines;
+            if (findList.empty())
+            {
+                printf("ERROR, %s line %d: %s needs a %s list\n",
+                       manifest.c_str(), lineNumber, entry.extractor.c_str(),
+                       entry.extractor == "regions" ? "region" : "to-find");
+                return 1;
+            }
+            if (readBatchEntries(imageList, findList, lines) != 0)
+            {
+                return 1;
+            }
+            for (size_t i = 0; i < lines.size(); i++)
+            {
+                entry.findFiles.push_back(lines[i].findFile);
+            }
+        }
+        else if (entry.extractor != "all")
+        {
+            printf("ERROR, %s line %d: unknown extractor %s\n",
+                   manifest.c_str(), lineNumber, entry.extractor.c_str());
+            return 1;
+        }
+        extractors.push_back(entry);
+    }
+
+    if (extractors.empty())
+    {
+        printf("ERROR, manifest %s has no extractors\n", manifest.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Replaces every entry of a multi-page image file (TIFF, PDF) by one entry
+ * per page. Files that cannot be opened are kept as one page.
+ *
+ * @param entries: the entries read by readBatchEntries
+ */
+void expandDocumentPages(vector<BATCH_ENTRY> &entries)
+{
+    vector<BATCH_ENTRY> pages;
+
+    pages.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        HIMGFILE hFile;
+        int nPages = 1;
+
+        // the format is only used when writing, any value does for reading
+        if (kRecOpenImgFile(entries[i].imageFile.c_str(), &hFile, IMGF_READ,
+                            FF_TIFNO) == REC_OK)
+        {
+            if (kRecGetImgFilePageCount(hFile, &nPages) != REC_OK ||
+                nPages < 1)
+            {
+                nPages = 1;
+            }
+            kRecCloseImgFile(hFile);
+        }
+
+        for (int p = 0; p < nPages; p++)
+        {
+            BATCH_ENTRY page = entries[i];
+            page.pageNumber = p;
+            page.pageCount = nPages;
+            pages.push_back(page);
+        }
+    }
+    entries.swap(pages);
+}
+
+
+/*
+ * Parses the optional arguments, starting at argv[first]. Unknown options
+ * are reported and make this function return 1.
+ *
+ * @param argc, argv: the arguments given to main
+ * @param first: index of the first optional argument
+ * @param options: the options to fill in
+ */
+int parseRunOptions(int argc, char *argv[], int first, RUN_OPTIONS &options)
+{
+    string option;
+
+    options.nWorkers = 1;
+    options.pipeline = false;
+    options.queueDepth = 2;
+    options.metricsInterval = 0;
+    options.cropFormat = CROP_TIFF;
+    options.nEncoders = 0;
+    options.tensorSize = 0;
+    options.segmenter = SEGMENT_ENGINE;
+    options.dedupDistance = -1;
+    options.fuzzy.maxEdits = 0;
+    options.fuzzy.errWeight = 0;
+
+    for (int i = first; i < argc; i++)
+    {
+        option = argv[i];
+        if (option == "-j" && i + 1 < argc)
+        {
+            options.nWorkers = atoi(argv[++i]);
+            if (options.nWorkers < 1)
+            {
+                printf("ERROR, -j needs a positive number of workers\n");
+                return 1;
+            }
+        }
+        else if (option == "-p")
+        {
+            options.pipeline = true;
+        }
+        else if (option == "-g")
+        {
+            options.segmenter = SEGMENT_GEOMETRY;
+        }
+        else if (option == "-B" && i + 1 < argc)
+        {
+            options.binaryPrefix = argv[++i];
+        }
+        else if (option == "-m" && i + 1 < argc)
+        {
+            options.cropDirectory = argv[++i];
+        }
+        else if (option == "-a" && i + 1 < argc)
+        {
+            options.archivePrefix = argv[++i];
+        }
+        else if (option == "-f" && i + 1 < argc)
+        {
+            if (parseCropFormat(argv[++i], options.cropFormat) != 0)
+            {
+                printf("ERROR, -f needs tiff, packbits, png or raw\n");
+                return 1;
+            }
+        }
+        else if (option == "-t" && i + 1 < argc)
+        {
+            options.nEncoders = atoi(argv[++i]);
+            if (options.nEncoders < 1)
+            {
+                printf("ERROR, -t needs a positive number of threads\n");
+                return 1;
+            }
+        }
+        else if (option == "-r" && i + 1 < argc)
+        {
+            options.journalPath = argv[++i];
+        }
+        else if (option == "-c" && i + 1 < argc)
+        {
+            options.cacheDirectory = argv[++i];
+        }
+        else if (option == "-M" && i + 1 < argc)
+        {
+            options.metricsPath = argv[++i];
+        }
+        else if (option == "-N" && i + 1 < argc)
+        {
+            options.metricsInterval = atoi(argv[++i]);
+            if (options.metricsInterval < 1)
+            {
+                printf("ERROR, -N needs a positive number of pages\n");
+                return 1;
+            }
+        }
+        else if (option == "-n" && i + 1 < argc)
+        {
+            options.linePath = argv[++i];
+        }
+        else if (option == "-z" && i + 1 < argc)
+        {
+            options.zonePath = argv[++i];
+        }
+        else if (option == "-u" && i + 1 < argc)
+        {
+            options.dedupPath = argv[++i];
+        }
+        else if (option == "-d" && i + 1 < argc)
+        {
+            options.dedupDistance = atoi(argv[++i]);
+            if (options.dedupDistance < 0 ||
+                options.dedupDistance > DEDUP_MAX_DISTANCE)
+            {
+                printf("ERROR, -d needs a distance from 0 to %d bits\n",
+                       DEDUP_MAX_DISTANCE);
+                return 1;
+            }
+        }
+        else if (option == "-T" && i + 1 < argc)
+        {
+            options.tensorPrefix = argv[++i];
+        }
+        else if (option == "-S" && i + 1 < argc)
+        {
+            options.tensorSize = atoi(argv[++i]);
+            if (options.tensorSize < 1 || options.tensorSize > 256)
+            {
+                printf("ERROR, -S needs a tensor size from 1 to 256\n");
+                return 1;
+            }
+        }
+        else if (option == "-k" && i + 1 < argc)
+        {
+            options.fuzzy.maxEdits = atoi(argv[++i]);
+            if (options.fuzzy.maxEdits < 0)
+            {
+                printf("ERROR, -k needs a number of edits >= 0\n");
+                return 1;
+            }
+        }
+        else if (option == "-e" && i + 1 < argc)
+        {
+            options.fuzzy.errWeight = atof(argv[++i]);
+            if (options.fuzzy.errWeight < 0 || options.fuzzy.errWeight >= 1)
+            {
+                printf("ERROR, -e needs a weight in [0, 1)\n");
+                return 1;
+            }
+        }
+        else if (option == "-q" && i + 1 < argc)
+        {
+            options.queueDepth = atoi(argv[++i]);
+            if (options.queueDepth < 1)
+            {
+                printf("ERROR, -q needs a positive queue depth\n");
+                return 1;
+            }
+        }
+        else
+        {
+            printf("ERROR, unknown option %s\n", option.c_str());
+            return 1;
+        }
+    }
+
+    if (!options.cropDirectory.empty() && !options.archivePrefix.empty())
+    {
+        printf("ERROR, -m and -a can not be used together\n");
+        return 1;
+    }
+    if (options.cropFormat != CROP_TIFF && !options.archivePrefix.empty())
+    {
+        printf("ERROR, -f can not be used with -a, archives hold raw pixels\n");
+        return 1;
+    }
+    if (options.cropFormat == CROP_RAW && options.cropDirectory.empty())
+    {
+        printf("ERROR, -f raw needs -m, the engine does not write raw images\n");
+        return 1;
+    }
+    if (options.nEncoders > 0 && options.cropDirectory.empty())
+    {
+        printf("ERROR, -t needs -m\n");
+        return 1;
+    }
+    if (options.metricsInterval > 0 && options.metricsPath.empty())
+    {
+        printf("ERROR, -N needs a metrics file (-M)\n");
+        return 1;
+    }
+    if (options.tensorSize > 0 && options.tensorPrefix.empty())
+    {
+        printf("ERROR, -S needs a tensor output (-T)\n");
+        return 1;
+    }
+    if (!options.archivePrefix.empty() && !options.journalPath.empty())
+    {
+        printf("ERROR, -a can not be used with -r\n");
+        return 1;
+    }
+    if (!options.tensorPrefix.empty() && !options.journalPath.empty())
+    {
+        printf("ERROR, -T can not be used with -r\n");
+        return 1;
+    }
+    if ((!options.linePath.empty() || !options.zonePath.empty()) &&
+        !options.journalPath.empty())
+    {
+        printf("ERROR, -n and -z can not be used with -r\n");
+        return 1;
+    }
+    if (!options.dedupPath.empty() && options.cropDirectory.empty() &&
+        options.archivePrefix.empty())
+    {
+        printf("ERROR, -u needs bBox images cut in memory (-m or -a)\n");
+        return 1;
+    }
+    if (!options.dedupPath.empty() && !options.journalPath.empty())
+    {
+        printf("ERROR, -u can not be used with -r\n");
+        return 1;
+    }
+    if (options.dedupDistance >= 0 && options.dedupPath.empty())
+    {
+        printf("ERROR, -d needs a crop map (-u)\n");
+        return 1;
+    }
+    if (options.fuzzy.errWeight > 0 && options.fuzzy.maxEdits == 0)
+    {
+        printf("ERROR, -e needs a fuzzy search (-k)\n");
+        return 1;
+    }
+    if (options.dedupDistance < 0)
+    {
+        options.dedupDistance = 0;
+    }
+    if (!options.tensorPrefix.empty() && options.tensorSize == 0)
+    {
+        options.tensorSize = TENSOR_SIZE;
+    }
+    return 0;
+}
+
+
+/*
+ * Creates the crop sink asked for by the options: an archive for -a, a
+ * directory of image files for -m, or none (sinks.crops is set to NULL) to
+ * save the bBox images with kRecSaveImgAreaF. The caller owns the sink.
+ * This function returns 0 on success.
+ *
+ * @param options: the run options
+ * @param sinks: sinks.crops is set to the new crop sink, or NULL
+ */
+int createCropSink(RUN_OPTIONS &options, OUTPUT_SINKS &sinks)
+{
+    CROP_SINK *&sink = sinks.crops;
+
+    sink = NULL;
+    sinks.cropFormat = options.cropFormat;
+    if (!options.archivePrefix.empty())
+    {
+        ARCHIVE_CROP_SINK *archive =
+            new ARCHIVE_CROP_SINK(options.archivePrefix);
+        if (!archive->isOpen())
+        {
+            delete archive;
+            return 1;
+        }
+        sink = archive;
+    }
+    else if (!options.cropDirectory.empty())
+    {
+        sink = new FILE_CROP_SINK(options.cropDirectory, options.cropFormat,
+                                  options.nEncoders);
+    }
+
+    // with -u, equal images are stored once
+    if (sink != NULL && !options.dedupPath.empty())
+    {
+        sink = new DEDUP_CROP_SINK(sink, options.dedupPath,
+                                   options.dedupDistance);
+    }
+    return 0;
+}
+
+
+/*
+ * Creates the sinks for the line (-n) and zone (-z) records, NULL for the
+ * ones not asked for, and sets the segmenter the lines are found with.
+ * The caller owns sinks.lines and sinks.zones.
+ *
+ * @param options: the run options
+ * @param sinks: sinks.lines, sinks.zones and sinks.segmenter are set
+ */
+void createLayoutSinks(RUN_OPTIONS &options, OUTPUT_SINKS &sinks)
+{
+    sinks.lines = NULL;
+    sinks.zones = NULL;
+    sinks.segmenter = options.segmenter;
+    if (!options.linePath.empty())
+    {
+        sinks.lines = new OCR_SINK(options.linePath);
+    }
+    if (!options.zonePath.empty())
+    {
+        sinks.zones = new OCR_SINK(options.zonePath);
+    }
+}
+
+
+RUN_SINKS::RUN_SINKS()
+{
+}
+
+
+/*
+ * The sinks are deleted in the reverse order of their members.
+ */
+RUN_SINKS::~RUN_SINKS()
+{
+}
+
+
+/*
+ * Opens the recognition cache (-c) and fills in the engine's settings.
+ */
+static int openCache(OCR_ENGINE &engine, RUN_OPTIONS &options, RUN_SINKS &run)
+{
+    // with -c, pages recognized by an earlier run are read from the cache
+    if (!options.cacheDirectory.empty())
+    {
+        run.cache.reset(new RECOGNITION_CACHE(options.cacheDirectory,
+                                      describeSettings(engine.getSID())));
+        if (!run.cache->isOpen())
+        {
+            return 1;
+        }
+        run.sinks.cache = run.cache.get();
+    }
+    return 0;
+}
+
+
+/*
+ * Opens the sinks every run has in common: crops, lines, zones and metrics.
+ */
+static int openCommonSinks(RUN_OPTIONS &options, RUN_SINKS &run)
+{
+    OUTPUT_SINKS &sinks = run.sinks;
+
+    // bBox images cut in memory go to a crop sink (-m or -a)
+    if (createCropSink(options, sinks) != 0)
+    {
+        return 1;
+    }
+    run.crops.reset(sinks.crops);
+
+    // with -n and -z, the lines and zones are exported as well
+    createLayoutSinks(options, sinks);
+    run.lines.reset(sinks.lines);
+    run.zones.reset(sinks.zones);
+
+    // with -M, count and time the run and write the metrics
+    if (!options.metricsPath.empty())
+    {
+        run.metrics.reset(new RUN_METRICS(options.metricsPath,
+                                          options.metricsInterval));
+        sinks.metrics = run.metrics.get();
+    }
+    return 0;
+}
+
+
+int openRunSinks(OCR_ENGINE &engine, RUN_OPTIONS &options,
+                 vector<BATCH_ENTRY> &entries,
+                 string letterFile, string wordFile, RUN_SINKS &run)
+{
+    OUTPUT_SINKS &sinks = run.sinks;
+
+    // every page of a multi-page TIFF or PDF is a page of the run
+    expandDocumentPages(entries);
+
+    if (openCache(engine, options, run) != 0)
+    {
+        return 1;
+    }
+
+    // the output files are opened once and written in large blocks
+    run.textSinks.push_back(unique_ptr<OCR_SINK>(new OCR_SINK(letterFile)));
+    run.textSinks.push_back(unique_ptr<OCR_SINK>(new OCR_SINK(wordFile)));
+    sinks.letters = run.textSinks[0].get();
+    sinks.words = run.textSinks[1].get();
+
+    // with -r, skip the pages a stopped run already finished
+    if (!options.journalPath.empty())
+    {
+        run.journal.reset(new RUN_JOURNAL(options.journalPath));
+        if (run.journal->restore(entries, letterFile, wordFile,
+                                 options.binaryPrefix) != 0)
+        {
+            return 1;
+        }
+        sinks.journal = run.journal.get();
+    }
+
+    if (!options.binaryPrefix.empty())
+    {
+        run.binary.reset(new BINARY_SINK(options.binaryPrefix));
+        if (!run.binary->isOpen())
+        {
+            return 1;
+        }
+        sinks.binary = run.binary.get();
+    }
+
+    // with -T, the letters are also written as fixed-size tensors
+    if (!options.tensorPrefix.empty())
+    {
+        run.tensors.reset(new TENSOR_SINK(options.tensorPrefix,
+                                          options.tensorSize));
+        if (!run.tensors->isOpen())
+        {
+            return 1;
+        }
+        sinks.tensors = run.tensors.get();
+    }
+
+    return openCommonSinks(options, run);
+}
+
+
+int openManifestSinks(OCR_ENGINE &engine, RUN_OPTIONS &options,
+                      vector<BATCH_ENTRY> &entries,
+                      const vector<MANIFEST_ENTRY> &extractors,
+                      RUN_SINKS &run)
+{
+    OUTPUT_SINKS &sinks = run.sinks;
+
+    // every page of a multi-page TIFF or PDF is a page of the run
+    expandDocumentPages(entries);
+
+    if (openCache(engine, options, run) != 0)
+    {
+        return 1;
+    }
+
+    // every extractor writes its own output files
+    for (size_t k = 0; k < extractors.size(); k++)
+    {
+        EXTRACTOR_SINKS extractorSinks;
+        extractorSinks.letters = new OCR_SINK(extractors[k].letterFile);
+        run.textSinks.push_back(unique_ptr<OCR_SINK>(extractorSinks.letters));
+        extractorSinks.words = new OCR_SINK(extractors[k].wordFile);
+        run.textSinks.push_back(unique_ptr<OCR_SINK>(extractorSinks.words));
+        sinks.extractors.push_back(extractorSinks);
+    }
+
+    // the page buffers stay empty, the first extractor's sinks stand in
+    sinks.letters = sinks.extractors[0].letters;
+    sinks.words = sinks.extractors[0].words;
+
+    return openCommonSinks(options, run);
+}
+
+
+int finishRunSinks(RUN_SINKS &run)
+{
+    if (run.metrics)
+    {
+        return run.metrics->report(run.sinks);
+    }
+    return 0;
+}
+
+
+/*
+ * The usage line of every run option, in the order parseRunOptions() reads
+ * them.
+ */
+static const char *runOptionUsage[] =
+{
+    "j-j N to process the images on N worker threads",
+    "p-p to overlap loading, recognition and export",
+    "q-q D to let each pipeline queue hold D pages",
+    "g-g to find words from the letter geometry",
+    "B-B P to write binary tables with file prefix P",
+    "m-m D to cut bBox images in memory into directory D",
+    "a-a P to pack bBox images into an archive with prefix P",
+    "f-f F to write bBox images as tiff, packbits, png or raw (with -m)",
+    "t-t N to encode bBox images on N threads (with -m)",
+    "u-u F to store equal bBox images once, mapping names to images in F "
+        "(with -m or -a, not with -r)",
+    "d-d D to treat images within D perceptual hash bits as equal (with -u)",
+    "c-c D to keep recognition results in the cache directory D",
+    "M-M F to write run metrics to F (JSON, or Prometheus text for *.prom)",
+    "N-N N to write the metrics every N pages as well (with -M)",
+    "T-T P to write letter tensors with file prefix P",
+    "S-S N to make the tensors N x N (with -T, default 32)",
+    "n-n F to export the text lines with their records in F",
+    "z-z F to export the recognized zones with their records in F",
+    "r-r J to keep a checkpoint journal J and resume from it "
+        "(not with -a, -u, -T, -n or -z)",
+    "k-k K to find strings within K edits",
+    "e-e W to weight substitutions by letter error (with -k)",
+};
+
+
+void printRunOptions(string accepted)
+{
+    bool first = true;
+
+    for (size_t i = 0; i < sizeof(runOptionUsage) / sizeof(runOptionUsage[0]);
+         i++)
+    {
+        if (accepted.find(runOptionUsage[i][0]) == string::npos)
+        {
+            continue;
+        }
+        printf("\n  %s %s", first ? "optional:" : "         ",
+               runOptionUsage[i] + 1);
+        first = false;
+    }
+    printf("\n");
+}
+
+
+/*
+ * Processes the pages one after another with the engine's own settings ID.
+ * The crop counters carry over from page to page.
+ */
+static int runSerial(OCR_ENGINE &engine, vector<BATCH_ENTRY> &entries,
+                     OUTPUT_SINKS &sinks, PAGE_FUNCTION pageFunction)
+{
+    int failed = 0;
+    size_t first;
+    CROP_COUNTERS counters;
+    PAGE_ARENA arena;
+
+    getResumePoint(sinks, first, counters);
+    for (size_t i = first; i < entries.size(); i++)
+    {
+        PAGE_CONTEXT page;
+        page.useArena(arena);
+        page.sid = engine.getSID();
+        page.imageFile = entries[i].imageFile;
+        page.pageNumber = entries[i].pageNumber;
+        page.pageCount = entries[i].pageCount;
+        page.index = i;
+        page.namePrefix = "";
+        page.counters = counters;
+        page.useSinks(sinks);
+
+        if (processPage(page, [&](PAGE_CONTEXT &p)
+                        { return pageFunction(p, entries[i]); }) != 0)
+        {
+            failed++;
+        }
+        counters = page.counters;
+        appendPageRecords(page, sinks);
+    }
+    return (failed == 0 ? 0 : 1);
+}
+
+
+/*
+ * Runs pageFunction for every entry and hands the page records to the
+ * output sinks in the order of the image list.
+ *
+ * @param engine: the running engine session
+ * @param entries: the pages to process
+ * @param sinks: the sinks for letter and word results
+ * @param options: the run options (number of workers, pipeline)
+ * @param pageFunction: the export stage for each page
+ */
+int runBatch(OCR_ENGINE &engine, vector<BATCH_ENTRY> &entries,
+             OUTPUT_SINKS &sinks, RUN_OPTIONS &options,
+             PAGE_FUNCTION pageFunction)
+{
+    int nWorkers = options.nWorkers;
+    vector<int> workerSIDs;
+    size_t first;
+    CROP_COUNTERS counters;
+
+    getResumePoint(sinks, first, counters);
+    if (first >= entries.size())
+    {
+        printf("all pages are done already\n");
+        return 0;
+    }
+
+    if (options.pipeline)
+    {
+        int err = runPipeline(engine, entries, sinks, options, pageFunction);
+        if (err >= 0)
+        {
+            return err;
+        }
+        printf("could not start the pipeline, processing pages in order\n");
+        nWorkers = 1;
+    }
+
+    if (nWorkers > (int) (entries.size() - first))
+    {
+        nWorkers = entries.size() - first;
+    }
+
+    // every worker recognizes with its own settings collection
+    for (int w = 0; w < nWorkers; w++)
+    {
+        int newSID;
+        if (engine.createSettings(newSID) != 0)
+        {
+            printf("could only create settings for %d workers\n", w);
+            break;
+        }
+        workerSIDs.push_back(newSID);
+    }
+
+    if (workerSIDs.size() < 2)
+    {
+        for (size_t w = 0; w < workerSIDs.size(); w++)
+        {
+            engine.releaseSettings(workerSIDs[w]);
+        }
+        return runSerial(engine, entries, sinks, pageFunction);
+    }
+
+    // finished pages wait here until all pages before them are written
+    vector<PAGE_CONTEXT *> finished(entries.size(), (PAGE_CONTEXT *) NULL);
+    size_t nextCommit = first;
+    mutex commitLock;
+    atomic<size_t> nextPage(first);
+    atomic<int> failed(0);
+
+    auto worker = [&](int workerSID)
+    {
+        PAGE_ARENA arena;
+        size_t i;
+        while ((i = nextPage++) < entries.size())
+        {
+            PAGE_CONTEXT *page = new PAGE_CONTEXT;
+            page->useArena(arena);
+            page->sid = workerSID;
+            page->imageFile = entries[i].imageFile;
+            page->pageNumber = entries[i].pageNumber;
+            page->pageCount = entries[i].pageCount;
+            page->index = i;
+            page->namePrefix = to_string(i) + "-";
+            page->useSinks(sinks);
+
+            if (processPage(*page, [&](PAGE_CONTEXT &p)
+                            { return pageFunction(p, entries[i]); }) != 0)
+            {
+                failed++;
+            }
+
+            // write out every page that is next in line
+            lock_guard<mutex> lock(commitLock);
+            finished[i] = page;
+            while (nextCommit < entries.size() && finished[nextCommit] != NULL)
+            {
+                appendPageRecords(*finished[nextCommit], sinks);
+                delete finished[nextCommit];
+                finished[nextCommit] = NULL;
+                nextCommit++;
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (size_t w = 0; w < workerSIDs.size(); w++)
+    {
+        workers.push_back(thread(worker, workerSIDs[w]));
+    }
+    for (size_t w = 0; w < workers.size(); w++)
+    {
+        workers[w].join();
+        engine.releaseSettings(workerSIDs[w]);
+    }
+
+    return (failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,338 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrBatch.cpp program
+ *
+ * The batch runner reads the image list (and the list of to-find files),
+ * and runs an extract function over every image, either one image after
+ * another or on a pool of worker threads.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_BATCH_H
+#define OCR_BATCH_H
+
+#include "ocrExtraction.h"
+#include <functional>
+#include <memory>
+
+
+class RECOGNITION_CACHE;
+class RUN_JOURNAL;
+
+
+/*
+ * One line of the image list, and the matching line of the to-find list
+ * (empty if the driver does not use a to-find list).
+ */
+struct BATCH_ENTRY
+{
+    std::string imageFile;      // path to the image
+    std::string findFile;       // path to the strings-to-find file (or the
+                                // region file, for extractRegions)
+    int pageNumber;             // page of the image to process (0 = first)
+    int pageCount;              // number of pages in the image file
+    size_t line;                // line of the image in the image list
+};
+
+
+/*
+ * One line of a batch manifest: an extractor to run over every page, and
+ * the files its results go to. The manifest has one extractor per line,
+ *
+ *      all     <letter file> <word file> <-l|-w|-b>
+ *      strings <letter file> <word file> <-l|-w|-b> <to-find list>
+ *      exact   <letter file> <word file> <-l|-w|-b> <to-find list>
+ *      regions <letter file> <word file> <-l|-w|-b> <region list>
+ *
+ * separated by blanks; empty lines and lines starting with '#' are skipped.
+ * A to-find list names the strings-to-find file of every image, like the
+ * fifth argument of extractStrings and extractExact; a region list names
+ * the region file of every image, like the fifth argument of
+ * extractRegions.
+ */
+struct MANIFEST_ENTRY
+{
+    std::string extractor;      // "all", "strings", "exact" or "regions"
+    std::string letterFile;     // letter output file
+    std::string wordFile;       // word output file
+    int modeInt;                // 0 (-l), 1 (-w) or 2 (-b)
+    std::vector<std::string> findFiles;     // to-find (or region) file by
+                                            // image list line, empty for
+                                            // "all"
+};
+
+
+/*
+ * Options that can be given after the required driver arguments.
+ */
+struct RUN_OPTIONS
+{
+    int nWorkers;               // -j N: number of worker threads (1 = serial)
+    bool pipeline;              // -p: run the staged load/recognize/export
+                                //     pipeline instead of whole-page workers
+    int queueDepth;             // -q D: pages each pipeline queue can hold
+    std::string binaryPrefix;   // -B P: write binary tables P.letters.bin,
+                                //       P.words.bin and P.images.txt instead
+                                //       of the text output files
+    std::string cropDirectory;  // -m D: cut the bBox images from the page
+                                //       bitmap in memory and write them to
+                                //       the directory D
+    std::string archivePrefix;  // -a P: pack the bBox images into the
+                                //       archive P-<k>.pack with index P.idx
+    CROP_FORMAT cropFormat;     // -f F: the format of the bBox image files:
+                                //       tiff, packbits, png or raw (-m only)
+    int nEncoders;              // -t N: with -m, encode and write the bBox
+                                //       images on N threads of their own
+    FUZZY_OPTIONS fuzzy;        // -k K, -e W: find strings within K edits,
+                                //       substitutions cost 1 - W * err / 255
+    std::string journalPath;    // -r J: checkpoint every page in the journal
+                                //       J and resume from it
+    std::string cacheDirectory; // -c D: keep the recognition results in the
+                                //       directory D and reuse them
+    std::string metricsPath;    // -M F: write the run metrics to F (JSON, or
+                                //       Prometheus text for "*.prom")
+    int metricsInterval;        // -N N: also write them every N pages
+    std::string tensorPrefix;   // -T P: write the letters as tensors to
+                                //       P.tensors.bin, P.labels.bin and
+                                //       P.images.txt
+    int tensorSize;             // -S N: the tensors are N x N bytes
+    WORD_SEGMENTER segmenter;   // -g: find words and lines from the letter
+                                //     geometry instead of the engine flags
+    std::string linePath;       // -n F: also export the text lines, records
+                                //       to F and bBox images n-<k>
+    std::string zonePath;       // -z F: also export the recognized zones,
+                                //       records to F and bBox images z-<k>
+    std::string dedupPath;      // -u F: store equal bBox images once, map
+                                //       every image name to its ref in F
+    int dedupDistance;          // -d D: with -u, images whose perceptual
+                                //       hashes differ in <= D bits are equal
+};
+
+
+/*
+ * The sinks of a run, set up by openRunSinks() or openManifestSinks(), and
+ * the objects behind them. Deleting it writes what the sinks still hold and
+ * closes their files: the metrics first, the recognition cache last.
+ */
+struct RUN_SINKS
+{
+    OUTPUT_SINKS sinks;         // what runBatch() writes to
+
+    std::unique_ptr<RECOGNITION_CACHE> cache;
+    std::vector<std::unique_ptr<OCR_SINK> > textSinks;  // the letter and
+                                // word files (of every extractor)
+    std::unique_ptr<RUN_JOURNAL> journal;
+    std::unique_ptr<BINARY_SINK> binary;
+    std::unique_ptr<TENSOR_SINK> tensors;
+    std::unique_ptr<CROP_SINK> crops;
+    std::unique_ptr<OCR_SINK> lines;
+    std::unique_ptr<OCR_SINK> zones;
+    std::unique_ptr<RUN_METRICS> metrics;
+
+    // in ocrBatch.cpp, where the cache and journal types are complete
+    RUN_SINKS();
+    ~RUN_SINKS();
+};
+
+
+/*
+ * The export stage for one page, e.g. a call to exportAll. It gets a page
+ * that is loaded and recognized, and the list entry for the page.
+ */
+typedef std::function<int(PAGE_CONTEXT &page, const BATCH_ENTRY &entry)>
+        PAGE_FUNCTION;
+
+
+/*
+ * Reads the image list (and the to-find list, if one is given) into a vector
+ * of batch entries. This function returns 0 on success.
+ *
+ * @param imageList: file of newline separated image paths
+ * @param findList: file of newline separated to-find paths, or "" for none
+ * @param entries: the vector to fill
+ */
+extern int readBatchEntries(std::string imageList, std::string findList,
+                            std::vector<BATCH_ENTRY> &entries);
+
+
+/*
+ * Reads a batch manifest. The to-find lists it names are read as well,
+ * they must have a line for every line of the image list.
+ * This function returns 0 on success.
+ *
+ * @param manifest: the manifest file
+ * @param imageList: the image list of the run
+ * @param extractors: the vector to fill, in manifest order
+ */
+extern int readManifest(std::string manifest, std::string imageList,
+                        std::vector<MANIFEST_ENTRY> &extractors);
+
+
+/*
+ * Replaces every entry of a multi-page image file (TIFF, PDF) by one entry
+ * per page, so the pages of a document are processed like separate images
+ * and spread over the workers. Must be called after the engine is started.
+ * Files that cannot be opened are kept as one page, loading them reports
+ * the error.
+ *
+ * @param entries: the entries read by readBatchEntries
+ */
+extern void expandDocumentPages(std::vector<BATCH_ENTRY> &entries);
+
+
+/*
+ * Parses the optional arguments, starting at argv[first]. Unknown options
+ * are reported and make this function return 1.
+ *
+ * Supported options:
+ *      -j N : process the images on N worker threads
+ *      -p   : overlap loading, recognition and export in a staged pipeline
+ *             (with -j N, recognition runs on N threads)
+ *      -q D : let each pipeline queue hold up to D pages (default 2)
+ *      -g   : find the words (and lines) from the letter geometry instead
+ *             of the engine's makeup flags
+ *      -B P : write binary letter/word tables with the file prefix P
+ *      -m D : cut bBox images from the page bitmap in memory, write them
+ *             to the directory D
+ *      -a P : pack the bBox images into an archive with the file prefix P
+ *      -f F : write the bBox images as tiff (default), packbits (TIFF),
+ *             png or raw (8-bit PGM, with -m only)
+ *      -t N : with -m, encode the bBox images on N threads of their own
+ *      -u F : with -m or -a, store equal bBox images once and map every
+ *             image name to the stored image in the file F (not with -r)
+ *      -d D : with -u, also treat images whose perceptual hashes differ in
+ *             at most D bits as equal (0 to DEDUP_MAX_DISTANCE)
+ *      -T P : write letter tensors and their labels with the file prefix P
+ *      -S N : with -T, make the tensors N x N (1 to 256, default 32)
+ *      -n F : export the text lines, their records go to F
+ *      -z F : export the recognized zones, their records go to F
+ *      -k K : find the to-find strings within K edits (fuzzy search)
+ *      -e W : with -k (K > 0), let the letter error lower the cost of
+ *             substitutions by up to W (0 <= W < 1)
+ *      -r J : keep a checkpoint journal J; a stopped run started again with
+ *             the same arguments goes on after the last page it finished
+ *             (not with -a, -u, -T, -n or -z)
+ *      -c D : cache the recognition results in the directory D, pages that
+ *             are in the cache are not recognized again
+ *      -M F : count and time the run and write the metrics to F at the end,
+ *             as Prometheus text if F ends in ".prom", as JSON otherwise
+ *      -N N : with -M, write the metrics every N pages as well
+ *
+ * @param argc, argv: the arguments given to main
+ * @param first: index of the first optional argument
+ * @param options: the options to fill in
+ */
+extern int parseRunOptions(int argc, char *argv[], int first,
+                           RUN_OPTIONS &options);
+
+
+/*
+ * Creates the crop sink asked for by the options: an archive for -a, a
+ * directory of image files for -m, or none (sinks.crops is set to NULL) to
+ * save the bBox images with kRecSaveImgAreaF. With -u, the sink is put
+ * behind a DEDUP_CROP_SINK. Also sets the format the engine saves them in.
+ * The caller deletes the sink.
+ * This function returns 0 on success.
+ *
+ * @param options: the run options
+ * @param sinks: sinks.crops is set to the new crop sink, or NULL
+ */
+extern int createCropSink(RUN_OPTIONS &options, OUTPUT_SINKS &sinks);
+
+
+/*
+ * Creates the sinks for the line (-n) and zone (-z) records, NULL for the
+ * ones not asked for, and sets the segmenter the lines are found with.
+ * The caller deletes sinks.lines and sinks.zones.
+ *
+ * @param options: the run options
+ * @param sinks: sinks.lines, sinks.zones and sinks.segmenter are set
+ */
+extern void createLayoutSinks(RUN_OPTIONS &options, OUTPUT_SINKS &sinks);
+
+
+/*
+ * Sets up a driver run: expands the entries into their pages and opens
+ * the letter and word files, and the recognition cache (-c), journal (-r),
+ * binary tables (-B), tensors (-T), crop sink (-m, -a, -u), line and zone
+ * files (-n, -z) and metrics (-M) the options ask for.
+ * This function returns 0 on success; the reason for a failure is printed.
+ *
+ * @param engine: the running engine session
+ * @param options: the run options
+ * @param entries: the entries of the run, replaced by their pages
+ * @param letterFile, wordFile: the letter and word output files
+ * @param run: filled with the sinks
+ */
+extern int openRunSinks(OCR_ENGINE &engine, RUN_OPTIONS &options,
+                        std::vector<BATCH_ENTRY> &entries,
+                        std::string letterFile, std::string wordFile,
+                        RUN_SINKS &run);
+
+
+/*
+ * Sets up the sinks of a manifest run like openRunSinks(), with the letter
+ * and word files of every extractor; sinks.letters and sinks.words are the
+ * first extractor's. A manifest run has no journal, binary tables or
+ * tensors.
+ * This function returns 0 on success.
+ *
+ * @param engine: the running engine session
+ * @param options: the run options
+ * @param entries: the entries of the run, replaced by their pages
+ * @param extractors: the extractors of the manifest, at least one
+ * @param run: filled with the sinks
+ */
+extern int openManifestSinks(OCR_ENGINE &engine, RUN_OPTIONS &options,
+                             std::vector<BATCH_ENTRY> &entries,
+                             const std::vector<MANIFEST_ENTRY> &extractors,
+                             RUN_SINKS &run);
+
+
+/*
+ * Ends a run: writes the final metrics report, if the run has metrics.
+ * The sinks write what they still hold when run is deleted.
+ * This function returns 0 on success.
+ *
+ * @param run: the sinks of the run
+ */
+extern int finishRunSinks(RUN_SINKS &run);
+
+
+/*
+ * Prints the usage lines of the run options a driver takes, in the order
+ * of parseRunOptions().
+ *
+ * @param accepted: the letters of the options, e.g. "jpqgB"
+ */
+extern void printRunOptions(std::string accepted);
+
+
+/*
+ * Runs pageFunction for every entry and hands the page records to the
+ * output sinks in the order of the image list.
+ *
+ * With one worker the pages are processed one after another, and the bBox
+ * images are named l-0, l-1, ... across the whole run like before.
+ * With more workers, every worker gets its own settings ID and every page
+ * numbers its images on its own, with the index of the page in the run as
+ * prefix (l-<page>-<n>), so names stay unique and do not depend on which
+ * worker processed the page. The pages are counted after
+ * expandDocumentPages(), every page of a multi-page file has its own index.
+ *
+ * With options.pipeline, the pages go through runPipeline() instead.
+ *
+ * This function returns 0 if every page was processed successfully.
+ *
+ * @param engine: the running engine session
+ * @param entries: the pages to process
+ * @param sinks: the sinks for letter and word results
+ * @param options: the run options (number of workers)
+ * @param pageFunction: the export stage for each page, it gets a page that
+ *                      is already loaded and recognized
+ */
+extern int runBatch(OCR_ENGINE &engine, std::vector<BATCH_ENTRY> &entries,
+                    OUTPUT_SINKS &sinks, RUN_OPTIONS &options,
+                    PAGE_FUNCTION pageFunction);
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrBinary.h
+ *
+ * The record files are opened once, records are appended as raw structs,
+ * and the headers get their final counts when the sink is closed.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrBinary.h"
+#include <string.h>
+
+
+using namespace std;
+
+
+/*
+ * Opens a record file for appending. If the file already holds a table, the
+ * number of records in it is read from its size; otherwise a new header is
+ * written. A table written on a host with the other byte order is not
+ * appended to. Returns NULL on failure.
+ *
+ * @param path: the record file
+ * @param magic: the magic string of the table
+ * @param recordSize: the size of one record
+ * @param count: set to the number of records already in the file
+ */
+FILE *openBinaryTable(string path, const char *magic, uint32_t recordSize,
+                      uint64_t &count)
+{
+    BINARY_HEADER header;
+    FILE *file = fopen(path.c_str(), "r+b");
+
+    count = 0;
+    if (file != NULL)
+    {
+        // continue an existing table
+        if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, magic, 8) != 0 ||
+            header.recordSize != recordSize)
+        {
+            printf("%s is not a table of this kind, not appending\n",
+                   path.c_str());
+            fclose(file);
+            return NULL;
+        }
+        if (header.byteOrder != BINARY_BYTE_ORDER && header.byteOrder != 0)
+        {
+            printf("%s was written with another byte order, not appending\n",
+                   path.c_str());
+            fclose(file);
+            return NULL;
+        }
+        fseek(file, 0, SEEK_END);
+        count = (ftell(file) - sizeof(header)) / recordSize;
+
+        // drop a partial record left by a crash
+        fseek(file, sizeof(header) + count * recordSize, SEEK_SET);
+        return file;
+    }
+
+    file = fopen(path.c_str(), "w+b");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, 8);
+    header.version = BINARY_VERSION;
+    header.recordSize = recordSize;
+    header.count = 0;
+    header.byteOrder = BINARY_BYTE_ORDER;
+    fwrite(&header, sizeof(header), 1, file);
+    return file;
+}
+
+
+/*
+ * Writes the record count into the header of a record file and closes it.
+ *
+ * @param file: the record file, or NULL
+ * @param count: the number of records in the file
+ */
+void closeBinaryTable(FILE *file, uint64_t count)
+{
+    BINARY_HEADER header;
+
+    if (file == NULL)
+    {
+        return;
+    }
+    fflush(file);
+    fseek(file, 0, SEEK_SET);
+    if (fread(&header, sizeof(header), 1, file) == 1)
+    {
+        header.count = count;
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+    }
+    fclose(file);
+}
+
+
+/*
+ * BINARY_SINK constructor
+ *
+ * @param filePrefix: the tables are written to <filePrefix>.letters.bin,
+ *                    <filePrefix>.words.bin and <filePrefix>.images.txt
+ */
+BINARY_SINK::BINARY_SINK(string filePrefix)
+{
+    prefix = filePrefix;
+    nImages = 0;
+    failed = false;
+
+    letterFile = openBinaryTable(prefix + ".letters.bin", BINARY_LETTER_MAGIC,
+                                 sizeof(BINARY_LETTER), nLetters);
+    wordFile = openBinaryTable(prefix + ".words.bin", BINARY_WORD_MAGIC,
+                               sizeof(BINARY_WORD), nWords);
+
+    // count the images that are already in the image table
+    imageFile = fopen((prefix + ".images.txt").c_str(), "a+");
+    if (imageFile != NULL)
+    {
+        int c;
+        fseek(imageFile, 0, SEEK_SET);
+        while ((c = fgetc(imageFile)) != EOF)
+        {
+            if (c == '\n')
+            {
+                nImages++;
+            }
+        }
+        fseek(imageFile, 0, SEEK_END);
+    }
+
+    if (letterFile == NULL || wordFile == NULL || imageFile == NULL)
+    {
+        printf("could not open binary output %s\n", prefix.c_str());
+        failed = true;
+    }
+}
+
+
+/*
+ * Appends the records of one page to the tables.
+ * Returns 0 on success.
+ *
+ * @param imagePath: the image the records come from
+ * @param pageNumber: the page of the image (0 = first)
+ * @param namePrefix: the prefix of the page's bBox image names
+ * @param letters: the page's letter records
+ * @param words: the page's word records, with letter ranges relative to
+ *               the page's letters
+ */
+int BINARY_SINK::writePage(string imagePath, int pageNumber,
+                           string namePrefix,
+                           vector<BINARY_LETTER> &letters,
+                           vector<BINARY_WORD> &words)
+{
+    lock_guard<mutex> guard(lock);
+
+    if (failed)
+    {
+        return 1;
+    }
+
+    uint32_t imageId = nImages;
+    for (size_t i = 0; i < letters.size(); i++)
+    {
+        letters[i].imageId = imageId;
+    }
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        words[i].imageId = imageId;
+        words[i].firstLetter += nLetters;
+    }
+
+    fprintf(imageFile, "%s\t%s\t%d\n", imagePath.c_str(), namePrefix.c_str(),
+            pageNumber);
+    nImages++;
+
+    if (!letters.empty() &&
+        fwrite(&letters[0], sizeof(BINARY_LETTER), letters.size(), letterFile)
+            != letters.size())
+    {
+        failed = true;
+    }
+    if (!words.empty() &&
+        fwrite(&words[0], sizeof(BINARY_WORD), words.size(), wordFile)
+            != words.size())
+    {
+        failed = true;
+    }
+    if (failed)
+    {
+        printf("could not write binary output %s\n", prefix.c_str());
+        return 1;
+    }
+
+    nLetters += letters.size();
+    nWords += words.size();
+    return 0;
+}
+
+
+/*
+ * Writes everything buffered to the three files.
+ */
+void BINARY_SINK::flush()
+{
+    lock_guard<mutex> guard(lock);
+
+    if (letterFile != NULL) fflush(letterFile);
+    if (wordFile != NULL) fflush(wordFile);
+    if (imageFile != NULL) fflush(imageFile);
+}
+
+
+/*
+ * BINARY_SINK destructor, finishes the headers and closes the files.
+ */
+BINARY_SINK::~BINARY_SINK()
+{
+    closeBinaryTable(letterFile, nLetters);
+    closeBinaryTable(wordFile, nWords);
+    if (imageFile != NULL)
+    {
+        fclose(imageFile);
+    }
+}
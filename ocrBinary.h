@@ -0,0 +1,169 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrBinary.cpp program
+ *
+ * The binary output is a compact alternative to the text records. It is made
+ * of three files that share a prefix:
+ *
+ *      <prefix>.letters.bin : header + one BINARY_LETTER per letter
+ *      <prefix>.words.bin   : header + one BINARY_WORD per word
+ *      <prefix>.images.txt  : one line per image (page of an image file),
+ *                             "<path>\t<name prefix>\t<page number>"
+ *
+ * The record files are plain arrays of fixed-width records after a 64 byte
+ * header, so readers can mmap them and index the records directly. They
+ * are written in the byte order of the host (little-endian on x86 and ARM
+ * Macs); header.byteOrder holds BINARY_BYTE_ORDER in that order, so a
+ * reader on another host can tell that it has to swap the fields. The image id of a record is the (0-based) line in the image
+ * table, and a bBox image is named "l-<name prefix><cropId>.tiff" (or "w-"
+ * for words). Running again with the same prefix appends to the tables.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_BINARY_H
+#define OCR_BINARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+
+
+#define BINARY_VERSION      1
+#define BINARY_BYTE_ORDER   0x01020304u     // header.byteOrder as written
+#define BINARY_NO_CROP      0xFFFFFFFFu     // cropId of a letter without image
+
+#define BINARY_LETTER_MAGIC "OCRLTR01"
+#define BINARY_WORD_MAGIC   "OCRWRD01"
+
+
+/*
+ * The header at the start of each record file.
+ */
+struct BINARY_HEADER
+{
+    char magic[8];              // BINARY_LETTER_MAGIC or BINARY_WORD_MAGIC
+    uint32_t version;           // BINARY_VERSION
+    uint32_t recordSize;        // sizeof the records that follow
+    uint64_t count;             // number of records in the file
+    uint32_t byteOrder;         // BINARY_BYTE_ORDER in the host's order,
+                                // 0 in tables written before it was set
+    uint32_t reserved[9];
+};
+
+
+/*
+ * One recognized letter.
+ */
+struct BINARY_LETTER
+{
+    uint32_t imageId;           // line of the image in the image table
+    uint32_t cropId;            // number of the bBox image, or BINARY_NO_CROP
+    int32_t left;               // the square bBox of the letter
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+    uint32_t code;              // the ocr result
+    uint16_t err;               // error of the letter, [0, 255]
+    uint8_t inWord;             // 1 if the letter is part of a word
+    uint8_t reserved;
+};
+
+
+/*
+ * One recognized word. Its letters are the records
+ * [firstLetter, firstLetter + nLetters) of the letter table.
+ */
+struct BINARY_WORD
+{
+    uint32_t imageId;           // line of the image in the image table
+    uint32_t cropId;            // number of the bBox image
+    int32_t left;               // the bBox of the word
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+    uint64_t firstLetter;       // index of the first letter in the letter table
+    uint32_t nLetters;          // number of letters in the word
+    uint16_t averageError;      // average error of the letters
+    uint16_t reserved;
+};
+
+static_assert(sizeof(BINARY_HEADER) == 64, "BINARY_HEADER must be 64 bytes");
+static_assert(sizeof(BINARY_LETTER) == 32, "BINARY_LETTER must be 32 bytes");
+static_assert(sizeof(BINARY_WORD) == 40, "BINARY_WORD must be 40 bytes");
+
+
+/*
+ * Opens a record file for appending. If the file already holds a table of
+ * the same kind, the number of records in it is read from its size;
+ * otherwise a new header is written. Returns NULL on failure.
+ *
+ * @param path: the record file
+ * @param magic: the magic string of the table
+ * @param recordSize: the size of one record
+ * @param count: set to the number of records already in the file
+ */
+extern FILE *openBinaryTable(std::string path, const char *magic,
+                             uint32_t recordSize, uint64_t &count);
+
+
+/*
+ * Writes the record count into the header of a record file and closes it.
+ *
+ * @param file: the record file, or NULL
+ * @param count: the number of records in the file
+ */
+extern void closeBinaryTable(FILE *file, uint64_t count);
+
+
+/*
+ * BINARY_SINK writes the letter, word and image tables of a run.
+ * Pages hand over their records with writePage(), in list order.
+ */
+class BINARY_SINK
+{
+private:
+
+    std::string prefix;
+    FILE *letterFile;
+    FILE *wordFile;
+    FILE *imageFile;
+
+    uint64_t nLetters;          // letter records in the letter table
+    uint64_t nWords;            // word records in the word table
+    uint32_t nImages;           // lines in the image table
+    bool failed;                // true once opening or writing failed
+
+    std::mutex lock;
+
+public:
+    // constructor, opens (or creates) the three files
+    BINARY_SINK(std::string filePrefix);
+
+    bool isOpen() { return !failed; }
+
+    // appends the records of one page. Word letter ranges are relative to
+    // the page's letters and get moved to the position in the letter table.
+    // Returns 0 on success.
+    int writePage(std::string imagePath, int pageNumber,
+                  std::string namePrefix,
+                  std::vector<BINARY_LETTER> &letters,
+                  std::vector<BINARY_WORD> &words);
+
+    uint64_t getLetterCount() { return nLetters; }
+    uint64_t getWordCount() { return nWords; }
+    uint32_t getImageCount() { return nImages; }
+
+    // writes everything buffered to the files (the header counts are only
+    // updated when the sink is closed)
+    void flush();
+
+    // destructor, writes the record counts into the headers and closes
+    ~BINARY_SINK();
+
+    BINARY_SINK(const BINARY_SINK &) = delete;
+    BINARY_SINK &operator=(const BINARY_SINK &) = delete;
+};
+
+#endif
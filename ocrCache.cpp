@@ -0,0 +1,301 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrCache.h
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <thread>
+#include <functional>
+
+
+using namespace std;
+
+
+/*
+ * Two 64-bit hashes of a byte stream, FNV-1a and a multiply-rotate hash,
+ * giving a 128-bit key. Neither is cryptographic; together they make an
+ * accidental collision between two scans practically impossible.
+ */
+struct CONTENT_HASH
+{
+    uint64_t fnv;
+    uint64_t mix;
+
+    CONTENT_HASH() : fnv(0xcbf29ce484222325ULL), mix(0x9e3779b97f4a7c15ULL) {}
+
+    void add(const unsigned char *bytes, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            fnv = (fnv ^ bytes[i]) * 0x100000001b3ULL;
+            mix = (mix ^ bytes[i]) * 0xff51afd7ed558ccdULL;
+            mix = (mix << 23) | (mix >> 41);
+        }
+    }
+
+    void add(const string &text)
+    {
+        add((const unsigned char *) text.c_str(), text.size() + 1);
+    }
+};
+
+
+/*
+ * RECOGNITION_CACHE constructor
+ *
+ * @param cacheDirectory: where the cache files are kept
+ * @param settingsKey: describes the recognition settings
+ */
+RECOGNITION_CACHE::RECOGNITION_CACHE(string cacheDirectory, string settingsKey)
+    : hits(0), misses(0)
+{
+    struct stat info;
+
+    directory = cacheDirectory;
+    settings = settingsKey;
+    if (!directory.empty() && directory[directory.size() - 1] != '/')
+    {
+        directory += '/';
+    }
+
+    if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+        printf("could not create cache directory %s\n", directory.c_str());
+    }
+    ready = (stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode));
+    if (!ready)
+    {
+        printf("cache directory %s is not usable\n", directory.c_str());
+    }
+}
+
+
+/*
+ * Sets digest to the hash of the bytes of an image file. Every file is read
+ * once per run: later pages of the file reuse the digest as long as the
+ * file's size and modification time are unchanged. Returns false if the
+ * file cannot be read.
+ *
+ * @param path: the image file
+ * @param digest: set to the hash of the file
+ */
+bool RECOGNITION_CACHE::getFileDigest(const string &path, FILE_DIGEST &digest)
+{
+    struct stat info;
+    CONTENT_HASH hash;
+    unsigned char block[65536];
+    size_t n;
+
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    {
+        lock_guard<mutex> guard(digestLock);
+        map<string, FILE_DIGEST>::iterator found = digests.find(path);
+        if (found != digests.end() &&
+            found->second.modified == info.st_mtime &&
+            found->second.size == info.st_size)
+        {
+            digest = found->second;
+            return true;
+        }
+    }
+
+    // hash without the lock, so other files are looked up meanwhile
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == NULL)
+    {
+        return false;
+    }
+    while ((n = fread(block, 1, sizeof(block), in)) > 0)
+    {
+        hash.add(block, n);
+    }
+    fclose(in);
+
+    digest.modified = info.st_mtime;
+    digest.size = info.st_size;
+    digest.fnv = hash.fnv;
+    digest.mix = hash.mix;
+
+    lock_guard<mutex> guard(digestLock);
+    digests[path] = digest;
+    return true;
+}
+
+
+/*
+ * Returns the cache file of the page: a hash of the bytes of the image
+ * file, the page number and the settings. Returns "" if the image file
+ * cannot be read.
+ *
+ * @param page: the page to look up
+ */
+string RECOGNITION_CACHE::getEntryPath(PAGE_CONTEXT &page)
+{
+    FILE_DIGEST digest;
+    CONTENT_HASH hash;
+    char name[48];
+
+    if (!getFileDigest(page.imageFile, digest))
+    {
+        return "";
+    }
+
+    // go on from the state after the file's bytes
+    hash.fnv = digest.fnv;
+    hash.mix = digest.mix;
+    hash.add(to_string(page.pageNumber));
+    hash.add(settings);
+
+    snprintf(name, sizeof(name), "%016llx%016llx.rec",
+             (unsigned long long) hash.fnv, (unsigned long long) hash.mix);
+    return directory + name;
+}
+
+
+/*
+ * Looks the page up. Returns 0 on a hit, 1 on a miss.
+ *
+ * @param page: a page that went through loadPage()
+ * @param status: set to what recognizePage() returned for the page
+ */
+int RECOGNITION_CACHE::lookup(PAGE_CONTEXT &page, int &status)
+{
+    CACHE_HEADER header;
+    FILE *in;
+
+    if (!ready)
+    {
+        return 1;
+    }
+
+    page.cacheEntry = getEntryPath(page);
+    in = NULL;
+    if (!page.cacheEntry.empty())
+    {
+        in = fopen(page.cacheEntry.c_str(), "rb");
+    }
+    if (in == NULL)
+    {
+        misses++;
+        return 1;
+    }
+
+    // an entry of another version, or made from a differently preprocessed
+    // page, is recognized again and overwritten
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, CACHE_MAGIC, 8) != 0 ||
+        header.version != CACHE_VERSION ||
+        header.letterSize != sizeof(LETTER) ||
+        header.info.Size.cx != page.info.Size.cx ||
+        header.info.Size.cy != page.info.Size.cy ||
+        header.info.BitsPerPixel != page.info.BitsPerPixel)
+    {
+        fclose(in);
+        misses++;
+        return 1;
+    }
+
+    page.cachedLetters.resize(header.nLetters);
+    if (header.nLetters > 0 &&
+        fread(&page.cachedLetters[0], sizeof(LETTER), header.nLetters, in)
+            != header.nLetters)
+    {
+        fclose(in);
+        page.cachedLetters.clear();
+        misses++;
+        return 1;
+    }
+    fclose(in);
+
+    page.pLetters = (header.nLetters > 0 ? &page.cachedLetters[0] : NULL);
+    page.nLetters = header.nLetters;
+    status = header.status;
+    hits++;
+    return 0;
+}
+
+
+/*
+ * Saves the recognition result of the page. The entry is written to a
+ * temporary file and renamed, so a reader never sees half an entry.
+ *
+ * @param page: a page that went through recognizePage()
+ * @param status: what recognizePage() returns for the page
+ */
+void RECOGNITION_CACHE::store(PAGE_CONTEXT &page, int status)
+{
+    CACHE_HEADER header;
+    string temporary;
+    FILE *out;
+    bool ok;
+
+    if (!ready || page.cacheEntry.empty())
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.version = CACHE_VERSION;
+    header.letterSize = sizeof(LETTER);
+    header.nLetters = page.nLetters;
+    header.status = status;
+    header.info = page.info;
+
+    temporary = page.cacheEntry + "." +
+                to_string(hash<thread::id>()(this_thread::get_id())) + ".tmp";
+    out = fopen(temporary.c_str(), "wb");
+    if (out == NULL)
+    {
+        return;
+    }
+    ok = (fwrite(&header, sizeof(header), 1, out) == 1);
+    if (ok && page.nLetters > 0)
+    {
+        ok = (fwrite(page.pLetters, sizeof(LETTER), page.nLetters, out) ==
+              (size_t) page.nLetters);
+    }
+    if (fclose(out) != 0)
+    {
+        ok = false;
+    }
+    if (!ok || rename(temporary.c_str(), page.cacheEntry.c_str()) != 0)
+    {
+        remove(temporary.c_str());
+    }
+}
+
+
+/*
+ * RECOGNITION_CACHE destructor
+ */
+RECOGNITION_CACHE::~RECOGNITION_CACHE()
+{
+    printf("recognition cache: %d hits, %d misses\n", (int) hits,
+           (int) misses);
+}
+
+
+/*
+ * Describes the recognition settings of a settings collection.
+ *
+ * @param sid: the settings collection used for recognition
+ */
+string describeSettings(int sid)
+{
+    RECOGNITIONMODULE module = RM_AUTO;
+
+    kRecGetDefaultRecognitionModule(sid, &module);
+    return "module=" + to_string((int) module) +
+           ";letter=" + to_string(sizeof(LETTER)) +
+           ";format=" + to_string(CACHE_VERSION);
+}
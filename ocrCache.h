@@ -0,0 +1,126 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrCache.cpp program
+ *
+ * Reruns over the same scans (with new to-find lists, say) recognize every
+ * page again. With a recognition cache (-c D), the LETTER array and the
+ * IMG_INFO of every recognized page are saved in the directory D, in a file
+ * named after a hash of the image file, the page number and the
+ * recognition settings. When the same page comes up again, recognizePage()
+ * reads the letters from the cache instead of locating zones and
+ * recognizing.
+ *
+ * The page is still loaded and preprocessed on a hit: the letter positions
+ * refer to the preprocessed image, and the bBoxes are cut out of it. The
+ * IMG_INFO of the preprocessed page must match the cached one, otherwise
+ * the entry is not used.
+ *
+ * A cache file is a CACHE_HEADER followed by nLetters LETTER structs, in the
+ * layout of the machine that wrote it.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_CACHE_H
+#define OCR_CACHE_H
+
+#include "ocrExtraction.h"
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <time.h>
+
+
+#define CACHE_MAGIC     "OCRRECCH"
+#define CACHE_VERSION   1
+
+
+/*
+ * The hash of an image file's bytes, kept so the pages of a multi-page
+ * file do not read the whole file again. It is used again only while the
+ * file keeps its size and modification time.
+ */
+struct FILE_DIGEST
+{
+    time_t modified;            // st_mtime when the file was hashed
+    off_t size;                 // st_size when the file was hashed
+    uint64_t fnv;               // the CONTENT_HASH state after the bytes
+    uint64_t mix;
+};
+
+
+/*
+ * The start of a cache file.
+ */
+struct CACHE_HEADER
+{
+    char magic[8];              // CACHE_MAGIC
+    uint32_t version;           // CACHE_VERSION
+    uint32_t letterSize;        // sizeof(LETTER)
+    uint32_t nLetters;          // LETTER structs after the header
+    int32_t status;             // what recognizePage() returned, 0 or 2
+    IMG_INFO info;              // the page info after preprocessing
+};
+
+
+class RECOGNITION_CACHE
+{
+private:
+
+    std::string directory;      // ends with '/'
+    std::string settings;       // describes the recognition settings
+    bool ready;                 // false if the directory is not usable
+    std::atomic<int> hits;
+    std::atomic<int> misses;
+    std::map<std::string, FILE_DIGEST> digests;     // by image path
+    std::mutex digestLock;
+
+    // hashes the image file once, returns false if it can not be read
+    bool getFileDigest(const std::string &path, FILE_DIGEST &digest);
+
+    std::string getEntryPath(PAGE_CONTEXT &page);
+
+public:
+    /*
+     * RECOGNITION_CACHE constructor. The directory is created if it does
+     * not exist.
+     *
+     * @param cacheDirectory: where the cache files are kept
+     * @param settingsKey: describes the recognition settings, see
+     *                     describeSettings()
+     */
+    RECOGNITION_CACHE(std::string cacheDirectory, std::string settingsKey);
+
+    bool isOpen() { return ready; }
+
+    /*
+     * Looks the page up and, on a hit, fills in page.pLetters (pointing
+     * into page.cachedLetters) and page.nLetters. The page must be loaded.
+     * Returns 0 on a hit and sets status to what recognizePage() returned
+     * when the entry was made; returns 1 on a miss.
+     */
+    int lookup(PAGE_CONTEXT &page, int &status);
+
+    /*
+     * Saves the recognition result of the page. status is what
+     * recognizePage() returns for it (0, or 2 if there was no text).
+     */
+    void store(PAGE_CONTEXT &page, int status);
+
+    // destructor, prints the number of hits and misses
+    ~RECOGNITION_CACHE();
+
+    RECOGNITION_CACHE(const RECOGNITION_CACHE &) = delete;
+    RECOGNITION_CACHE &operator=(const RECOGNITION_CACHE &) = delete;
+};
+
+
+/*
+ * Describes the recognition settings of a settings collection, so cache
+ * entries made with other settings are not used.
+ *
+ * @param sid: the settings collection used for recognition
+ */
+extern std::string describeSettings(int sid);
+
+#endif
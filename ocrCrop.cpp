@@ -0,0 +1,896 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrCrop.h
+ *
+ * Cutting crops out of a page bitmap in memory, the crop sinks (files,
+ * packed archive, callback), and small TIFF, PNG and PGM writers so that
+ * crops can be saved without going through the engine.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrCrop.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+
+using namespace std;
+
+
+/*
+ * Only whole-byte gray and color samples and packed black and white pixels
+ * are cut, palette bitmaps would need their colors looked up.
+ */
+bool canCutBitmap(const IMG_INFO &info)
+{
+    int bpp = info.BitsPerPixel;
+
+    return !info.IsPalette && (bpp == 1 || bpp == 8 || bpp == 24);
+}
+
+
+/*
+ * Cuts a rectangle out of a page bitmap. The rectangle is clipped to the
+ * page. This function returns 0 on success.
+ *
+ * @param pixels: the page bitmap, rows top to bottom
+ * @param info: size, resolution and layout of the page bitmap
+ * @param rect: the rectangle to cut out (right and bottom are exclusive)
+ * @param crop: filled with the cut image, crop.name is not touched
+ */
+int cutCrop(const BYTE *pixels, const IMG_INFO &info, RECT rect,
+            OCR_CROP &crop)
+{
+    int bpp = info.BitsPerPixel;
+
+    if (pixels == NULL || !canCutBitmap(info))
+    {
+        return 1;
+    }
+
+    // clip the rectangle to the page
+    if (rect.left < 0) rect.left = 0;
+    if (rect.top < 0) rect.top = 0;
+    if (rect.right > info.Size.cx) rect.right = info.Size.cx;
+    if (rect.bottom > info.Size.cy) rect.bottom = info.Size.cy;
+    if (rect.right <= rect.left || rect.bottom <= rect.top)
+    {
+        return 1;
+    }
+
+    crop.width = rect.right - rect.left;
+    crop.height = rect.bottom - rect.top;
+    crop.bitsPerPixel = bpp;
+    crop.bytesPerLine = (crop.width * bpp + 7) / 8;
+    crop.dpiX = info.DPI.cx;
+    crop.dpiY = info.DPI.cy;
+    crop.pixels.resize((size_t) crop.bytesPerLine * crop.height);
+
+    for (int y = 0; y < crop.height; y++)
+    {
+        const BYTE *src = pixels + (size_t) (rect.top + y) * info.BytesPerLine;
+        BYTE *dst = &crop.pixels[(size_t) y * crop.bytesPerLine];
+
+        if (bpp != 1)
+        {
+            memcpy(dst, src + rect.left * (bpp / 8), crop.bytesPerLine);
+            continue;
+        }
+
+        // black and white: move the bits so the crop starts at bit 7
+        int shift = rect.left % 8;
+        int first = rect.left / 8;
+        for (int i = 0; i < crop.bytesPerLine; i++)
+        {
+            BYTE value = src[first + i] << shift;
+            if (shift != 0 && first + i + 1 < info.BytesPerLine)
+            {
+                value |= src[first + i + 1] >> (8 - shift);
+            }
+            dst[i] = value;
+        }
+        // clear the padding bits after the last pixel
+        int used = crop.width % 8;
+        if (used != 0)
+        {
+            dst[crop.bytesPerLine - 1] &= (BYTE) (0xFF << (8 - used));
+        }
+    }
+    return 0;
+}
+
+
+// little-endian helpers for the TIFF writer
+static void put16(string &out, unsigned int value)
+{
+    out += (char) (value & 0xFF);
+    out += (char) ((value >> 8) & 0xFF);
+}
+
+static void put32(string &out, unsigned long value)
+{
+    put16(out, value & 0xFFFF);
+    put16(out, (value >> 16) & 0xFFFF);
+}
+
+// one 12 byte IFD entry of type SHORT (3) or LONG (4) / RATIONAL (5)
+static void putEntry(string &out, unsigned int tag, unsigned int type,
+                     unsigned long count, unsigned long value)
+{
+    put16(out, tag);
+    put16(out, type);
+    put32(out, count);
+    if (type == 3 && count == 1)
+    {
+        put16(out, value);
+        put16(out, 0);
+    }
+    else
+    {
+        put32(out, value);
+    }
+}
+
+
+/*
+ * Appends one row packbits compressed: runs of 2 to 128 equal bytes become
+ * a count byte 1 - n and the byte, other bytes are copied in blocks of up
+ * to 128 after a count byte n - 1.
+ *
+ * @param row: the bytes of the row
+ * @param n: the number of bytes
+ * @param out: where the compressed row is appended
+ */
+static void packBits(const BYTE *row, int n, string &out)
+{
+    int i = 0;
+
+    while (i < n)
+    {
+        int run = 1;
+        while (i + run < n && run < 128 && row[i + run] == row[i])
+        {
+            run++;
+        }
+        if (run >= 2)
+        {
+            out += (char) (1 - run);
+            out += (char) row[i];
+            i += run;
+            continue;
+        }
+
+        // copy bytes until a run of 3 starts, a run of 2 is cheaper inside
+        int start = i++;
+        while (i < n && i - start < 128 &&
+               !(i + 2 < n && row[i] == row[i + 1] && row[i] == row[i + 2]))
+        {
+            i++;
+        }
+        out += (char) (i - start - 1);
+        out.append((const char *) row + start, i - start);
+    }
+}
+
+
+/*
+ * Encodes a crop as a baseline TIFF file with a single strip, uncompressed
+ * or packbits compressed (every row on its own, as the TIFF spec asks).
+ * Black and white crops are written as WhiteIsZero, like the engine's own
+ * bitmaps (a set bit is a black pixel).
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param out: the bytes of the TIFF file
+ * @param packbits: true to compress the pixels with packbits
+ */
+int encodeTiff(const OCR_CROP &crop, string &out, bool packbits)
+{
+    const int nEntries = 13;
+    unsigned long imageSize = (unsigned long) crop.bytesPerLine * crop.height;
+    const char *image = (const char *) crop.pixels.data();
+    string packed;
+    unsigned long ifdOffset = 8;
+    unsigned long ifdSize = 2 + nEntries * 12 + 4;
+    unsigned long bitsOffset = ifdOffset + ifdSize;        // 3 SHORTs
+    unsigned long xResOffset = bitsOffset + 6;             // RATIONAL
+    unsigned long yResOffset = xResOffset + 8;             // RATIONAL
+    unsigned long dataOffset = yResOffset + 8;
+    int samples = (crop.bitsPerPixel == 24 ? 3 : 1);
+
+    if (crop.bitsPerPixel != 1 && crop.bitsPerPixel != 8 &&
+        crop.bitsPerPixel != 24)
+    {
+        return 1;
+    }
+
+    if (packbits)
+    {
+        packed.reserve(imageSize + imageSize / 64 + crop.height);
+        for (int y = 0; y < crop.height; y++)
+        {
+            packBits(&crop.pixels[(size_t) y * crop.bytesPerLine],
+                     crop.bytesPerLine, packed);
+        }
+        image = packed.data();
+        imageSize = packed.size();
+    }
+
+    out.clear();
+    out.reserve(dataOffset + imageSize);
+
+    // header: little-endian, magic 42, offset of the first IFD
+    out += "II";
+    put16(out, 42);
+    put32(out, ifdOffset);
+
+    // the IFD, tags in ascending order
+    put16(out, nEntries);
+    putEntry(out, 256, 4, 1, crop.width);                  // ImageWidth
+    putEntry(out, 257, 4, 1, crop.height);                 // ImageLength
+    if (samples == 3)
+    {
+        putEntry(out, 258, 3, 3, bitsOffset);              // BitsPerSample
+    }
+    else
+    {
+        putEntry(out, 258, 3, 1, crop.bitsPerPixel);
+    }
+    putEntry(out, 259, 3, 1, packbits ? 32773 : 1);        // Compression
+    putEntry(out, 262, 3, 1,                               // Photometric
+             crop.bitsPerPixel == 1 ? 0 : (samples == 3 ? 2 : 1));
+    putEntry(out, 273, 4, 1, dataOffset);                  // StripOffsets
+    putEntry(out, 277, 3, 1, samples);                     // SamplesPerPixel
+    putEntry(out, 278, 4, 1, crop.height);                 // RowsPerStrip
+    putEntry(out, 279, 4, 1, imageSize);                   // StripByteCounts
+    putEntry(out, 282, 5, 1, xResOffset);                  // XResolution
+    putEntry(out, 283, 5, 1, yResOffset);                  // YResolution
+    putEntry(out, 284, 3, 1, 1);                           // PlanarConfig
+    putEntry(out, 296, 3, 1, 2);                           // inches
+    put32(out, 0);                                         // no next IFD
+
+    // values that do not fit into the entries
+    put16(out, 8);
+    put16(out, 8);
+    put16(out, 8);
+    put32(out, crop.dpiX > 0 ? crop.dpiX : 300);
+    put32(out, 1);
+    put32(out, crop.dpiY > 0 ? crop.dpiY : 300);
+    put32(out, 1);
+
+    out.append(image, imageSize);
+    return 0;
+}
+
+
+// big-endian helpers for the PNG writer
+static void put32BE(string &out, unsigned long value)
+{
+    out += (char) ((value >> 24) & 0xFF);
+    out += (char) ((value >> 16) & 0xFF);
+    out += (char) ((value >> 8) & 0xFF);
+    out += (char) (value & 0xFF);
+}
+
+// one PNG chunk: length, type, data and the CRC of type and data
+static void putChunk(string &out, const char *type, const string &data)
+{
+    put32BE(out, data.size());
+    size_t start = out.size();
+    out.append(type, 4);
+    out += data;
+    put32BE(out, crc32(0, (const Bytef *) out.data() + start,
+                       out.size() - start));
+}
+
+// the Paeth predictor of the PNG spec
+static int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+    {
+        return a;
+    }
+    return (pb <= pc ? b : c);
+}
+
+
+/*
+ * Encodes a crop as a PNG file. Black and white crops are 1-bit grayscale
+ * (a set bit in the crop is a black pixel, a 0 in the PNG) and are not
+ * filtered; gray and color rows get the filter with the smallest sum of
+ * absolute differences, the heuristic the PNG spec suggests.
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param out: the bytes of the PNG file
+ */
+int encodePng(const OCR_CROP &crop, string &out)
+{
+    int bpp = crop.bitsPerPixel;
+    int pixelBytes = (bpp == 24 ? 3 : 1);
+    size_t rowBytes = crop.bytesPerLine;
+    string header;
+    string filtered;
+    string physical;
+
+    if (bpp != 1 && bpp != 8 && bpp != 24)
+    {
+        return 1;
+    }
+
+    // every row is a filter type byte and the filtered bytes
+    filtered.resize((rowBytes + 1) * crop.height);
+    vector<BYTE> candidate[4];
+    for (int f = 0; f < 4; f++)
+    {
+        candidate[f].resize(rowBytes);
+    }
+    for (int y = 0; y < crop.height; y++)
+    {
+        const BYTE *row = &crop.pixels[y * rowBytes];
+        const BYTE *up = (y > 0 ? &crop.pixels[(y - 1) * rowBytes] : NULL);
+        char *dst = &filtered[y * (rowBytes + 1)];
+
+        if (bpp == 1)
+        {
+            dst[0] = 0;
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                dst[i + 1] = (char) (row[i] ^ 0xFF);
+            }
+            continue;
+        }
+
+        // None, Sub, Up, Paeth (Average is rarely the best and left out)
+        long cost[4] = {0, 0, 0, 0};
+        for (size_t i = 0; i < rowBytes; i++)
+        {
+            int left = (i >= (size_t) pixelBytes ? row[i - pixelBytes] : 0);
+            int above = (up != NULL ? up[i] : 0);
+            int corner = (up != NULL && i >= (size_t) pixelBytes ?
+                          up[i - pixelBytes] : 0);
+            candidate[0][i] = row[i];
+            candidate[1][i] = (BYTE) (row[i] - left);
+            candidate[2][i] = (BYTE) (row[i] - above);
+            candidate[3][i] = (BYTE) (row[i] - paeth(left, above, corner));
+            for (int f = 0; f < 4; f++)
+            {
+                cost[f] += abs((signed char) candidate[f][i]);
+            }
+        }
+        int best = 0;
+        for (int f = 1; f < 4; f++)
+        {
+            if (cost[f] < cost[best])
+            {
+                best = f;
+            }
+        }
+        static const char filterType[4] = {0, 1, 2, 4};
+        dst[0] = filterType[best];
+        memcpy(dst + 1, &candidate[best][0], rowBytes);
+    }
+
+    uLongf packedSize = compressBound(filtered.size());
+    string packed(packedSize, '\0');
+    if (compress2((Bytef *) &packed[0], &packedSize,
+                  (const Bytef *) filtered.data(), filtered.size(),
+                  Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+        return 1;
+    }
+    packed.resize(packedSize);
+
+    put32BE(header, crop.width);
+    put32BE(header, crop.height);
+    header += (char) (bpp == 1 ? 1 : 8);                    // bit depth
+    header += (char) (bpp == 24 ? 2 : 0);                   // color type
+    header += (char) 0;                                     // deflate
+    header += (char) 0;                                     // filter method
+    header += (char) 0;                                     // no interlace
+
+    // the resolution in pixels per meter
+    put32BE(physical, (unsigned long) ((crop.dpiX > 0 ? crop.dpiX : 300) /
+                                       0.0254 + 0.5));
+    put32BE(physical, (unsigned long) ((crop.dpiY > 0 ? crop.dpiY : 300) /
+                                       0.0254 + 0.5));
+    physical += (char) 1;
+
+    out.assign("\x89PNG\r\n\x1a\n", 8);
+    putChunk(out, "IHDR", header);
+    putChunk(out, "pHYs", physical);
+    putChunk(out, "IDAT", packed);
+    putChunk(out, "IEND", "");
+    return 0;
+}
+
+
+/*
+ * Encodes a crop as an 8-bit grayscale binary PGM file.
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param out: the bytes of the PGM file
+ */
+int encodeRaw(const OCR_CROP &crop, string &out)
+{
+    char header[64];
+    int bpp = crop.bitsPerPixel;
+
+    if (bpp != 1 && bpp != 8 && bpp != 24)
+    {
+        return 1;
+    }
+
+    snprintf(header, sizeof(header), "P5\n%d %d\n255\n", crop.width,
+             crop.height);
+    out.assign(header);
+    size_t start = out.size();
+    out.resize(start + (size_t) crop.width * crop.height);
+
+    char *dst = &out[start];
+    for (int y = 0; y < crop.height; y++)
+    {
+        const BYTE *row = &crop.pixels[(size_t) y * crop.bytesPerLine];
+        for (int x = 0; x < crop.width; x++)
+        {
+            if (bpp == 1)
+            {
+                *dst++ = ((row[x / 8] >> (7 - x % 8)) & 1) ? 0 : (char) 255;
+            }
+            else if (bpp == 8)
+            {
+                *dst++ = (char) row[x];
+            }
+            else
+            {
+                const BYTE *rgb = row + 3 * x;
+                *dst++ = (char) ((299 * rgb[0] + 587 * rgb[1] +
+                                  114 * rgb[2] + 500) / 1000);
+            }
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Encodes a crop in the given format. This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param format: the file format
+ * @param out: the bytes of the file
+ */
+int encodeCrop(const OCR_CROP &crop, CROP_FORMAT format, string &out)
+{
+    switch (format)
+    {
+    case CROP_TIFF_PACKBITS:
+        return encodeTiff(crop, out, true);
+    case CROP_PNG:
+        return encodePng(crop, out);
+    case CROP_RAW:
+        return encodeRaw(crop, out);
+    default:
+        return encodeTiff(crop, out, false);
+    }
+}
+
+
+/*
+ * Returns the file extension of a format, with the dot.
+ *
+ * @param format: the file format
+ */
+const char *getCropExtension(CROP_FORMAT format)
+{
+    switch (format)
+    {
+    case CROP_PNG:
+        return ".png";
+    case CROP_RAW:
+        return ".pgm";
+    default:
+        return ".tiff";
+    }
+}
+
+
+/*
+ * Returns the engine's IMF_FORMAT for a format.
+ *
+ * @param format: the file format
+ */
+IMF_FORMAT getEngineFormat(CROP_FORMAT format)
+{
+    switch (format)
+    {
+    case CROP_TIFF_PACKBITS:
+        return FF_TIFPB;
+    case CROP_PNG:
+        return FF_PNG;
+    default:
+        return FF_TIFNO;
+    }
+}
+
+
+/*
+ * Reads the name of a format. This function returns 0 on success.
+ *
+ * @param name: tiff, packbits, png or raw
+ * @param format: set to the format
+ */
+int parseCropFormat(string name, CROP_FORMAT &format)
+{
+    if (name == "tiff") { format = CROP_TIFF; }
+    else if (name == "packbits") { format = CROP_TIFF_PACKBITS; }
+    else if (name == "png") { format = CROP_PNG; }
+    else if (name == "raw") { format = CROP_RAW; }
+    else
+    {
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * ____________________________________________________________________________
+ *  Definitions for class: FILE_CROP_SINK
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * FILE_CROP_SINK constructor, starts the encoder threads.
+ *
+ * @param outputDirectory: where to write the files, "" for the working
+ *                         directory
+ * @param cropFormat: the file format
+ * @param nEncoders: encoder threads, 0 to encode in write()
+ */
+FILE_CROP_SINK::FILE_CROP_SINK(string outputDirectory, CROP_FORMAT cropFormat,
+                               int nEncoders)
+    : format(cropFormat), busy(0), nFailed(0), stopping(false)
+{
+    directory = outputDirectory;
+    if (!directory.empty() && directory[directory.size() - 1] != '/')
+    {
+        directory += '/';
+    }
+    for (int e = 0; e < nEncoders; e++)
+    {
+        encoders.push_back(thread(&FILE_CROP_SINK::encodeCrops, this));
+    }
+}
+
+
+/*
+ * Writes the crop to "<directory><name><extension>", or queues it for the
+ * encoder threads. Returns 0 on success.
+ *
+ * @param crop: the crop to write
+ * @param ref: set to the name of the crop
+ */
+int FILE_CROP_SINK::write(const OCR_CROP &crop, string &ref)
+{
+    if (encoders.empty())
+    {
+        if (writeFile(crop) != 0)
+        {
+            return 1;
+        }
+        ref = crop.name;
+        return 0;
+    }
+
+    // wait while the queue is full, so the pages cannot run away from the
+    // encoders with all their crops in memory
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&]() { return queue.size() < ENCODER_QUEUE_SIZE; });
+    queue.push_back(crop);
+    queued.notify_one();
+
+    ref = crop.name;
+    return 0;
+}
+
+
+/*
+ * The loop of an encoder thread: takes crops from the queue and writes
+ * them until the sink is deleted.
+ */
+void FILE_CROP_SINK::encodeCrops()
+{
+    unique_lock<mutex> guard(lock);
+
+    while (true)
+    {
+        queued.wait(guard, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+        {
+            return;
+        }
+        OCR_CROP crop = std::move(queue.front());
+        queue.pop_front();
+        busy++;
+        done.notify_all();
+
+        guard.unlock();
+        int err = writeFile(crop);
+        guard.lock();
+
+        busy--;
+        if (err != 0)
+        {
+            nFailed++;
+            nLost++;
+        }
+        done.notify_all();
+    }
+}
+
+
+/*
+ * Waits until every queued crop is written, and reports the files the
+ * encoders could not write since the last flush.
+ */
+void FILE_CROP_SINK::flush()
+{
+    unique_lock<mutex> guard(lock);
+
+    done.wait(guard, [&]() { return queue.empty() && busy == 0; });
+    if (nFailed > 0)
+    {
+        printf("%d bBox images could not be written\n", nFailed);
+        nFailed = 0;
+    }
+}
+
+
+/*
+ * FILE_CROP_SINK destructor, writes the queued crops and stops the
+ * encoder threads.
+ */
+FILE_CROP_SINK::~FILE_CROP_SINK()
+{
+    if (encoders.empty())
+    {
+        return;
+    }
+    flush();
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+    for (size_t e = 0; e < encoders.size(); e++)
+    {
+        encoders[e].join();
+    }
+}
+
+
+/*
+ * Encodes the crop and writes it to "<directory><name><extension>".
+ * Returns 0 on success.
+ *
+ * @param crop: the crop to write
+ */
+int FILE_CROP_SINK::writeFile(const OCR_CROP &crop)
+{
+    string data;
+    string path = directory + crop.name + getCropExtension(format);
+
+    if (encodeCrop(crop, format, data) != 0)
+    {
+        return 1;
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+    {
+        printf("could not create %s\n", path.c_str());
+        return 1;
+    }
+    size_t written = fwrite(data.data(), 1, data.size(), file);
+    if (fclose(file) != 0 || written != data.size())
+    {
+        printf("could not write %s\n", path.c_str());
+        return 1;
+    }
+    bytesWritten += data.size();
+    return 0;
+}
+
+
+/*
+ * ____________________________________________________________________________
+ *  Definitions for class: CALLBACK_CROP_SINK
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * CALLBACK_CROP_SINK constructor
+ *
+ * @param cropCallback: the function every crop is handed to
+ */
+CALLBACK_CROP_SINK::CALLBACK_CROP_SINK(CROP_CALLBACK cropCallback)
+{
+    callback = cropCallback;
+}
+
+
+/*
+ * Hands the crop to the callback. Returns what the callback returns.
+ *
+ * @param crop: the crop
+ * @param ref: set by the callback
+ */
+int CALLBACK_CROP_SINK::write(const OCR_CROP &crop, string &ref)
+{
+    ref = crop.name;
+    return callback(crop, ref);
+}
+
+
+/*
+ * ____________________________________________________________________________
+ *  Definitions for class: ARCHIVE_CROP_SINK
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * ARCHIVE_CROP_SINK constructor
+ *
+ * @param filePrefix: the packs are <filePrefix>-<k>.pack, the index is
+ *                    <filePrefix>.idx
+ * @param maxPackSize: start a new pack once a pack holds this many bytes
+ */
+ARCHIVE_CROP_SINK::ARCHIVE_CROP_SINK(string filePrefix, uint64_t maxPackSize)
+{
+    prefix = filePrefix;
+    packSize = maxPackSize;
+    packNumber = -1;
+    packFile = NULL;
+    packOffset = 0;
+    failed = false;
+
+    indexFile = fopen((prefix + ".idx").c_str(), "a");
+    if (indexFile == NULL || openPack() != 0)
+    {
+        printf("could not open archive %s\n", prefix.c_str());
+        failed = true;
+    }
+}
+
+
+/*
+ * Closes the current pack and opens the next one that still has room.
+ * Packs left by earlier runs are continued. Returns 0 on success.
+ */
+int ARCHIVE_CROP_SINK::openPack()
+{
+    if (packFile != NULL)
+    {
+        fclose(packFile);
+        packFile = NULL;
+    }
+
+    while (packFile == NULL)
+    {
+        packNumber++;
+        packName = prefix + "-" + to_string(packNumber) + ".pack";
+        packFile = fopen(packName.c_str(), "ab");
+        if (packFile == NULL)
+        {
+            return 1;
+        }
+        fseek(packFile, 0, SEEK_END);
+        packOffset = ftell(packFile);
+        if (packOffset >= packSize)
+        {
+            fclose(packFile);
+            packFile = NULL;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Appends the crop to the current pack and its line to the index.
+ * Returns 0 on success.
+ *
+ * @param crop: the crop to store
+ * @param ref: set to "<pack>@<offset>"
+ */
+int ARCHIVE_CROP_SINK::write(const OCR_CROP &crop, string &ref)
+{
+    ARCHIVE_CROP_HEADER header;
+    size_t imageSize = (size_t) crop.bytesPerLine * crop.height;
+
+    header.width = crop.width;
+    header.height = crop.height;
+    header.bitsPerPixel = crop.bitsPerPixel;
+    header.dpiX = crop.dpiX;
+    header.dpiY = crop.dpiY;
+    header.reserved = 0;
+
+    lock_guard<mutex> guard(lock);
+
+    if (failed)
+    {
+        return 1;
+    }
+    if (packOffset > 0 && packOffset + sizeof(header) + imageSize > packSize &&
+        openPack() != 0)
+    {
+        printf("could not open archive %s\n", packName.c_str());
+        failed = true;
+        return 1;
+    }
+
+    if (fwrite(&header, sizeof(header), 1, packFile) != 1 ||
+        fwrite(crop.pixels.data(), 1, imageSize, packFile) != imageSize)
+    {
+        printf("could not write archive %s\n", packName.c_str());
+        failed = true;
+        return 1;
+    }
+
+    // the ref names the pack without its directory, like the index does
+    size_t slash = packName.rfind('/');
+    ref = packName.substr(slash == string::npos ? 0 : slash + 1) + "@" +
+          to_string(packOffset);
+    int indexBytes = fprintf(indexFile, "%s\t%s\t%lu\n", crop.name.c_str(),
+                             ref.c_str(),
+                             (unsigned long) (sizeof(header) + imageSize));
+
+    packOffset += sizeof(header) + imageSize;
+    bytesWritten += sizeof(header) + imageSize + max(indexBytes, 0);
+    return 0;
+}
+
+
+/*
+ * Flushes the pack and the index.
+ */
+void ARCHIVE_CROP_SINK::flush()
+{
+    lock_guard<mutex> guard(lock);
+
+    if (packFile != NULL)
+    {
+        fflush(packFile);
+    }
+    if (indexFile != NULL)
+    {
+        fflush(indexFile);
+    }
+}
+
+
+/*
+ * ARCHIVE_CROP_SINK destructor, closes the pack and the index.
+ */
+ARCHIVE_CROP_SINK::~ARCHIVE_CROP_SINK()
+{
+    if (packFile != NULL)
+    {
+        fclose(packFile);
+    }
+    if (indexFile != NULL)
+    {
+        fclose(indexFile);
+    }
+}
@@ -0,0 +1,342 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrCrop.cpp program
+ *
+ * Instead of asking the engine to save every bBox with kRecSaveImgAreaF, we
+ * can get the bitmap of the whole page once and cut the bBoxes out of it in
+ * memory. The cut images (crops) are handed to a CROP_SINK, which decides
+ * where they go: into their own files, into a packed archive, or to a
+ * callback.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_CROP_H
+#define OCR_CROP_H
+
+#include "KernelApi.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <atomic>
+
+
+#define ARCHIVE_PACK_SIZE   (1u << 30)  // start a new pack file after 1 GiB
+#define ENCODER_QUEUE_SIZE  256         // crops waiting for the encoders
+
+
+/*
+ * One image cut out of the page bitmap. Rows are stored top to bottom and
+ * padded to whole bytes only (no extra alignment).
+ */
+struct OCR_CROP
+{
+    std::string name;           // name of the crop without extension, "l-12"
+    int width;                  // size in pixels
+    int height;
+    int bitsPerPixel;           // 1 (black and white), 8 (gray) or 24 (color)
+    int bytesPerLine;           // (width * bitsPerPixel + 7) / 8
+    int dpiX;                   // resolution of the page
+    int dpiY;
+    std::vector<BYTE> pixels;   // bytesPerLine * height bytes
+};
+
+
+/*
+ * The file formats bBox images can be written in (-f).
+ */
+enum CROP_FORMAT
+{
+    CROP_TIFF,                  // uncompressed TIFF, "<name>.tiff" (default)
+    CROP_TIFF_PACKBITS,         // packbits compressed TIFF, "<name>.tiff"
+    CROP_PNG,                   // PNG, "<name>.png"
+    CROP_RAW                    // 8-bit grayscale binary PGM, "<name>.pgm";
+                                // only for crops cut in memory (-m)
+};
+
+
+/*
+ * Where crops go. write() gets a finished crop and sets ref to the name
+ * that the letter/word records should use for it. Sinks that are used by
+ * several worker threads must be thread-safe.
+ */
+class CROP_SINK
+{
+protected:
+
+    std::atomic<long long> bytesWritten;    // bytes of image files, packs
+                                            // and indexes written so far
+    std::atomic<long long> nLost;           // crops write() took that could
+                                            // not be stored later on
+
+public:
+    CROP_SINK() : bytesWritten(0), nLost(0) {}
+
+    // stores the crop, returns 0 on success
+    virtual int write(const OCR_CROP &crop, std::string &ref) = 0;
+
+    // finishes any pending work
+    virtual void flush() {}
+
+    // the bytes the sink has written to disk so far
+    virtual long long getBytesWritten() { return bytesWritten; }
+
+    // the crops write() returned 0 for that were not stored after all,
+    // complete after flush()
+    virtual long long getLostCrops() { return nLost; }
+
+    virtual ~CROP_SINK() {}
+};
+
+
+/*
+ * Writes each crop into its own file in the given directory, in one of the
+ * CROP_FORMATs. The ref of a crop is its name, like the names given by
+ * kRecSaveImgAreaF exports.
+ *
+ * With encoder threads, write() only queues a copy of the crop and returns;
+ * the threads compress and write the files, so encoding does not hold up
+ * the page workers. Since the ref does not depend on the file, the records
+ * can be written before the file is. Files that cannot be written are
+ * reported by flush(), which waits for the queue to drain, and counted in
+ * getLostCrops().
+ */
+class FILE_CROP_SINK : public CROP_SINK
+{
+private:
+
+    std::string directory;      // "" for the working directory
+    CROP_FORMAT format;
+
+    // the encoder pool, empty to encode in write()
+    std::vector<std::thread> encoders;
+    std::deque<OCR_CROP> queue; // crops waiting to be encoded
+    int busy;                   // crops being encoded right now
+    int nFailed;                // files the encoders could not write
+    bool stopping;
+    std::mutex lock;
+    std::condition_variable queued;     // a crop was queued, or stopping
+    std::condition_variable done;       // a crop was taken or written
+
+    // encodes and writes one file, returns 0 on success
+    int writeFile(const OCR_CROP &crop);
+
+    void encodeCrops();
+
+public:
+    /*
+     * FILE_CROP_SINK constructor
+     *
+     * @param outputDirectory: where to write the files, "" for the working
+     *                         directory
+     * @param cropFormat: the file format
+     * @param nEncoders: encoder threads, 0 to encode in write()
+     */
+    FILE_CROP_SINK(std::string outputDirectory = "",
+                   CROP_FORMAT cropFormat = CROP_TIFF, int nEncoders = 0);
+
+    int write(const OCR_CROP &crop, std::string &ref);
+
+    // waits until every queued crop is written
+    void flush();
+
+    // destructor, writes the queued crops and stops the encoders
+    ~FILE_CROP_SINK();
+
+    FILE_CROP_SINK(const FILE_CROP_SINK &) = delete;
+    FILE_CROP_SINK &operator=(const FILE_CROP_SINK &) = delete;
+};
+
+
+/*
+ * Hands each crop to a function in the same process, e.g. to feed a
+ * training job without touching the disk. The function returns 0 on
+ * success and sets the ref.
+ */
+class CALLBACK_CROP_SINK : public CROP_SINK
+{
+public:
+    typedef std::function<int(const OCR_CROP &crop, std::string &ref)>
+            CROP_CALLBACK;
+
+private:
+
+    CROP_CALLBACK callback;
+
+public:
+    CALLBACK_CROP_SINK(CROP_CALLBACK cropCallback);
+
+    int write(const OCR_CROP &crop, std::string &ref);
+};
+
+
+/*
+ * The header in front of every crop in a pack file. The pixels follow
+ * right after it, (width * bitsPerPixel + 7) / 8 bytes per row, rows top
+ * to bottom.
+ */
+struct ARCHIVE_CROP_HEADER
+{
+    uint32_t width;
+    uint32_t height;
+    uint16_t bitsPerPixel;      // 1, 8 or 24
+    uint16_t dpiX;
+    uint16_t dpiY;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(ARCHIVE_CROP_HEADER) == 16,
+              "ARCHIVE_CROP_HEADER must be 16 bytes");
+
+
+/*
+ * Packs all crops of a run into a few large files instead of one file per
+ * crop:
+ *
+ *      <prefix>-<k>.pack : ARCHIVE_CROP_HEADER + raw pixels, one after the
+ *                          other; a new pack is started once a pack holds
+ *                          packSize bytes
+ *      <prefix>.idx      : one line per crop, "<name>\t<ref>\t<bytes>"
+ *
+ * The ref of a crop is "<pack>@<offset>": the file name of its pack
+ * (without directory) and the offset of its header in the pack. This is
+ * what the letter/word records refer to instead of an image name.
+ * Running again with the same prefix appends. write() is thread-safe.
+ */
+class ARCHIVE_CROP_SINK : public CROP_SINK
+{
+private:
+
+    std::string prefix;
+    uint64_t packSize;          // size at which a new pack is started
+    int packNumber;             // k of the pack being written
+    std::string packName;       // file name of the pack being written
+    FILE *packFile;
+    uint64_t packOffset;        // bytes in the pack being written
+    FILE *indexFile;
+    bool failed;
+
+    std::mutex lock;
+
+    // opens the next pack that still has room, returns 0 on success
+    int openPack();
+
+public:
+    // constructor, opens the index and the first pack with room
+    ARCHIVE_CROP_SINK(std::string filePrefix,
+                      uint64_t maxPackSize = ARCHIVE_PACK_SIZE);
+
+    bool isOpen() { return !failed; }
+
+    int write(const OCR_CROP &crop, std::string &ref);
+
+    void flush();
+
+    // destructor, flushes and closes the files
+    ~ARCHIVE_CROP_SINK();
+
+    ARCHIVE_CROP_SINK(const ARCHIVE_CROP_SINK &) = delete;
+    ARCHIVE_CROP_SINK &operator=(const ARCHIVE_CROP_SINK &) = delete;
+};
+
+
+/*
+ * Tells whether cutCrop() can cut rectangles out of a bitmap of the given
+ * format: only 1, 8 and 24 bits per pixel without palette are supported.
+ *
+ * @param info: the layout of the bitmap
+ */
+extern bool canCutBitmap(const IMG_INFO &info);
+
+
+/*
+ * Cuts a rectangle out of a page bitmap. The rectangle is clipped to the
+ * page. This function returns 0 on success and 1 if the rectangle is empty
+ * or the bitmap format is not supported (see canCutBitmap).
+ *
+ * @param pixels: the page bitmap, rows top to bottom
+ * @param info: size, resolution and layout of the page bitmap
+ * @param rect: the rectangle to cut out (right and bottom are exclusive)
+ * @param crop: filled with the cut image, crop.name is not touched
+ */
+extern int cutCrop(const BYTE *pixels, const IMG_INFO &info, RECT rect,
+                   OCR_CROP &crop);
+
+
+/*
+ * Encodes a crop as a baseline TIFF file, uncompressed or packbits
+ * compressed. This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param out: the bytes of the TIFF file
+ * @param packbits: true to compress the pixels with packbits
+ */
+extern int encodeTiff(const OCR_CROP &crop, std::string &out,
+                      bool packbits = false);
+
+
+/*
+ * Encodes a crop as a PNG file (zlib compressed).
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param out: the bytes of the PNG file
+ */
+extern int encodePng(const OCR_CROP &crop, std::string &out);
+
+
+/*
+ * Encodes a crop as an 8-bit grayscale binary PGM file: black and white
+ * pixels become 0 and 255, color pixels their luma.
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param out: the bytes of the PGM file
+ */
+extern int encodeRaw(const OCR_CROP &crop, std::string &out);
+
+
+/*
+ * Encodes a crop in the given format. This function returns 0 on success.
+ *
+ * @param crop: the crop to encode
+ * @param format: the file format
+ * @param out: the bytes of the file
+ */
+extern int encodeCrop(const OCR_CROP &crop, CROP_FORMAT format,
+                      std::string &out);
+
+
+/*
+ * Returns the file extension of a format, with the dot (".tiff").
+ *
+ * @param format: the file format
+ */
+extern const char *getCropExtension(CROP_FORMAT format);
+
+
+/*
+ * Returns the engine's IMF_FORMAT for a format, for bBoxes saved with
+ * kRecSaveImgAreaF. The engine does not write raw crops; CROP_RAW gives
+ * FF_TIFNO.
+ *
+ * @param format: the file format
+ */
+extern IMF_FORMAT getEngineFormat(CROP_FORMAT format);
+
+
+/*
+ * Reads the name of a format: tiff, packbits, png or raw.
+ * This function returns 0 on success and 1 for an unknown name.
+ *
+ * @param name: the name given with -f
+ * @param format: set to the format
+ */
+extern int parseCropFormat(std::string name, CROP_FORMAT &format);
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrDedup.h
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrDedup.h"
+#include "ocrTensor.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+
+using namespace std;
+
+
+/*
+ * Returns the FNV-1a hash of the size and pixels of a crop.
+ */
+static uint64_t getContentHash(const OCR_CROP &crop)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int32_t size[3] = {crop.width, crop.height, crop.bitsPerPixel};
+    const BYTE *bytes = (const BYTE *) size;
+
+    for (size_t i = 0; i < sizeof(size); i++)
+    {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    for (size_t i = 0; i < crop.pixels.size(); i++)
+    {
+        hash = (hash ^ crop.pixels[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+/*
+ * Returns the 64-bit average hash of a crop (see ocrDedup.h), 0 if the crop
+ * can not be resampled.
+ *
+ * @param crop: the crop to hash
+ */
+uint64_t getShapeHash(const OCR_CROP &crop)
+{
+    BYTE cells[64];
+    int sum = 0;
+    uint64_t shape = 0;
+
+    if (resampleCrop(crop, 8, cells) != 0)
+    {
+        return 0;
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        sum += cells[i];
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        if (cells[i] * 64 > sum)
+        {
+            shape |= 1ULL << i;
+        }
+    }
+    return shape;
+}
+
+
+/*
+ * Returns true if a perceptual hash says nothing about the shape of a crop:
+ * a blank or solid crop (or one that could not be resampled) has no cell
+ * above the mean and hashes to 0, so all such crops would be near
+ * duplicates of each other whatever their pixels.
+ */
+static bool isUniformShape(uint64_t shape)
+{
+    return shape == 0 || shape == ~0ULL;
+}
+
+
+/*
+ * DEDUP_CROP_SINK constructor
+ *
+ * @param cropSink: the sink for the distinct crops, deleted with this
+ * @param mapPath: the file that maps every crop name to its ref
+ * @param distance: the largest perceptual hash distance of duplicates,
+ *                  0 to only drop crops with equal pixels
+ */
+DEDUP_CROP_SINK::DEDUP_CROP_SINK(CROP_SINK *cropSink, string mapPath,
+                                 int distance)
+    : sink(cropSink), map(mapPath), maxDistance(distance),
+      nCrops(0), nStored(0), nExact(0), nNear(0)
+{
+    if (maxDistance > 0)
+    {
+        byChunk.resize(maxDistance + 1);
+    }
+}
+
+
+/*
+ * Returns the part of a perceptual hash that byChunk[c] indexes: the bits
+ * from 64 * c / (maxDistance + 1) up to the next chunk.
+ */
+uint64_t DEDUP_CROP_SINK::getChunk(uint64_t shape, int c)
+{
+    int first = 64 * c / (maxDistance + 1);
+    int last = 64 * (c + 1) / (maxDistance + 1);
+
+    return (shape >> first) & ((1ULL << (last - first)) - 1);
+}
+
+
+/*
+ * Returns the stored crop with the same size and pixels, or -1.
+ * The caller holds the lock.
+ */
+int DEDUP_CROP_SINK::findExact(const OCR_CROP &crop, uint64_t content)
+{
+    unordered_map<uint64_t, vector<int> >::iterator found =
+        byContent.find(content);
+
+    if (found == byContent.end())
+    {
+        return -1;
+    }
+    for (size_t k = 0; k < found->second.size(); k++)
+    {
+        const DEDUP_ENTRY &entry = entries[found->second[k]];
+        if (entry.width == crop.width && entry.height == crop.height &&
+            entry.bitsPerPixel == crop.bitsPerPixel &&
+            entry.pixels == crop.pixels)
+        {
+            return found->second[k];
+        }
+    }
+    return -1;
+}
+
+
+/*
+ * Returns the first stored crop (in the order they were stored) whose
+ * perceptual hash is within maxDistance bits of this one and whose size
+ * is close enough, or -1. Crops with a uniform shape only match exactly,
+ * and are not in byChunk. The caller holds the lock.
+ */
+int DEDUP_CROP_SINK::findNear(const OCR_CROP &crop, uint64_t shape)
+{
+    int best = -1;
+
+    if (isUniformShape(shape))
+    {
+        return -1;
+    }
+    for (int c = 0; c <= maxDistance; c++)
+    {
+        unordered_map<uint64_t, vector<int> >::iterator found =
+            byChunk[c].find(getChunk(shape, c));
+        if (found == byChunk[c].end())
+        {
+            continue;
+        }
+
+        for (size_t k = 0; k < found->second.size(); k++)
+        {
+            int id = found->second[k];
+            const DEDUP_ENTRY &entry = entries[id];
+            if ((best >= 0 && id >= best) ||
+                entry.bitsPerPixel != crop.bitsPerPixel ||
+                abs(entry.width - crop.width) * DEDUP_SIZE_SLACK >
+                    max(entry.width, crop.width) ||
+                abs(entry.height - crop.height) * DEDUP_SIZE_SLACK >
+                    max(entry.height, crop.height) ||
+                __builtin_popcountll(entry.shape ^ shape) > maxDistance)
+            {
+                continue;
+            }
+            best = id;
+        }
+    }
+    return best;
+}
+
+
+/*
+ * Adds a pending entry for the crop to the tables and returns its index.
+ * The caller holds the lock.
+ */
+int DEDUP_CROP_SINK::addEntry(const OCR_CROP &crop, uint64_t content,
+                              uint64_t shape)
+{
+    DEDUP_ENTRY entry;
+    entry.pending = true;
+    entry.width = crop.width;
+    entry.height = crop.height;
+    entry.bitsPerPixel = crop.bitsPerPixel;
+    entry.shape = shape;
+    entry.pixels = crop.pixels;
+    entries.push_back(entry);
+
+    int id = (int) entries.size() - 1;
+    byContent[content].push_back(id);
+    for (int c = 0; c < (int) byChunk.size() && !isUniformShape(shape); c++)
+    {
+        byChunk[c][getChunk(shape, c)].push_back(id);
+    }
+    return id;
+}
+
+
+/*
+ * Takes an entry whose crop could not be written out of the tables, so no
+ * crop refers to it. The caller holds the lock.
+ */
+void DEDUP_CROP_SINK::removeEntry(int id, uint64_t content)
+{
+    vector<int> &sameContent = byContent[content];
+    sameContent.erase(remove(sameContent.begin(), sameContent.end(), id),
+                      sameContent.end());
+    for (int c = 0; c < (int) byChunk.size() &&
+                    !isUniformShape(entries[id].shape); c++)
+    {
+        vector<int> &sameChunk = byChunk[c][getChunk(entries[id].shape, c)];
+        sameChunk.erase(remove(sameChunk.begin(), sameChunk.end(), id),
+                        sameChunk.end());
+    }
+    entries[id].pending = false;
+    entries[id].pixels.clear();
+}
+
+
+/*
+ * Stores the crop in the sink below unless an equal (or, with a distance,
+ * similar) crop is stored already, and sets ref to the ref of the stored
+ * crop. The hashes are computed before taking the lock, and the crop is
+ * written to the sink below without it.
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to store
+ * @param ref: set to the ref of the crop that holds the image
+ */
+int DEDUP_CROP_SINK::write(const OCR_CROP &crop, string &ref)
+{
+    uint64_t content = getContentHash(crop);
+    uint64_t shape = (maxDistance > 0 ? getShapeHash(crop) : 0);
+    unique_lock<mutex> guard(lock);
+    int id;
+    bool near;
+
+    // an equal crop another worker is writing right now gets its ref first
+    while (true)
+    {
+        near = false;
+        id = findExact(crop, content);
+        if (id < 0 && maxDistance > 0)
+        {
+            id = findNear(crop, shape);
+            near = (id >= 0);
+        }
+        if (id < 0 || !entries[id].pending)
+        {
+            break;
+        }
+        published.wait(guard);
+    }
+
+    nCrops++;
+    if (id >= 0)
+    {
+        (near ? nNear : nExact)++;
+        ref = entries[id].ref;
+    }
+    else
+    {
+        id = addEntry(crop, content, shape);
+        guard.unlock();
+        int err = sink->write(crop, ref);
+        guard.lock();
+
+        if (err != 0)
+        {
+            removeEntry(id, content);
+        }
+        else
+        {
+            entries[id].ref = ref;
+            entries[id].pending = false;
+            nStored++;
+        }
+        published.notify_all();
+        if (err != 0)
+        {
+            return 1;
+        }
+    }
+    guard.unlock();
+
+    wstring line(crop.name.begin(), crop.name.end());
+    line += L'\t';
+    line.append(ref.begin(), ref.end());
+    line += L'\n';
+    map.write(line);
+    return 0;
+}
+
+
+/*
+ * Flushes the sink below and the map.
+ */
+void DEDUP_CROP_SINK::flush()
+{
+    sink->flush();
+    map.flush();
+    if (map.hasFailed())
+    {
+        printf("ERROR, could not write the crop map %s\n",
+               map.getPath().c_str());
+    }
+}
+
+
+/*
+ * Returns the bytes the sink below and the map have written so far.
+ */
+long long DEDUP_CROP_SINK::getBytesWritten()
+{
+    return sink->getBytesWritten() + map.getBytesWritten();
+}
+
+
+/*
+ * Returns the crops the sink below could not store after write().
+ */
+long long DEDUP_CROP_SINK::getLostCrops()
+{
+    return sink->getLostCrops();
+}
+
+
+/*
+ * DEDUP_CROP_SINK destructor, deletes the sink below (which writes what it
+ * still holds) and prints how many crops were stored.
+ */
+DEDUP_CROP_SINK::~DEDUP_CROP_SINK()
+{
+    delete sink;
+    printf("crop store: %d crops, %d stored, %d equal and %d similar to a "
+           "stored one\n", nCrops, nStored, nExact, nNear);
+}
@@ -0,0 +1,144 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrDedup.cpp program
+ *
+ * A page of text repeats the same glyphs over and over: the same letter in
+ * the same font and size gives the same bBox image thousands of times.
+ * DEDUP_CROP_SINK sits in front of another crop sink and stores every
+ * distinct image only once (-u):
+ *
+ *  - a crop whose size, bits per pixel and pixels equal a stored crop's
+ *    is not stored again; its ref is the stored crop's ref, so the letter
+ *    and word records point at the shared image. Crops are found by a
+ *    64-bit hash of their pixels and compared byte by byte.
+ *  - with a distance D > 0 (-d D), a crop is also a duplicate if its
+ *    perceptual hash differs from a stored crop's in at most D of 64 bits
+ *    and their sizes differ by at most 1 / DEDUP_SIZE_SLACK. The
+ *    perceptual hash is an average hash: the crop is resampled to 8 x 8
+ *    (resampleCrop) and every cell with more ink than the mean sets a bit.
+ *    The hashes are split into D + 1 chunks and every chunk is indexed on
+ *    its own: two hashes within D bits agree in at least one chunk, so a
+ *    lookup only compares the crops that share a chunk. A blank or solid
+ *    crop hashes to 0, which says nothing about its shape, so such crops
+ *    are only dropped when their pixels are equal.
+ *
+ * Every crop still gets its own name (l-12, w-3, ...), and the map file
+ * has one line "<name>\t<ref>" per crop, so readers of the binary tables,
+ * which refer to crops by number, find the stored image as well.
+ *
+ * With several workers the first of two equal crops to arrive is stored,
+ * so which name holds the image can change from run to run; the pixels
+ * each record points at do not (up to D bits with -d). The lock is only
+ * held for the lookup: a new crop is added as pending, written to the
+ * sink below without the lock, and its ref published after; a worker
+ * with an equal crop waits for the ref instead of writing it again.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_DEDUP_H
+#define OCR_DEDUP_H
+
+#include "ocrCrop.h"
+#include "ocrOutput.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+
+#define DEDUP_MAX_DISTANCE  15      // largest -d, in bits of 64
+#define DEDUP_SIZE_SLACK    8       // near duplicates differ in width and
+                                    // height by at most 1/8
+
+
+/*
+ * A crop that was stored.
+ */
+struct DEDUP_ENTRY
+{
+    std::string ref;            // what the sink below returned for it
+    bool pending;               // true while a worker writes it, ref is
+                                // not set yet
+    int width;
+    int height;
+    int bitsPerPixel;
+    uint64_t shape;             // the perceptual hash, with -d only
+    std::vector<BYTE> pixels;   // to tell equal crops from hash collisions
+};
+
+
+class DEDUP_CROP_SINK : public CROP_SINK
+{
+private:
+
+    CROP_SINK *sink;            // where the distinct crops go, owned
+    OCR_SINK map;               // "<name>\t<ref>" for every crop
+    int maxDistance;            // -d, 0 for exact duplicates only
+
+    std::vector<DEDUP_ENTRY> entries;
+    std::unordered_map<uint64_t, std::vector<int> > byContent;
+    std::vector<std::unordered_map<uint64_t, std::vector<int> > > byChunk;
+
+    int nCrops;                 // crops written to this sink
+    int nStored;                // of those, stored in the sink below
+    int nExact;                 // of those, equal to a stored crop
+    int nNear;                  // of those, within maxDistance of one
+    std::mutex lock;
+    std::condition_variable published;  // a pending entry got its ref
+
+    // adds a pending entry for the crop to the tables, returns its index
+    int addEntry(const OCR_CROP &crop, uint64_t content, uint64_t shape);
+
+    // takes an entry whose crop could not be written out of the tables
+    void removeEntry(int id, uint64_t content);
+
+    // returns the stored crop equal to this one, or -1
+    int findExact(const OCR_CROP &crop, uint64_t content);
+
+    // returns the first stored crop within maxDistance of this one, or -1
+    int findNear(const OCR_CROP &crop, uint64_t shape);
+
+    // the part of a perceptual hash that byChunk[c] indexes
+    uint64_t getChunk(uint64_t shape, int c);
+
+public:
+    /*
+     * DEDUP_CROP_SINK constructor
+     *
+     * @param cropSink: the sink for the distinct crops, deleted with this
+     * @param mapPath: the file that maps every crop name to its ref
+     * @param distance: the largest perceptual hash distance of duplicates,
+     *                  0 to only drop crops with equal pixels
+     */
+    DEDUP_CROP_SINK(CROP_SINK *cropSink, std::string mapPath, int distance);
+
+    int write(const OCR_CROP &crop, std::string &ref);
+
+    // flushes the sink below and the map
+    void flush();
+
+    // the bytes of the sink below and of the map
+    long long getBytesWritten();
+
+    // the crops the sink below lost
+    long long getLostCrops();
+
+    // destructor, prints how many crops were stored
+    ~DEDUP_CROP_SINK();
+
+    DEDUP_CROP_SINK(const DEDUP_CROP_SINK &) = delete;
+    DEDUP_CROP_SINK &operator=(const DEDUP_CROP_SINK &) = delete;
+};
+
+
+/*
+ * Returns the 64-bit average hash of a crop: bit 8 * y + x is set if cell
+ * (x, y) of the crop resampled to 8 x 8 has more ink than the mean cell.
+ *
+ * @param crop: the crop to hash
+ */
+extern uint64_t getShapeHash(const OCR_CROP &crop);
+
+#endif
@@ -10,8 +10,8 @@
  */
 
 #include "ocrExtraction.h"
-#include <locale>
-#include <codecvt>
+#include "ocrJournal.h"
+#include "ocrCache.h"
 #include <fstream>
 #include <iostream>
 #include <fcntl.h>
@@ -19,11 +19,6 @@
 
 using namespace std;
 
-// static counters, used for us to name the output bounding box image files
-static int rectLetter = 0;
-static int rectWord = 0;
-
-
 /* 
  * ____________________________________________________________________________
  *  Definitions for class: OCR_LETTER
@@ -34,18 +29,18 @@ static int rectWord = 0;
 /*
  * OCR_LETTER constructor
  * 
- * @param file: the path to the image we want to recognize
+ * @param image: the id of the image (in imagePaths) we want to recognize
  * @param err: the error for this letter, [0 = great, 255 = terrible]
  * @param letter: the recognition result nuance returned for this letter
- * @param sqSize: the size of one side of this letter's bBox
+ * @param insideWord: true if the letter is part of a word
  */
-OCR_LETTER::OCR_LETTER(string file, int err, wchar_t letter, int sqSize,
+OCR_LETTER::OCR_LETTER(uint32_t image, int err, wchar_t letter,
                        bool insideWord)
 {
-    imageFile = file;       
+    imageId = image;
+    bBoxFile = "";
     error = err;
     text = letter;
-    squareSize = sqSize;
     inWord = insideWord;
 }
 
@@ -62,35 +57,47 @@ OCR_LETTER::OCR_LETTER(string file, int err, wchar_t letter, int sqSize,
  *      5.) Blank line
  *
  *
- * @param outFile: the file to write info to
+ * @param out: the buffer to write info to
  */
-void OCR_LETTER::printLetterToOutput(wofstream &outFile, string letterOut)
+void OCR_LETTER::printLetterToOutput(wstring &out)
 {
-    // change locale so we can print out unicode letters
-    const std::locale utf8_locale = std::locale(std::locale(), new std::codecvt_utf8<wchar_t>());
-    outFile.open(letterOut, ios::app);
-    outFile.imbue(utf8_locale);
-    
-    wstring tempImageFile(imageFile.begin(), imageFile.end());
-    wstring tempbBoxFile(bBoxFile.begin(), bBoxFile.end());
-    
-    outFile << tempImageFile << endl;
-    outFile << tempbBoxFile << endl;
-    if (outFile.bad())
-    {
-        printf(" could not save\n");
-        wprintf(L"%S\n", tempbBoxFile.c_str());
-        putwchar(text);
-        wprintf(L"!\n");
-        printf("int: %d", int(text));
-        printf("\n");
-    }
-    outFile << error << endl;
-    outFile << text << endl;
+    const string &imageFile = imagePaths.get(imageId);
+
+    out.append(imageFile.begin(), imageFile.end());
+    out += L'\n';
+    out.append(bBoxFile, bBoxFile + strlen(bBoxFile));
+    out += L'\n';
+    out += to_wstring(error);
+    out += L'\n';
+    out += text;
+    out += L'\n';
     
-    outFile << endl;
-    
-    outFile.close();
+    out += L'\n';
+}
+
+
+/*
+ * Adds the letter info to the binary letter records of the page.
+ * The image id is filled in when the page is written.
+ *
+ * @param out: the binary letter records of the page
+ * @param cropId: the number of this letter's image, or BINARY_NO_CROP
+ */
+void OCR_LETTER::printLetterToBinary(vector<BINARY_LETTER> &out,
+                                     uint32_t cropId)
+{
+    BINARY_LETTER record;
+
+    memset(&record, 0, sizeof(record));
+    record.cropId = cropId;
+    record.left = left;
+    record.top = top;
+    record.right = right;
+    record.bottom = bottom;
+    record.code = (uint32_t) text;
+    record.err = error;
+    record.inWord = inWord ? 1 : 0;
+    out.push_back(record);
 }
 
 
@@ -98,93 +105,99 @@ void OCR_LETTER::printLetterToOutput(wofstream &outFile, string letterOut)
  * This function takes a LETTER struct, exports the bounding box of this letter
  * as it's own image, and prints out the letter's info to the specified output.
  *
- * @param hPage: the current page in the ocr process
- * @param info: stores the dimensions of the current page
- * @param outFileLetter: where to print letter information
+ * @param page: the current page in the ocr process, letter information is
+ *              printed to its letter buffer
  * @param currLetter: the letter we are exporting
- * @param letters: the vector of letters for the word that this letter is in
+ * @param squares: the fitted squares, page.letterSquares or page.wordSquares
+ * @param index: the index of the letter in pLetters and squares
+ * @param word: the word that this letter is in, or NULL
  * @param modeInt: the current export mode. If modeInt is 1 (-w, word only),
  *                  then this function will not export the bBox or print letter
  *                  info
  */
-int OCR_LETTER::exportLetter(HPAGE hPage, IMG_INFO info, wofstream& outFileLetter,
-                             string letterOut, LETTER currLetter, 
-                             vector<OCR_LETTER *> &letters, int modeInt)
+int OCR_LETTER::exportLetter(PAGE_CONTEXT &page, const LETTER &currLetter,
+                             const LETTER_SQUARES &squares, int index,
+                             OCR_WORD *word, int modeInt)
 {
     int err;
-    // create the rect for the letter itself
-    RECT letterRect;
-    left = currLetter.left;
-    right = left + currLetter.width;
-    top = currLetter.top;
-    bottom = top + currLetter.height;
-    
-    // make the bBox of the letter fit the specified square
-    letterRect.left = left - (squareSize - (right - left)) / 2;
-    letterRect.right = right + (squareSize - (right - left)) / 2;
-    letterRect.top = top - (squareSize - (bottom - top)) / 2;
-    letterRect.bottom = bottom + (squareSize - (bottom - top)) / 2;
-
-    // make rect perfectly square if there was rounding error
-    letterRect.right += squareSize - 
-                        (letterRect.right - letterRect.left);
-    letterRect.bottom += squareSize - 
-                        (letterRect.bottom - letterRect.top);
-
-    // add some extra wiggle room to the bBox
-    letterRect.left -= squareSize * 0.05;
-    letterRect.top -=  squareSize * 0.05;
-    letterRect.right += squareSize * 0.05;
-    letterRect.bottom += squareSize * 0.05;
+    string cropRef;
 
+    // the bBox of the letter, fitted to its square by fitSquares()
+    RECT letterRect = squares.getRect(index);
     left = letterRect.left;
     top = letterRect.top;
     right = letterRect.right;
     bottom = letterRect.bottom;
 
     // don't export letter if its square goes beyond page boundaries
-    if (letterRect.left < 0 || letterRect.right > info.Size.cx ||
-        letterRect.top < 0  ||  letterRect.bottom > info.Size.cy)
+    if (!squares.onPage[index])
     {
+        countEvent(page.metrics, EVENT_OFF_PAGE);
         return 1;
-        printf("couldn't export letter %d\n", rectLetter);
     } 
     
 
     // create the letter objext and print its info
     if (currLetter.width > 0 && currLetter.height > 0)
     {
-        if (inWord)
+        if (inWord && word != NULL)
         {
-            // if the letter is part of a word, push it onto the letters vector
-            letters.push_back(this);
+            // if the letter is part of a word, add it to the word's letters
+            word->addLetter(this);
         }
         
 
+        uint32_t cropId = BINARY_NO_CROP;
+
         if (modeInt == 0 || modeInt == 2)
         {
             // export the letter bBox 
             // our output bBox image names will be labeled with "l-" prefix
-            // and an index (the static global variable rectLetter)
-            bBoxFile = "l-" + to_string(rectLetter);
-            string bBoxFile1 = "l-" + to_string(rectLetter) + ".tiff";
-            char *pchar1 = (char *) bBoxFile1.c_str();
-            err = exportRect(hPage, letterRect, (char *) pchar1);
+            // and an index (the letter counter of the page)
+            err = exportCrop(page, letterRect,
+                             "l-" + page.namePrefix +
+                             to_string(page.counters.letter), cropRef);
 
             if (err == 0) // if exporting was successful
             {
-                rectLetter += 1;  // update global counter
-                // print the letter info to the file
-                this->printLetterToOutput(outFileLetter, letterOut);
+                countEvent(page.metrics, EVENT_LETTER_CROPS);
+                bBoxFile = page.arena->copyString(cropRef);
+                cropId = page.counters.letter;
+                page.counters.letter += 1;  // update page counter
+                // print the letter info to the page buffer
+                if (!page.binaryOutput)
+                {
+                    this->printLetterToOutput(page.letterRecords);
+                }
             }
             else 
             {
-                printf("could not export letter: %d\n", rectLetter);
+                countEvent(page.metrics, EVENT_CROP_ERRORS);
+                // a page whose bitmap failed was reported once
+                if (!page.bitmapFailed)
+                {
+                    printf("could not export letter: %d\n",
+                           page.counters.letter);
+                }
             }
-        
+
+            if (page.tensorSize > 0 &&
+                exportTensor(page, letterRect, (uint32_t) text, error,
+                             cropId) != 0)
+            {
+                countEvent(page.metrics, EVENT_CROP_ERRORS);
+            }
+        }
+
+        // binary words refer to their letters, so letters in a word always
+        // get a binary record, even if no image was saved for them
+        if (page.binaryOutput && (cropId != BINARY_NO_CROP || inWord))
+        {
+            this->printLetterToBinary(page.binaryLetters, cropId);
         }
         return 0;   
     }
+    countEvent(page.metrics, EVENT_EMPTY_LETTERS);
     return 1;
 }
 
@@ -206,15 +219,19 @@ int OCR_LETTER::exportLetter(HPAGE hPage, IMG_INFO info, wofstream& outFileLette
 /*
  * OCR_WORD constructor
  * 
- * @param file: the path to the image we want to recognize
+ * @param image: the id of the image (in imagePaths) we want to recognize
  * @param startIndex: starting index of this word in the pLetters array
  * @param endIndex: end index of this word's last char in pLetters array
  */
-OCR_WORD::OCR_WORD(string file, int startIndex, int endIndex)
+OCR_WORD::OCR_WORD(uint32_t image, int startIndex, int endIndex)
 {
-    imageFile = file;
+    imageId = image;
+    bBoxFile = "";
     start = startIndex;
     end = endIndex;
+    word = L"";
+    letters = NULL;
+    nLetters = 0;
 }
 
 
@@ -230,32 +247,55 @@ OCR_WORD::OCR_WORD(string file, int startIndex, int endIndex)
  *      5.) The ocr result from nuance
  *      6.) Blank line
  *
- * @param outputFile: the file to write info to
+ * @param out: the buffer to write info to
  */
-void OCR_WORD::printWordToOutput(wofstream& outFile, string wordOut)
+void OCR_WORD::printWordToOutput(wstring& out)
 {
-    const std::locale utf8_locale = std::locale(std::locale(), new std::codecvt_utf8<wchar_t>());
-    outFile.open(wordOut, ios::app);
-    outFile.imbue(utf8_locale);
-
-    wstring tempImageFile(imageFile.begin(), imageFile.end());
-    wstring tempbBoxFile(bBoxFile.begin(), bBoxFile.end());
-
-    outFile << tempImageFile << endl;
-    outFile << tempbBoxFile << endl;
-    outFile << averageError << endl;
-    string letterFile;
-    for (int i = 0; i <letters.size(); i++)
-    {
-        letterFile = letters[i]->getbBoxFile();
-        wstring tempFile(letterFile.begin(), letterFile.end());
-        outFile << tempFile << " ";
-    }
-    outFile << endl;
-    outFile << word << endl;
-    outFile << endl;
-    outFile.close();
-    
+    const string &imageFile = imagePaths.get(imageId);
+
+    out.append(imageFile.begin(), imageFile.end());
+    out += L'\n';
+    out.append(bBoxFile, bBoxFile + strlen(bBoxFile));
+    out += L'\n';
+    out += to_wstring(averageError);
+    out += L'\n';
+    for (int i = 0; i < nLetters; i++)
+    {
+        const char *letterFile = letters[i]->getbBoxFile();
+        out.append(letterFile, letterFile + strlen(letterFile));
+        out += L' ';
+    }
+    out += L'\n';
+    out += word;
+    out += L'\n';
+    out += L'\n';
+}
+
+
+/*
+ * Adds the word info to the binary word records of the page.
+ * The image id is filled in when the page is written.
+ *
+ * @param out: the binary word records of the page
+ * @param cropId: the number of this word's image
+ * @param firstLetter: index of the word's first letter in the page's
+ *                     binary letter records
+ */
+void OCR_WORD::printWordToBinary(vector<BINARY_WORD> &out, uint32_t cropId,
+                                 size_t firstLetter)
+{
+    BINARY_WORD record;
+
+    memset(&record, 0, sizeof(record));
+    record.cropId = cropId;
+    record.left = left;
+    record.top = top;
+    record.right = right;
+    record.bottom = bottom;
+    record.firstLetter = firstLetter;
+    record.nLetters = nLetters;
+    record.averageError = averageError;
+    out.push_back(record);
 }
 
 
@@ -264,48 +304,45 @@ void OCR_WORD::printWordToOutput(wofstream& outFile, string wordOut)
  * into the specified file. The function also processes the letters inside the
  * word.
  *
- * @param hPage: the current page in the ocr process
+ * @param page: the current page in the ocr process, letter and word info is
+ *              printed to its buffers
  * @param pLetters: the recognition result for the current page
- * @param outFileLetter: where to print letter info
- * @param outFileWord: where to print word info
- * @param info: stores dimensions of the current page
  * @param modeInt: if modeInt is 0 (-l, letter only), this function will not
  *                  export the word bBox and will not print the word info
  */
-int OCR_WORD::processWordandLetters(HPAGE hPage, LETTER *pLetters,
-                                    wofstream& outFileLetter, string outLetter,
-                                    wofstream& outFileWord,   string outWord, 
-                                    IMG_INFO info, int modeInt)
+int OCR_WORD::processWordandLetters(PAGE_CONTEXT &page, LETTER *pLetters,
+                                    int modeInt)
 {
     int err;
     wchar_t currLetter;
-    word = L"";
     int largestWidth, largestHeight, squareSize;
+    LETTER_EXTENT extent;
+    string cropRef;
     averageError = 0;
-    
-    // create the rect for the word
-    RECT rect;
-    rect.right = pLetters[start].left + pLetters[start].width;
-    rect.left = pLetters[start].left;
-    rect.top = pLetters[start].top;
-    rect.bottom = pLetters[start].top + pLetters[start].height;
 
-    // find the largest height and width; this is the square bBox for the letters
-    largestHeight = 0;
-    largestWidth = 0;
-    for (int k = start; k <= end; k++)
-    {
-        if ((pLetters[k].width) > largestWidth)
-        {
-            largestWidth = pLetters[k].width;
-        }
-        if ((pLetters[k].height) > largestHeight)
-        {
-            largestHeight = pLetters[k].height;
-        }
-    }
+    // room for the word and its letters in the page arena
+    wchar_t *text = page.arena->createArray<wchar_t>(end - start + 2);
+    letters = page.arena->createArray<OCR_LETTER *>(end - start + 1);
+    nLetters = 0;
+    word = text;
+    
+    // find the rect for the word (with some wiggle room, on the page) and
+    // the largest height and width in one pass; letters without a size
+    // (only in words of the geometry segmenter) have no edges
+    measureLetters(page.geometry, start, end, page.info.Size.cx,
+                   page.info.Size.cy, extent);
+    RECT rect = extent.wordRect;
+    largestHeight = extent.largestHeight;
+    largestWidth = extent.largestWidth;
+
+    // the largest side is the square bBox for the letters, fit them all
     squareSize = largestHeight;
     if (largestWidth > largestHeight) { squareSize = largestWidth; }
+    fitSquares(page.geometry, start, end + 1, squareSize, page.info.Size.cx,
+               page.info.Size.cy, page.wordSquares);
+
+    // the binary records of this word's letters start here
+    size_t firstBinary = page.binaryLetters.size();
     
     
     // loop through all letters in the word
@@ -314,67 +351,54 @@ int OCR_WORD::processWordandLetters(HPAGE hPage, LETTER *pLetters,
         // update the word's average letter error
         averageError += pLetters[j].err;
 
-        // update the edges of the word bBox
-        if (pLetters[j].left < rect.left)
-        {
-            rect.left = pLetters[j].left;
-        }
-        if (pLetters[j].left + pLetters[j].width > rect.right)
-        {
-            rect.right = pLetters[j].left + pLetters[j].width;
-        }
-        if (pLetters[j].top < rect.top)
-        {
-            rect.top = pLetters[j].top;
-        }
-        if (pLetters[j].top + pLetters[j].height > rect.bottom)
-        {
-            rect.bottom = pLetters[j].top + pLetters[j].height;
-        }
-        
         currLetter = pLetters[j].code;
-        word += currLetter;
+        *text++ = currLetter;
 
         // process each letter in the word
-        OCR_LETTER *newLetter = new OCR_LETTER(imageFile, pLetters[j].err,
-                                               currLetter, squareSize, TRUE);
-        newLetter->exportLetter(hPage, info, outFileLetter, outLetter, 
-                                pLetters[j], letters, modeInt);
+        OCR_LETTER *newLetter = page.arena->create<OCR_LETTER>(
+            imageId, pLetters[j].err, currLetter, TRUE);
+        newLetter->exportLetter(page, pLetters[j], page.wordSquares, j, this,
+                                modeInt);
     }
+    *text = L'\0';
 
     // get the average letter error for the word
     averageError /= (end - start + 1);
 
-    // add some extra wiggle room to the word bBox
-    rect.left -= (largestWidth / 2);
-    rect.right += (largestWidth / 2);
-    rect.top -= (largestHeight / 2);
-    rect.bottom += (largestHeight / 2);
-
-    // make sure that our word's bBox does not go beyond page boundaries
-    if (rect.left < 0 || rect.top)
-    if ((rect.top) < 0)    rect.top = 0;
-    if ((rect.right) > info.Size.cx) rect.right = info.Size.cx;
-    if ((rect.bottom) > info.Size.cy) rect.bottom = info.Size.cy;
-
     // export bBox for the word
-    if (modeInt != 0 && letters.size() > 0)
-    {
-        // create the name for the image we will export
-        bBoxFile = "w-" + to_string(rectWord);
-        string bBoxFile2 = "w-" + to_string(rectWord) + ".tiff";
-        char *pchar2 = (char *) bBoxFile2.c_str();
-        // export the rectangle
-        err = exportRect(hPage, rect, (char *) pchar2);
+    if (modeInt != 0 && nLetters > 0)
+    {
+        // export the rectangle, the image is named "w-" + the word counter
+        err = exportCrop(page, rect,
+                         "w-" + page.namePrefix + to_string(page.counters.word),
+                         cropRef);
         if (err == 0) // if exporting was successful
         {
-            rectWord += 1;
-            this->printWordToOutput(outFileWord, outWord);
+            countEvent(page.metrics, EVENT_WORD_CROPS);
+            bBoxFile = page.arena->copyString(cropRef);
+            left = rect.left;
+            top = rect.top;
+            right = rect.right;
+            bottom = rect.bottom;
+            if (page.binaryOutput)
+            {
+                this->printWordToBinary(page.binaryWords, page.counters.word,
+                                        firstBinary);
+            }
+            else
+            {
+                this->printWordToOutput(page.wordRecords);
+            }
+            page.counters.word += 1;
             return 0;
         }
         else
         {
-            printf("could not export word %d\n", rectWord);
+            countEvent(page.metrics, EVENT_CROP_ERRORS);
+            if (!page.bitmapFailed)
+            {
+                printf("could not export word %d\n", page.counters.word);
+            }
         }
     }
 
@@ -382,21 +406,6 @@ int OCR_WORD::processWordandLetters(HPAGE hPage, LETTER *pLetters,
 }
 
 
-/* 
- * Destructor for the OCR_WORD class
- */
-
-OCR_WORD::~OCR_WORD()
-{
-    // delete all OCR_LETTERs in the letters array
-    for (int i = 0; i < letters.size(); i++)
-    {
-        delete letters[i];
-    }
-
-}
-
-
 /*
  * ____________________________________________________________________________
  * End class definition for: OCR_WORD
@@ -435,28 +444,122 @@ int setUp()
         return 1;
     }
     
+    if (configureSettings(SID) != 0)
+    {
+        kRecQuit();
+        return 1;
+    }
+    
+    return 0;
+}
+
+
+/*
+ * Applies our recognition settings to the given settings collection:
+ * - sets the default recognition module
+ * - sets the output format
+ * The function returns 0 for success.
+ *
+ * @param sid: the settings collection to configure
+ */
+int configureSettings(int sid)
+{
+    RECERR rc;
+
     //Set default recognition module
-    rc = kRecSetDefaultRecognitionModule(SID, RM_OMNIFONT_PLUS3W);
+    rc = kRecSetDefaultRecognitionModule(sid, RM_OMNIFONT_PLUS3W);
     if (rc != REC_OK)
     {
-        kRecSetDefaults(SID);
-        kRecQuit();
+        kRecSetDefaults(sid);
         return 1;
     }
     
     //printf("Set output format -- kRecSetDTXTFormat()\n");
-    rc = kRecSetDTXTFormat(SID, DTXT_TXTS);
+    rc = kRecSetDTXTFormat(sid, DTXT_TXTS);
     if (rc != REC_OK)
     {
-        kRecSetDefaults(SID);
+        kRecSetDefaults(sid);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * OCR_ENGINE constructor
+ *
+ * Starts the engine once for the whole run. Check isReady() before using the
+ * engine; if setUp() failed it has already called kRecQuit.
+ */
+OCR_ENGINE::OCR_ENGINE()
+{
+    sid = SID;
+    ready = (setUp() == 0);
+}
+
+
+/*
+ * OCR_ENGINE destructor
+ *
+ * Shuts the engine down. This is the only place kRecQuit is called once the
+ * engine is running.
+ */
+OCR_ENGINE::~OCR_ENGINE()
+{
+    if (ready)
+    {
         kRecQuit();
+    }
+}
+
+
+/*
+ * Creates a new settings collection and gives it the same settings as the
+ * main one. Worker threads use their own settings ID so they don't share
+ * engine state. Returns 0 on success.
+ *
+ * @param newSID: set to the ID of the new settings collection
+ */
+int OCR_ENGINE::createSettings(int &newSID)
+{
+    RECERR rc;
+
+    if (!ready)
+    {
+        return 1;
+    }
+
+    rc = kRecCreateSettingsCollection(&newSID);
+    if (rc != REC_OK)
+    {
+        printf("Error code = %X, could not create settings\n", rc);
+        return 1;
+    }
+
+    if (configureSettings(newSID) != 0)
+    {
+        kRecDeleteSettingsCollection(newSID);
         return 1;
     }
-    
     return 0;
 }
 
 
+/*
+ * Releases a settings collection made by createSettings().
+ *
+ * @param oldSID: the settings collection to release
+ */
+void OCR_ENGINE::releaseSettings(int oldSID)
+{
+    if (ready && oldSID != sid)
+    {
+        kRecDeleteSettingsCollection(oldSID);
+    }
+}
+
+
 /*
  * The function copies our LETTER characters into the given WCHAR buffer.
  * This function returns 0 on success.
@@ -472,13 +575,12 @@ int setUp()
  */
 int fillCharBuffer(LETTER *pLetters, int nLetters, wchar_t *buffer)
 {
-    memset(buffer, 0, sizeof(wchar_t) * (nLetters)); // clear the buffer
     for (int i = 0; i < nLetters; i++)
     {
-        // copy each element into the buffer
-        memcpy((buffer + i), &(pLetters[i].code), sizeof(pLetters[i].code));
+        // copy each element into the buffer, widening it to wchar_t
+        buffer[i] = (wchar_t) pLetters[i].code;
     }
-    buffer[nLetters] = L'\0'; // make the buffer null terminated
+    buffer[max(nLetters, 0)] = L'\0'; // make the buffer null terminated
     return 0;
 }
 
@@ -487,24 +589,31 @@ int fillCharBuffer(LETTER *pLetters, int nLetters, wchar_t *buffer)
  * Crops the current page image into the rectangle given and exports the
  * rectangle into its own image.
  *
+ * @param sid: the settings collection to use
  * @param hPage: the current page
  * @param rect: the RECT structure to export
  * @param name: the filename to give to the new image file
+ * @param metrics: the run metrics that time the call, or NULL
+ * @param format: the file format of the image
  */
-int exportRect(HPAGE hPage, RECT rect, char *name)
+int exportRect(int sid, HPAGE hPage, RECT rect, char *name,
+               RUN_METRICS *metrics, IMF_FORMAT format)
 {
     RECERR rc;
     /*
      * Common Image Formats:
-     * FF_TIFNO: Uncompressed TIFF image
+     * FF_TIFNO: Uncompressed TIFF image (the default)
      * FF_TIFPB: Packbits TIFF image format
      * FF_PNG: Portable Image format for Network Graphics
      * FF_GIF: GIF image format incorporating Unisys compression
      * FF_TIFJPGNEW: New JPG Compressed TIFF image format
      */
-    IMF_FORMAT  format = FF_TIFNO; // the file type for the image
     
-    rc = kRecSaveImgAreaF(SID, name, format, hPage, II_CURRENT, &rect, FALSE);
+    {
+        CALL_TIMER timer(metrics, CALL_SAVE_IMG_AREA);
+        rc = kRecSaveImgAreaF(sid, name, format, hPage, II_CURRENT, &rect,
+                              FALSE);
+    }
     if (rc != REC_OK)
     {
         printf("Error code = %X, could not export rectangle \n", rc);
@@ -517,298 +626,1120 @@ int exportRect(HPAGE hPage, RECT rect, char *name)
 
 
 /*
- * This function processes just the letters from index prevEnd to currStart.
- * We can use this function to extract the letters that are not part of a word.
- *
- * @param hPage: the current page in the ocr process
- * @param info: stores the dimensions of the current page
- * @param pLetters: the recognition result for the page
- * @param prevEnd: the index to start letter extraction
- * @param currStart: the end index for letter extraction
- * @param outFileLetter: stream to print letter info
- * @param outLetter: name of file to print letter info to
- * @param imageFile: the current image path as a string
- *
+ * Saves the rectangle of the page with kRecSaveImgAreaF, in the page's crop
+ * format. The engine cannot write raw crops, those are saved as
+ * uncompressed TIFF. Returns 0 on success.
  */
-int processBetweenWords(HPAGE hPage, IMG_INFO info, LETTER *pLetters, 
-                        int prevEnd, int currStart, wofstream& outFileLetter, 
-                        string outLetter, string imageFile)
+static int saveEngineCrop(PAGE_CONTEXT &page, RECT rect, string name,
+                          string &ref)
 {
-    wchar_t currLetter;
-    int modeInt = 0;    // if this method is called, we export the letter always
-    int currErr;
-    int left, right, top, bottom;
-    int squareSize;
-    vector<OCR_LETTER *> letters; // a dummy variable, we just need to pass
-                                  // something to exportLetter
-
-    for (int i = prevEnd + 1; i < currStart; i++)
-    {
-        currLetter = pLetters[i].code;
-
-        // make the letter bBox a square
-        squareSize = pLetters[i].height;
-        if (pLetters[i].width > squareSize) { squareSize = pLetters[i].width; }
+    CROP_FORMAT format = (page.cropFormat == CROP_RAW ? CROP_TIFF :
+                          page.cropFormat);
+    string fileName = name + getCropExtension(format);
 
-        // process and export the letter
-        OCR_LETTER *newLetter = new OCR_LETTER(imageFile, pLetters[i].err,
-                                               currLetter, squareSize, FALSE);
-        newLetter->exportLetter(hPage, info, outFileLetter, outLetter, 
-                                pLetters[i], letters, modeInt);
-    }
-
-    return 0;
+    ref = name;
+    return exportRect(page.sid, page.hPage, rect, (char *) fileName.c_str(),
+                      page.metrics, getEngineFormat(format));
 }
 
 
-
-/* 
- * This function takes in an image and exports all words and letters as 
- * their own image. It writes ocr info (error and result) about the words and
- * letters into the specified files.
+/*
+ * Gets the whole page bitmap once, all crops and tensors of the page are
+ * cut from it. A bitmap that can not be fetched, or whose format cutCrop
+ * does not support, is reported once and fails every crop of the page.
+ * This function returns 0 on success.
  *
- * @param hPage: the current page
- * @param ImageIn: filename of the image to scan
- * @param outputLetter: filename of the text file where letter results will be
- *                      written
- * @param outputWord: filename of the text file where word results will be
- *                     written
- * @param modeInt: the mode of the program:
- *                      0 (-l) = export letters
- *                      1 (-w) = export words
- *                      2 (-b) = export both
+ * @param page: the current page, its pBitmap is set
  */
-int extractAll(HPAGE hPage, string imageIn, string outputLetter,
-                string outputWord, int modeInt)
-
+static int getPageBitmap(PAGE_CONTEXT &page)
 {
+    if (page.bitmapFailed)
+    {
+        return 1;
+    }
+    if (page.pBitmap != NULL)
+    {
+        return 0;
+    }
+
     RECERR rc;
-    int err;
-    IMG_INFO info;
-    
-    LETTER *pLetters;
-    int nLetters;
-    
-    // Loading the image to scan
-    rc = kRecLoadImgF(SID, imageIn.c_str(), &hPage, PAGE_NUMBER_0);
+    {
+        CALL_TIMER timer(page.metrics, CALL_GET_IMG_AREA);
+        rc = kRecGetImgArea(page.sid, page.hPage, II_CURRENT, NULL,
+                            &page.bitmapInfo, &page.pBitmap);
+    }
     if (rc != REC_OK)
     {
-        printf("Error code = %X\n", rc);
-        printf("LoadError! %s\n", imageIn.c_str());
-        kRecQuit();
+        printf("Error code = %X, could not get the page bitmap\n", rc);
+        page.pBitmap = NULL;
+        page.bitmapFailed = true;
         return 1;
     }
-    
-    // Preprocessing page with default settings
-    rc = kRecPreprocessImg(SID, hPage);
-    if (rc != REC_OK)
+    if (!canCutBitmap(page.bitmapInfo))
     {
-        printf("Error code = %X\n", rc);
-        kRecFreeImg(hPage);
-        kRecQuit();
+        printf("can not cut the bBox images of %s (page %d) in memory, its "
+               "bitmap has %d bits per pixel%s\n", page.imageFile.c_str(),
+               page.pageNumber, (int) page.bitmapInfo.BitsPerPixel,
+               page.bitmapInfo.IsPalette ? " and a palette" : "");
+        page.bitmapFailed = true;
         return 1;
     }
-    
-    // get the page info (page size, resolution, etc..)
-    rc = kRecGetImgInfo(SID, hPage, II_CURRENT, &info);
-    
-    // automatically locate zones
-    rc = kRecLocateZones(SID, hPage);   
+    return 0;
+}
 
-    // Recognizing page
-    rc = kRecRecognize(SID, hPage, NULL);
-    if (rc != REC_OK)
+
+/*
+ * Exports the rectangle of the page as the bBox image with the given name.
+ * Without a crop sink the engine saves it to "<name>.tiff", or the
+ * extension of page.cropFormat (exportRect).
+ * With a crop sink, the page bitmap is fetched once per page and the
+ * rectangle is cut out of it in memory and handed to the sink. A crop
+ * never leaves the sink: if it can not be cut (a palette image, or an
+ * empty rectangle), it is not exported and the caller counts the error;
+ * an unsupported bitmap is reported once for the page (getPageBitmap).
+ * This function returns 0 on success.
+ *
+ * @param page: the current page
+ * @param rect: the rectangle to export
+ * @param name: the name of the bBox image, without extension
+ * @param ref: set to the name the records should use for the image
+ */
+int exportCrop(PAGE_CONTEXT &page, RECT rect, string name, string &ref)
+{
+    STAGE_TIMER timer(page.times, STAGE_CROPS);
+
+    if (page.cropSink == NULL)
     {
-        printf("Error code = %X\n", rc);
-        kRecFreeImg(hPage);
-        kRecQuit();
-        return (rc==NO_TXT_WARN?2:1);
+        return saveEngineCrop(page, rect, name, ref);
     }
-    
-    // Get recognition result
-    rc = kRecGetLetters(hPage, II_CURRENT, &pLetters, &nLetters);
-
 
-    wofstream outFileWord;   // ofstream for printing word output
-    wofstream outFileLetter; // ofstream for printing letter output
-    int start = 0;           // index of the first letter in the current word
-    int end = -1;            // index of the last letter in the current word
-    int prevEnd = -1;        // index of the last letter in the previous word
-    bool foundEnd = FALSE;
-    bool foundStart = TRUE;
+    if (getPageBitmap(page) != 0)
+    {
+        return 1;
+    }
 
-    // go through all letters to look for words and characters
-    for (int i = 0; i < nLetters; i++)
+    OCR_CROP crop;
+    crop.name = name;
+    if (cutCrop(page.pBitmap, page.bitmapInfo, rect, crop) != 0)
     {
-        // ignore the character if it has no width (newline, etc...)
-        if (pLetters[i].width == 0 || pLetters[i].height == 0)
-        {
-            foundStart = FALSE;
-            foundEnd = TRUE;
-            continue;
-        }
+        printf("could not cut %s out of the page bitmap\n", name.c_str());
+        return 1;
+    }
+    return page.cropSink->write(crop, ref);
+}
 
-        // the end of a word is marked by the ENDOFWORD flag
-        if (foundStart && pLetters[i].makeup == R_ENDOFWORD)
-        {
-            // we found a word
-            end = i;
-            foundStart = FALSE;
-            foundEnd = TRUE;
-
-            // create the word object and process it
-            OCR_WORD newWord = OCR_WORD(imageIn, start, end);
-            newWord.processWordandLetters(hPage, pLetters, outFileLetter, 
-                                          outputLetter, outFileWord, outputWord,
-                                          info, modeInt);
-
-            // process letters between the current word and the previous word
-            if (prevEnd > -1 && prevEnd < nLetters && modeInt != 1)
-            {
-                processBetweenWords(hPage, info, pLetters, prevEnd, start,
-                                    outFileLetter, outputLetter, imageIn);
-            }
 
-            prevEnd = end;
-        }
+/*
+ * Resamples the rectangle of the page to a page.tensorSize square tensor
+ * and adds it to the page's tensor buffers. Returns 0 on success.
+ *
+ * @param page: the current page
+ * @param rect: the square bBox of the letter
+ * @param code: the ocr result of the letter
+ * @param err: the error of the letter
+ * @param cropId: the number of the letter's bBox image, or BINARY_NO_CROP
+ */
+int exportTensor(PAGE_CONTEXT &page, RECT rect, uint32_t code, int err,
+                 uint32_t cropId)
+{
+    STAGE_TIMER timer(page.times, STAGE_CROPS);
+    OCR_CROP crop;
+    size_t offset = page.tensorPixels.size();
+    int size = page.tensorSize;
 
-        // the start of a word is marked by the first non-space letter after
-        // the end of a word
-        else if (foundEnd && (pLetters[i].spcInfo).spcCount < 1 &&
-                 pLetters[i].width > 0)
-        {
-            // we found the start of a word
-            start = i;
-            foundStart = TRUE;
-            foundEnd = FALSE;
-        }
+    if (getPageBitmap(page) != 0 ||
+        cutCrop(page.pBitmap, page.bitmapInfo, rect, crop) != 0)
+    {
+        return 1;
     }
 
-    // process the remaining letters if there are any left
-    if (end < nLetters && (modeInt != 1))
+    page.tensorPixels.resize(offset + (size_t) size * size);
+    if (resampleCrop(crop, size, &page.tensorPixels[offset]) != 0)
     {
-        processBetweenWords(hPage, info, pLetters, end, nLetters, outFileLetter,
-                            outputLetter, imageIn);
+        page.tensorPixels.resize(offset);
+        return 1;
     }
 
-    // clean stuff up
-    outFileLetter.flush();
-    outFileWord.flush();
-    outFileWord.close();
-    outFileLetter.close();
-
-    kRecFreeImg(hPage);
-    rc = kRecFree(pLetters);
-    kRecQuit();
+    TENSOR_LABEL label;
+    memset(&label, 0, sizeof(label));
+    label.code = code;
+    label.cropId = cropId;
+    label.err = (uint16_t) err;
+    page.tensorLabels.push_back(label);
     return 0;
 }
 
 
 /*
- * This function takes in an image file name and processes it so that
- * we extract only specific words and letters. 
+ * This function processes just the letters from index prevEnd to currStart.
+ * We can use this function to extract the letters that are not part of a word.
+ *
+ * @param page: the current page in the ocr process
+ * @param pLetters: the recognition result for the page
+ * @param prevEnd: the index to start letter extraction
+ * @param currStart: the end index for letter extraction
  *
- * @param hPage: the current page
- * @param imageIn: filename of the image to scan
- * @param outputLetter: filename of the text file where letter results will be
- *                      written
- * @param outputWord: filename of the text file where word results will be
- *                     written
- * @param modeInt: the mode of the program:
- *                 0 = export letters, 1 = export words, 2 = export both
- * @param toFind: the file where the strings to be found are specified.
- *                 strings in this file should be newline separated
  */
-int extractStrings(HPAGE hPage, string imageIn, string outputLetter,
-                   string outputWord, int modeInt, string toFind)
+int processBetweenWords(PAGE_CONTEXT &page, LETTER *pLetters, 
+                        int prevEnd, int currStart)
+{
+    wchar_t currLetter;
+    int modeInt = 0;    // if this method is called, we export the letter always
+    int currErr;
+    int left, right, top, bottom;
+
+    for (int i = prevEnd + 1; i < currStart; i++)
+    {
+        currLetter = pLetters[i].code;
+
+        // process and export the letter
+        OCR_LETTER *newLetter = page.arena->create<OCR_LETTER>(
+            page.imageId, pLetters[i].err, currLetter, FALSE);
+        newLetter->exportLetter(page, pLetters[i], page.letterSquares, i,
+                                NULL, modeInt);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Writes the records of the page for appendPageRecords.
+ */
+static int writePageRecords(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks)
+{
+    int err = 0;
+
+    if (!page.letterRecords.empty())
+    {
+        sinks.letters->write(page.letterRecords);
+        page.letterRecords.clear();
+    }
+    if (!page.wordRecords.empty())
+    {
+        sinks.words->write(page.wordRecords);
+        page.wordRecords.clear();
+    }
+    if (sinks.lines != NULL)
+    {
+        sinks.lines->write(page.lineRecords);
+        page.lineRecords.clear();
+        err |= sinks.lines->hasFailed();
+    }
+    if (sinks.zones != NULL)
+    {
+        sinks.zones->write(page.zoneRecords);
+        page.zoneRecords.clear();
+        err |= sinks.zones->hasFailed();
+    }
+
+    // in a manifest run every extractor has its own files
+    for (size_t k = 0; k < page.extractorRecords.size() &&
+                       k < sinks.extractors.size(); k++)
+    {
+        EXTRACTOR_RECORDS &records = page.extractorRecords[k];
+        if (!records.letterRecords.empty())
+        {
+            sinks.extractors[k].letters->write(records.letterRecords);
+            records.letterRecords.clear();
+        }
+        if (!records.wordRecords.empty())
+        {
+            sinks.extractors[k].words->write(records.wordRecords);
+            records.wordRecords.clear();
+        }
+        if (sinks.extractors[k].letters->hasFailed() ||
+            sinks.extractors[k].words->hasFailed())
+        {
+            err = 1;
+        }
+    }
+
+    if (sinks.binary != NULL)
+    {
+        countEvent(page.metrics, EVENT_BINARY_BYTES,
+                   page.binaryLetters.size() * sizeof(BINARY_LETTER) +
+                   page.binaryWords.size() * sizeof(BINARY_WORD));
+        if (sinks.binary->writePage(page.imageFile, page.pageNumber,
+                                    page.namePrefix,
+                                    page.binaryLetters, page.binaryWords) != 0)
+        {
+            err = 1;
+        }
+        page.binaryLetters.clear();
+        page.binaryWords.clear();
+    }
+
+    if (sinks.tensors != NULL)
+    {
+        countEvent(page.metrics, EVENT_TENSOR_BYTES,
+                   page.tensorPixels.size() +
+                   page.tensorLabels.size() * sizeof(TENSOR_LABEL));
+        if (sinks.tensors->writePage(page.imageFile, page.pageNumber,
+                                     page.namePrefix, page.tensorPixels,
+                                     page.tensorLabels) != 0)
+        {
+            err = 1;
+        }
+        page.tensorPixels.clear();
+        page.tensorLabels.clear();
+    }
+
+    if (sinks.letters->hasFailed() || sinks.words->hasFailed())
+    {
+        err = 1;
+    }
+
+    // with a journal, the page is done once its checkpoint is written
+    if (sinks.journal != NULL && sinks.journal->record(page, sinks) != 0)
+    {
+        err = 1;
+    }
+    return err;
+}
+
+
+/*
+ * Hands the letter and word records buffered in the page context to the
+ * output sinks and clears the page buffers. The sinks keep their files open
+ * for the whole run and write in large blocks. With run metrics, the page
+ * is counted once its records are written.
+ * This function returns 0 on success.
+ *
+ * @param page: the page whose records we write
+ * @param sinks: the sinks of the run
+ */
+int appendPageRecords(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks)
 {
-    RECERR rc;
     int err;
-    IMG_INFO info;
-    
-    LETTER *pLetters;
-    int nLetters;
-    
+    {
+        STAGE_TIMER timer(page.times, STAGE_WRITE);
+        err = writePageRecords(page, sinks);
+    }
+
+    if (sinks.metrics != NULL)
+    {
+        sinks.metrics->pageDone(page, sinks);
+    }
+    return err;
+}
+
+
+
+/*
+ * Loads the image of the page and preprocesses it with default settings.
+ * This is the first stage of processing a page. The function returns 0 on
+ * success; on failure the page holds no image.
+ *
+ * @param page: the page to load, page.imageFile is the image to scan
+ */
+int loadPage(PAGE_CONTEXT &page)
+{
+    RECERR rc;
+
+    page.hPage = NULL;
+    page.pLetters = NULL;
+    page.nLetters = 0;
+
+    // records of a multi-page file name the page they come from
+    if (page.pageCount > 1)
+    {
+        page.imageId = imagePaths.intern(page.imageFile + "#" +
+                                         to_string(page.pageNumber));
+    }
+    else
+    {
+        page.imageId = imagePaths.intern(page.imageFile);
+    }
+
     // Loading the image to scan
-    rc = kRecLoadImgF(SID, imageIn.c_str(), &hPage, PAGE_NUMBER_0);
+    {
+        STAGE_TIMER timer(page.times, STAGE_LOAD);
+        CALL_TIMER callTimer(page.metrics, CALL_LOAD_IMG);
+        rc = kRecLoadImgF(page.sid, page.imageFile.c_str(), &page.hPage,
+                          page.pageNumber);
+    }
     if (rc != REC_OK)
     {
         printf("Error code = %X\n", rc);
-        printf("LoadError! %s\n", imageIn.c_str());
-        kRecQuit();
+        printf("LoadError! %s (page %d)\n", page.imageFile.c_str(),
+               page.pageNumber);
+        countEvent(page.metrics, EVENT_LOAD_ERRORS);
+        page.hPage = NULL;
         return 1;
     }
     
+    STAGE_TIMER timer(page.times, STAGE_PREPROCESS);
+
     // Preprocessing page with default settings
-    rc = kRecPreprocessImg(SID, hPage);
+    {
+        CALL_TIMER callTimer(page.metrics, CALL_PREPROCESS);
+        rc = kRecPreprocessImg(page.sid, page.hPage);
+    }
     if (rc != REC_OK)
     {
         printf("Error code = %X\n", rc);
-        kRecFreeImg(hPage);
-        kRecQuit();
+        countEvent(page.metrics, EVENT_LOAD_ERRORS);
+        kRecFreeImg(page.hPage);
+        page.hPage = NULL;
         return 1;
     }
     
     // get the page info (page size, resolution, etc..)
-    rc = kRecGetImgInfo(SID, hPage, II_CURRENT, &info);
-    
+    CALL_TIMER callTimer(page.metrics, CALL_GET_IMG_INFO);
+    rc = kRecGetImgInfo(page.sid, page.hPage, II_CURRENT, &page.info);
+    return 0;
+}
+
+
+/*
+ * Locates the zones of a loaded page, recognizes it and gets the
+ * recognition result into page.pLetters. This is the second stage of
+ * processing a page. With a recognition cache, the result of an earlier
+ * run is used if there is one. The function returns 0 on success, 2 if
+ * there was no text on the page and 1 on other errors.
+ *
+ * @param page: a page that went through loadPage()
+ */
+int recognizePage(PAGE_CONTEXT &page)
+{
+    RECERR rc;
+    int status;
+
+    if (page.cache != NULL)
+    {
+        STAGE_TIMER timer(page.times, STAGE_RECOGNIZE);
+        if (page.cache->lookup(page, status) == 0)
+        {
+            countEvent(page.metrics, EVENT_CACHE_HITS);
+            countEvent(page.metrics, (status == 0 ? EVENT_LETTERS :
+                                      EVENT_EMPTY_PAGES),
+                       (status == 0 ? page.nLetters : 1));
+            return status;
+        }
+    }
+
     // automatically locate zones
-    rc = kRecLocateZones(SID, hPage);  
+    {
+        STAGE_TIMER timer(page.times, STAGE_ZONES);
+        CALL_TIMER callTimer(page.metrics, CALL_LOCATE_ZONES);
+        rc = kRecLocateZones(page.sid, page.hPage);
+    }
+
+    STAGE_TIMER timer(page.times, STAGE_RECOGNIZE);
 
     // Recognizing page
-    rc = kRecRecognize(SID, hPage, NULL);
+    {
+        CALL_TIMER callTimer(page.metrics, CALL_RECOGNIZE);
+        rc = kRecRecognize(page.sid, page.hPage, NULL);
+    }
     if (rc != REC_OK)
     {
         printf("Error code = %X\n", rc);
-        kRecFreeImg(hPage);
-        kRecQuit();
+        countEvent(page.metrics, (rc == NO_TXT_WARN ? EVENT_EMPTY_PAGES :
+                                  EVENT_RECOGNIZE_ERRORS));
+        if (rc == NO_TXT_WARN && page.cache != NULL)
+        {
+            page.cache->store(page, 2);
+        }
         return (rc==NO_TXT_WARN?2:1);
     }
     
     // Get recognition result
-    rc = kRecGetLetters(hPage, II_CURRENT, &pLetters, &nLetters);
+    {
+        CALL_TIMER callTimer(page.metrics, CALL_GET_LETTERS);
+        rc = kRecGetLetters(page.hPage, II_CURRENT, &page.pLetters,
+                            &page.nLetters);
+    }
+    if (rc != REC_OK)
+    {
+        printf("Error code = %X\n", rc);
+        countEvent(page.metrics, EVENT_RECOGNIZE_ERRORS);
+        page.pLetters = NULL;
+        page.nLetters = 0;
+        return 1;
+    }
+    countEvent(page.metrics, EVENT_LETTERS, page.nLetters);
+    if (page.cache != NULL)
+    {
+        page.cache->store(page, 0);
+    }
+    return 0;
+}
 
-    wofstream outFileWord;      // ofstream for printing word output
-    wofstream outFileLetter;    // ofstream for printing letter output
 
-    wchar_t *allText;           // stores the entire array of recog. letters
-    wchar_t *allTextPointer;    // a ptr to mark the current position in allText
-    wchar_t *found;             // pointer to where we find a match of toFind
-    wchar_t *findThis;          // the toFind string as a wchar_t array
+/*
+ * Frees the recognition result and the image of the page.
+ *
+ * @param page: the page to clean up
+ */
+void freePage(PAGE_CONTEXT &page)
+{
+    page.arena->reset();
+    page.letterIndex.reset();
+    page.pageWords.reset();
+    if (page.pBitmap != NULL)
+    {
+        CALL_TIMER timer(page.metrics, CALL_FREE);
+        kRecFree(page.pBitmap);
+        page.pBitmap = NULL;
+    }
+    page.bitmapFailed = false;
+    if (page.pLetters != NULL)
+    {
+        // letters from the cache are not the engine's
+        if (page.cachedLetters.empty())
+        {
+            CALL_TIMER timer(page.metrics, CALL_FREE);
+            kRecFree(page.pLetters);
+        }
+        page.pLetters = NULL;
+        page.nLetters = 0;
+    }
+    page.cachedLetters.clear();
+    if (page.hPage != NULL)
+    {
+        CALL_TIMER timer(page.metrics, CALL_FREE_IMG);
+        kRecFreeImg(page.hPage);
+        page.hPage = NULL;
+    }
+}
 
-    bool foundEnd = FALSE;
-    bool foundStart = TRUE;
-    int start;          // index of first letter in current word
-    int end;            // index of last letter in current word
-    int prevEnd;        // index of last letter in previous word
-    ptrdiff_t index;    // index to mark position in allText
-    string findLine;
 
-    // malloc a buffer to store recognition result
-    allText = (wchar_t *) malloc(sizeof(wchar_t) * (nLetters + 1));
+/*
+ * Exports a run of letters (a line or a zone) as one bBox image, named
+ * after the prefix and the counter, and prints its info to the records:
+ *
+ *      1.) Path to original image
+ *      2.) Name of the image for the line or zone
+ *      3.) The number of the line on the page, or the zone number
+ *      4.) The average error of its letters
+ *      5.) Its bBox, "<left> <top> <right> <bottom>"
+ *      6.) The ocr result, with a space before every word
+ *      7.) Blank line
+ *
+ * This function returns 0 on success.
+ *
+ * @param page: the current page
+ * @param range: the letters of the line or zone
+ * @param wordStarts: 1 for every letter that starts a word
+ * @param prefix: the start of the image name, "n-" or "z-"
+ * @param counter: the number of the image, incremented on success
+ * @param number: the line or zone number to print
+ * @param event: the metrics event of an exported image
+ * @param records: the page buffer to print to
+ */
+static int exportLetterRange(PAGE_CONTEXT &page, LETTER_RANGE range,
+                             const vector<char> &wordStarts, string prefix,
+                             int &counter, int number, RUN_EVENT event,
+                             wstring &records)
+{
+    LETTER *pLetters = page.pLetters;
+    RECT rect;
+    int largestHeight = 0;
+    int errorSum = 0;
+    int nSized = 0;
+    wstring text;
+    string cropRef;
+
+    for (int j = range.first; j <= range.last; j++)
+    {
+        const LETTER &letter = pLetters[j];
+        if (letter.width == 0 || letter.height == 0)
+        {
+            continue;
+        }
+        if (!text.empty() && wordStarts[j])
+        {
+            text += L' ';
+        }
+        text += (wchar_t) letter.code;
+
+        if (nSized == 0)
+        {
+            rect.left = letter.left;
+            rect.top = letter.top;
+            rect.right = letter.left + letter.width;
+            rect.bottom = letter.top + letter.height;
+        }
+        rect.left = min<long>(rect.left, letter.left);
+        rect.top = min<long>(rect.top, letter.top);
+        rect.right = max<long>(rect.right, letter.left + letter.width);
+        rect.bottom = max<long>(rect.bottom, letter.top + letter.height);
+        largestHeight = max<int>(largestHeight, letter.height);
+        errorSum += letter.err;
+        nSized++;
+    }
+    if (nSized == 0)
+    {
+        return 1;
+    }
+
+    // add some room around the letters, within the page
+    rect.left = max<long>(rect.left - largestHeight / 4, 0);
+    rect.top = max<long>(rect.top - largestHeight / 4, 0);
+    rect.right = min<long>(rect.right + largestHeight / 4, page.info.Size.cx);
+    rect.bottom = min<long>(rect.bottom + largestHeight / 4,
+                            page.info.Size.cy);
+
+    if (exportCrop(page, rect, prefix + page.namePrefix + to_string(counter),
+                   cropRef) != 0)
+    {
+        countEvent(page.metrics, EVENT_CROP_ERRORS);
+        if (!page.bitmapFailed)
+        {
+            printf("could not export %s%d\n", prefix.c_str(), counter);
+        }
+        return 1;
+    }
+    countEvent(page.metrics, event);
+    counter++;
+
+    const string &imageFile = imagePaths.get(page.imageId);
+    records.append(imageFile.begin(), imageFile.end());
+    records += L'\n';
+    records.append(cropRef.begin(), cropRef.end());
+    records += L'\n';
+    records += to_wstring(number);
+    records += L'\n';
+    records += to_wstring(errorSum / nSized);
+    records += L'\n';
+    records += to_wstring(rect.left) + L' ' + to_wstring(rect.top) + L' ' +
+               to_wstring(rect.right) + L' ' + to_wstring(rect.bottom);
+    records += L'\n';
+    records += text;
+    records += L'\n';
+    records += L'\n';
+    return 0;
+}
+
+
+/*
+ * Exports the lines (-n) and zones (-z) of a recognized page. The lines come
+ * from page.segmenter; the zones are runs of letters with the same zone
+ * number, the zones the engine located before recognition.
+ *
+ * @param page: a page that went through recognizePage()
+ */
+static void exportLayout(PAGE_CONTEXT &page)
+{
+    LETTER *pLetters = page.pLetters;
+    int nLetters = page.nLetters;
+    vector<LETTER_RANGE> words;
+    vector<LETTER_RANGE> lines;
 
-    //put recognition result into wchar buffer
-    fillCharBuffer(pLetters, nLetters, allText);
+    if (nLetters == 0)
+    {
+        return;
+    }
 
-    ifstream currFindFile(toFind);
+    // a new line starts a new word in the text of a zone, too
+    findWords(pLetters, nLetters, page.segmenter, words, &lines);
+    vector<char> wordStarts(nLetters, 0);
+    for (size_t w = 0; w < words.size(); w++)
+    {
+        wordStarts[words[w].first] = 1;
+    }
+    for (size_t k = 0; k < lines.size(); k++)
+    {
+        wordStarts[lines[k].first] = 1;
+    }
 
-    while (getline(currFindFile, findLine))
+    for (size_t k = 0; page.lineOutput && k < lines.size(); k++)
     {
-        allTextPointer = allText;
+        exportLetterRange(page, lines[k], wordStarts, "n-",
+                          page.counters.line, (int) k, EVENT_LINE_CROPS,
+                          page.lineRecords);
+    }
 
-        // create the wchar_t array for toFind
-        findThis = (wchar_t *) malloc(sizeof(wchar_t) *
-                                      (findLine.length() + 1));
+    if (!page.zoneOutput)
+    {
+        return;
+    }
+    LETTER_RANGE zone = {-1, -1};
+    for (int i = 0; i <= nLetters; i++)
+    {
+        if (i < nLetters &&
+            (pLetters[i].width == 0 || pLetters[i].height == 0))
+        {
+            continue;
+        }
+        if (zone.first >= 0 &&
+            (i == nLetters || pLetters[i].zone != pLetters[zone.first].zone))
+        {
+            exportLetterRange(page, zone, wordStarts, "z-",
+                              page.counters.zone, pLetters[zone.first].zone,
+                              EVENT_ZONE_CROPS, page.zoneRecords);
+            zone.first = -1;
+        }
+        if (i < nLetters)
+        {
+            if (zone.first < 0)
+            {
+                zone.first = i;
+            }
+            zone.last = i;
+        }
+    }
+}
 
-        mbstowcs(findThis, findLine.c_str(), findLine.length() + 1);
-        findThis[findLine.length()] = L'\0';  
 
-        // look for the string in the recognition result
-        found = wcsstr(allTextPointer, findThis); // will be NULL if no match found
-        while (found != NULL)
+/*
+ * Runs the export stage of a recognized page, and the line and zone export
+ * if the page has them, and times it as segmentation, without the crops,
+ * which are timed on their own. The letter squares are fitted for the whole
+ * page first.
+ * Returns what exportFunction returns.
+ *
+ * @param page: a page that went through recognizePage()
+ * @param exportFunction: the export stage, e.g. exportAll
+ */
+int exportPage(PAGE_CONTEXT &page,
+               std::function<int(PAGE_CONTEXT &)> exportFunction)
+{
+    int err;
+    double cropSeconds = (page.times != NULL ?
+                          page.times->seconds[STAGE_CROPS] : 0);
+    {
+        STAGE_TIMER timer(page.times, STAGE_SEGMENT);
+
+        // the letter geometry as arrays, and every letter fitted to its own
+        // square in one pass, before anything is exported
+        page.geometry.assign(page.pLetters, page.nLetters);
+        page.letterSquares.resize(page.nLetters);
+        page.wordSquares.resize(page.nLetters);
+        fitSquares(page.geometry, 0, page.nLetters, 0, page.info.Size.cx,
+                   page.info.Size.cy, page.letterSquares);
+
+        err = exportFunction(page);
+        if (page.lineOutput || page.zoneOutput)
         {
+            exportLayout(page);
+        }
+    }
+
+    // the crops are timed on their own, the rest is segmentation
+    if (page.times != NULL)
+    {
+        page.times->seconds[STAGE_SEGMENT] -=
+            page.times->seconds[STAGE_CROPS] - cropSeconds;
+    }
+    return err;
+}
+
+
+/*
+ * Runs all stages for one page: load, recognize, the given export function
+ * and clean up. Returns the first error, or 0 on success.
+ *
+ * @param page: the page to process, page.imageFile is the image to scan
+ * @param exportFunction: the export stage, e.g. exportAll
+ */
+int processPage(PAGE_CONTEXT &page,
+                std::function<int(PAGE_CONTEXT &)> exportFunction)
+{
+    int err = loadPage(page);
+    if (err != 0)
+    {
+        return err;
+    }
+
+    err = recognizePage(page);
+    if (err == 0)
+    {
+        err = exportPage(page, exportFunction);
+    }
+    freePage(page);
+    return err;
+}
+
 
-            index = found - allText;
+/* 
+ * This function takes in an image and exports all words and letters as 
+ * their own image. It writes ocr info (error and result) about the words and
+ * letters into the page buffers.
+ *
+ * @param page: the page to process, page.imageFile is the image to scan.
+ * @param modeInt: the mode of the program:
+ *                      0 (-l) = export letters
+ *                      1 (-w) = export words
+ *                      2 (-b) = export both
+ */
+int extractAll(PAGE_CONTEXT &page, int modeInt)
+{
+    return processPage(page, [&](PAGE_CONTEXT &p)
+                       { return exportAll(p, modeInt); });
+}
+
+
+/*
+ * This function takes in an image file name and processes it so that
+ * we extract only specific words and letters. 
+ *
+ * @param page: the page to process, page.imageFile is the image to scan.
+ * @param modeInt: the mode of the program:
+ *                 0 = export letters, 1 = export words, 2 = export both
+ * @param toFind: the file where the strings to be found are specified.
+ *                 strings in this file should be newline separated
+ */
+int extractStrings(PAGE_CONTEXT &page, int modeInt, string toFind)
+{
+    return processPage(page, [&](PAGE_CONTEXT &p)
+                       { return exportStrings(p, modeInt, toFind); });
+}
+
+
+/*
+ * This function takes in an image file name and processes it so that
+ * we extract only specific exact strings. The ENTIRE string will be
+ * considered one word.
+ *
+ * @param page: the page to process, page.imageFile is the image to scan.
+ * @param modeInt: the mode of the program:
+ *                 0 = export letters, 1 = export words, 2 = export both
+ * @param toFind: the file where the strings to be found are specified.
+ *                 strings in this file should be newline separated
+ */
+int extractExact(PAGE_CONTEXT &page, int modeInt, string toFind)
+{
+    return processPage(page, [&](PAGE_CONTEXT &p)
+                       { return exportExact(p, modeInt, toFind); });
+}
+
+
+/*
+ * This function takes in an image file name and processes it so that
+ * we extract only the words and letters inside the given regions.
+ *
+ * @param page: the page to process, page.imageFile is the image to scan.
+ * @param modeInt: the mode of the program:
+ *                 0 = export letters, 1 = export words, 2 = export both
+ * @param regionFile: the file where the regions of interest are specified,
+ *                    one "<left> <top> <right> <bottom>" per line
+ */
+int extractRegions(PAGE_CONTEXT &page, int modeInt, string regionFile)
+{
+    return processPage(page, [&](PAGE_CONTEXT &p)
+                       { return exportRegions(p, modeInt, regionFile); });
+}
+
+
+/* 
+ * This function takes a recognized page and exports all words and letters as
+ * their own image. It writes ocr info (error and result) about the words and
+ * letters into the page buffers.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: the mode of the program:
+ *                      0 (-l) = export letters
+ *                      1 (-w) = export words
+ *                      2 (-b) = export both
+ * @param segmenter: how the words are found (see ocrSegment.h)
+ */
+int exportAll(PAGE_CONTEXT &page, int modeInt, WORD_SEGMENTER segmenter)
+{
+    LETTER *pLetters = page.pLetters;
+    int nLetters = page.nLetters;
+    vector<LETTER_RANGE> words;
+
+    int end = -1;            // index of the last letter in the current word
+    int prevEnd = -1;        // index of the last letter in the previous word
+
+    findWords(pLetters, nLetters, segmenter, words);
+    for (size_t w = 0; w < words.size(); w++)
+    {
+        int start = words[w].first;
+        end = words[w].last;
+
+        // create the word object and process it
+        OCR_WORD newWord = OCR_WORD(page.imageId, start, end);
+        newWord.processWordandLetters(page, pLetters, modeInt);
+
+        // process letters between the current word and the previous word
+        if (prevEnd > -1 && prevEnd < nLetters && modeInt != 1)
+        {
+            processBetweenWords(page, pLetters, prevEnd, start);
+        }
+
+        prevEnd = end;
+    }
+
+    // process the remaining letters if there are any left
+    if (end < nLetters && (modeInt != 1))
+    {
+        processBetweenWords(page, pLetters, end, nLetters);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Returns true if the letters of a word are the next ones in a sorted list
+ * of letter indices; letters without a size are not in the list and are
+ * skipped.
+ *
+ * @param pLetters: the recognition result for the page
+ * @param inside: the sorted letter indices
+ * @param k: the position of the word's first letter in inside
+ * @param last: the index of the word's last letter
+ */
+static bool wordInside(const LETTER *pLetters, const vector<int> &inside,
+                       size_t k, int last)
+{
+    for (int j = inside[k]; j <= last; j++)
+    {
+        if (pLetters[j].width == 0 || pLetters[j].height == 0)
+        {
+            continue;
+        }
+        if (k >= inside.size() || inside[k] != j)
+        {
+            return false;
+        }
+        k++;
+    }
+    return true;
+}
+
+
+/*
+ * Returns the R-tree of the page's letters, built on the first call for the
+ * page, so every region extractor of a manifest run shares it.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ */
+static const LETTER_INDEX &getLetterIndex(PAGE_CONTEXT &page)
+{
+    if (!page.letterIndex)
+    {
+        page.letterIndex.reset(new LETTER_INDEX(page.pLetters,
+                                                page.nLetters));
+    }
+    return *page.letterIndex;
+}
+
+
+/*
+ * Returns the words of the page and the word of every letter, found on the
+ * first call for the page, and again only if another segmenter is asked
+ * for.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param segmenter: how the words are found (see ocrSegment.h)
+ */
+static const PAGE_WORDS &getPageWords(PAGE_CONTEXT &page,
+                                      WORD_SEGMENTER segmenter)
+{
+    if (page.pageWords && page.pageWords->segmenter == segmenter)
+    {
+        return *page.pageWords;
+    }
+
+    PAGE_WORDS *pageWords = new PAGE_WORDS;
+    pageWords->segmenter = segmenter;
+    pageWords->wordOf.assign(page.nLetters, -1);
+    findWords(page.pLetters, page.nLetters, segmenter, pageWords->words);
+    for (size_t w = 0; w < pageWords->words.size(); w++)
+    {
+        for (int j = pageWords->words[w].first;
+             j <= pageWords->words[w].last; j++)
+        {
+            pageWords->wordOf[j] = (int) w;
+        }
+    }
+    page.pageWords.reset(pageWords);
+    return *pageWords;
+}
+
+
+/*
+ * This function takes a recognized page and exports only the words and
+ * letters inside the regions of a region file. A word is exported if each
+ * of its letters is inside some region, not necessarily the same one, so a
+ * word across two adjoining regions is exported whole; a letter inside a
+ * region whose word is not is exported on its own. Every letter and word
+ * is exported once, in page order, even if regions overlap.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: the mode of the program:
+ *                      0 (-l) = export letters
+ *                      1 (-w) = export words
+ *                      2 (-b) = export both
+ * @param regionFile: the region file of the image (see ocrSpatial.h)
+ * @param segmenter: how the words are found (see ocrSegment.h)
+ */
+int exportRegions(PAGE_CONTEXT &page, int modeInt, string regionFile,
+                  WORD_SEGMENTER segmenter)
+{
+    LETTER *pLetters = page.pLetters;
+    int nLetters = page.nLetters;
+    vector<RECT> regions;
+    vector<int> inside;
+
+    if (readRegions(regionFile, page.pageNumber, regions) != 0)
+    {
+        return 1;
+    }
+    if (regions.empty() || nLetters == 0)
+    {
+        return 0;
+    }
+
+    // find the letters of every region in the page's index
+    const LETTER_INDEX &index = getLetterIndex(page);
+    for (size_t r = 0; r < regions.size(); r++)
+    {
+        index.query(regions[r], inside);
+    }
+    sort(inside.begin(), inside.end());
+    inside.erase(unique(inside.begin(), inside.end()), inside.end());
+
+    const PAGE_WORDS &pageWords = getPageWords(page, segmenter);
+    const vector<LETTER_RANGE> &words = pageWords.words;
+    const vector<int> &wordOf = pageWords.wordOf;
+
+    for (size_t k = 0; k < inside.size(); k++)
+    {
+        int i = inside[k];
+        int w = wordOf[i];
+
+        // a word is inside if its letters are the next ones in the list
+        if (w >= 0 && i == words[w].first && wordInside(pLetters, inside, k,
+                                                        words[w].last))
+        {
+            OCR_WORD newWord = OCR_WORD(page.imageId, i, words[w].last);
+            newWord.processWordandLetters(page, pLetters, modeInt);
+            while (k + 1 < inside.size() && inside[k + 1] <= words[w].last)
+            {
+                k++;
+            }
+        }
+        else if (modeInt != 1)
+        {
+            processBetweenWords(page, pLetters, i - 1, i + 1);
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Returns the compiled strings of a to-find file. Every file is read and
+ * compiled once per run; all pages and threads share the compiled set.
+ * Returns NULL if the file could not be read.
+ *
+ * @param toFind: the to-find file
+ */
+static shared_ptr<const PATTERN_SET> getPatternSet(string toFind)
+{
+    static PATTERN_CACHE cache;
+
+    return cache.get(toFind);
+}
+
+
+/*
+ * Finds the strings of a to-find file in the recognized text of a page.
+ * With fuzzy.maxEdits == 0 every exact occurrence is found in one pass of
+ * the compiled automaton; otherwise every substring within
+ * fuzzy.maxEdits edits is a match. matches[p] holds the matches of the
+ * file's p-th string, leftmost first. Returns 0 on success.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param toFind: the to-find file
+ * @param fuzzy: the fuzzy search options
+ * @param matches: set to the matches of every string
+ */
+static int findMatches(PAGE_CONTEXT &page, string toFind,
+                       const FUZZY_OPTIONS &fuzzy,
+                       vector<vector<FUZZY_MATCH> > &matches)
+{
+    shared_ptr<const PATTERN_SET> findSet = getPatternSet(toFind);
+    if (findSet == NULL)
+    {
+        return 1;
+    }
+
+    // put recognition result into wchar buffer
+    vector<wchar_t> allText(page.nLetters + 1);
+    fillCharBuffer(page.pLetters, page.nLetters, &allText[0]);
+    int length = wcslen(&allText[0]);
+
+    matches.assign(findSet->getPatternCount(), vector<FUZZY_MATCH>());
+    if (length == 0)
+    {
+        return 0;
+    }
+    if (fuzzy.maxEdits <= 0)
+    {
+        // find all strings in one pass over the recognition result
+        vector<vector<int> > starts;
+        findSet->findAll(&allText[0], length, starts);
+        for (size_t p = 0; p < starts.size(); p++)
+        {
+            for (size_t m = 0; m < starts[p].size(); m++)
+            {
+                FUZZY_MATCH match;
+                match.start = starts[p][m];
+                match.length = findSet->getPattern(p).length();
+                match.cost = 0;
+                matches[p].push_back(match);
+            }
+        }
+        return 0;
+    }
+
+    vector<unsigned char> errors(length);
+    for (int i = 0; i < length; i++)
+    {
+        errors[i] = page.pLetters[i].err;
+    }
+    for (size_t p = 0; p < findSet->getPatternCount(); p++)
+    {
+        findApproximate(findSet->getPattern(p), &allText[0], &errors[0],
+                        length, fuzzy, matches[p]);
+    }
+    return 0;
+}
+
+
+/*
+ * This function takes a recognized page and processes it so that
+ * we extract only specific words and letters. 
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: the mode of the program:
+ *                 0 = export letters, 1 = export words, 2 = export both
+ * @param toFind: the file where the strings to be found are specified.
+ *                 strings in this file should be newline separated
+ * @param fuzzy: the fuzzy search options, maxEdits 0 for exact matches
+ */
+int exportStrings(PAGE_CONTEXT &page, int modeInt, string toFind,
+                  FUZZY_OPTIONS fuzzy)
+{
+    LETTER *pLetters = page.pLetters;
+
+    bool foundEnd = FALSE;
+    bool foundStart = TRUE;
+    int start;          // index of first letter in current word
+    int end;            // index of last letter in current word
+    int prevEnd;        // index of last letter in previous word
+    int index;          // index to mark position in allText
+    int length;         // length of the current match
+
+    vector<vector<FUZZY_MATCH> > matches;
+    if (findMatches(page, toFind, fuzzy, matches) != 0)
+    {
+        return 1;
+    }
+
+    for (size_t p = 0; p < matches.size(); p++)
+    {
+        for (size_t m = 0; m < matches[p].size(); m++)
+        {
+            index = matches[p][m].start;
+            length = matches[p][m].length;
         
             start = index;
             end = index - 1;
@@ -817,7 +1748,7 @@ int extractStrings(HPAGE hPage, string imageIn, string outputLetter,
             foundStart = TRUE;
 
             // go through all the letters in the matching string
-            for (int j = index; j < index + findLine.length(); j++)
+            for (int j = index; j < index + length; j++)
             {  
                 prevEnd = -1;
                 // pull out the words from the matching string and process them
@@ -829,17 +1760,14 @@ int extractStrings(HPAGE hPage, string imageIn, string outputLetter,
                     foundEnd = TRUE;
 
                     // create the word object and process it
-                    OCR_WORD newWord = OCR_WORD(imageIn, start, end);
-                    newWord.processWordandLetters(hPage, pLetters, outFileLetter, 
-                                                  outputLetter, outFileWord, 
-                                                  outputWord, info, modeInt);
+                    OCR_WORD newWord = OCR_WORD(page.imageId, start, end);
+                    newWord.processWordandLetters(page, pLetters, modeInt);
 
                     // process letters between the current word and the previous word
-                    if (prevEnd > -1 && prevEnd < index + findLine.length() && 
+                    if (prevEnd > -1 && prevEnd < index + length && 
                         modeInt != 1)
                     {       
-                        processBetweenWords(hPage, info, pLetters, prevEnd, start,
-                                            outFileLetter, outputLetter, imageIn);
+                        processBetweenWords(page, pLetters, prevEnd, start);
                     }
                     prevEnd = end;
                 }
@@ -857,179 +1785,58 @@ int extractStrings(HPAGE hPage, string imageIn, string outputLetter,
             }
           
              // process the remaining letters if there are any left
-            if (end < (index + findLine.length()) && (modeInt != 1))
+            if (end < (index + length) && (modeInt != 1))
             {
                 
-                processBetweenWords(hPage, info, pLetters, end, 
-                                    (index + findLine.length()), outFileLetter,
-                                     outputLetter, imageIn);
-            }
-            
-            // move the current pointer up to search the rest of the text
-            allTextPointer = (found + findLine.length());
-
-            if ((allTextPointer - allText) > nLetters)
-            {
-                // break if we've searched the whole text
-                break; 
+                processBetweenWords(page, pLetters, end, (index + length));
             }
-            found = wcsstr(allTextPointer, findThis);
         }
-
-        // clean stuff up
-        outFileLetter.flush();
-        outFileWord.close();
-        outFileWord.flush();
-        outFileLetter.close();
-        free(findThis);
-
     }
-    
-    
 
-    free(allText);
-    kRecFreeImg(hPage);
-    rc = kRecFree(pLetters);
-    kRecQuit();
     return 0;
 }
 
 
 /*
- * This function takes in an image file name and processes it so that
+ * This function takes a recognized page and processes it so that
  * we extract only specific exact strings. In this case, we do not break
  * the string down into many words. The ENTIRE string will be considered
  * one word.
  *
- * @param hPage: the current page
- * @param imageIn: filename of the image to scan
- * @param outputLetter: filename of the text file where letter results will be
- *                      written
- * @param outputString: filename of the text file where word results will be
- *                     written
+ * @param page: a page that went through loadPage() and recognizePage()
  * @param modeInt: the mode of the program:
  *                 0 = export letters, 1 = export words, 2 = export both
  * @param toFind: the file where the strings to be found are specified.
  *                 strings in this file should be newline separated
+ * @param fuzzy: the fuzzy search options, maxEdits 0 for exact matches
  */
-int extractExact(HPAGE hPage, string imageIn, string outputLetter,
-                   string outputWord, int modeInt, string toFind)
+int exportExact(PAGE_CONTEXT &page, int modeInt, string toFind,
+                FUZZY_OPTIONS fuzzy)
 {
-    RECERR rc;
-    int err;
-    IMG_INFO info;
-    
-    LETTER *pLetters;
-    int nLetters;
-    
-    // Loading the image to scan
-    rc = kRecLoadImgF(SID, imageIn.c_str(), &hPage, PAGE_NUMBER_0);
-    if (rc != REC_OK)
-    {
-        printf("Error code = %X\n", rc);
-        printf("LoadError! %s\n", imageIn.c_str());
-        kRecQuit();
-        return 1;
-    }
-    
-    // Preprocessing page with default settings
-    rc = kRecPreprocessImg(SID, hPage);
-    if (rc != REC_OK)
-    {
-        printf("Error code = %X\n", rc);
-        kRecFreeImg(hPage);
-        kRecQuit();
-        return 1;
-    }
-    
-    // get the page info (page size, resolution, etc..)
-    rc = kRecGetImgInfo(SID, hPage, II_CURRENT, &info);
-    
-    // automatically locate zones
-    rc = kRecLocateZones(SID, hPage);  
+    LETTER *pLetters = page.pLetters;
 
-    // Recognizing page
-    rc = kRecRecognize(SID, hPage, NULL);
-    if (rc != REC_OK)
+    int index;          // index to mark position in allText
+    int length;         // length of the current match
+
+    vector<vector<FUZZY_MATCH> > matches;
+    if (findMatches(page, toFind, fuzzy, matches) != 0)
     {
-        printf("Error code = %X\n", rc);
-        kRecFreeImg(hPage);
-        kRecQuit();
-        return (rc==NO_TXT_WARN?2:1);
+        return 1;
     }
-    
-    // Get recognition result
-    rc = kRecGetLetters(hPage, II_CURRENT, &pLetters, &nLetters);
-
-    wofstream outFileWord;      // ofstream for printing word output
-    wofstream outFileLetter;    // ofstream for printing letter output
-
-    wchar_t *allText;           // stores the entire array of recog. letters
-    wchar_t *allTextPointer;    // a ptr to mark the current position in allText
-    wchar_t *found;             // pointer to where we find a match of toFind
-    wchar_t *findThis;          // the toFind string as a wchar_t array
-
-    ptrdiff_t index;    // index to mark position in allText
-    string findLine;
 
-    // malloc a buffer to store recognition result
-    allText = (wchar_t *) malloc(sizeof(wchar_t) * (nLetters + 1));
-
-    //put recognition result into wchar buffer
-    fillCharBuffer(pLetters, nLetters, allText);
-
-    ifstream currFindFile(toFind);
-
-    while (getline(currFindFile, findLine))
+    for (size_t p = 0; p < matches.size(); p++)
     {
-        allTextPointer = allText;
-
-        // create the wchar_t array for toFind
-        findThis = (wchar_t *) malloc(sizeof(wchar_t) *
-                                      (findLine.length() + 1));
-
-        mbstowcs(findThis, findLine.c_str(), findLine.length() + 1);
-        findThis[findLine.length()] = L'\0';  
-
-        // look for the string in the recognition result
-        found = wcsstr(allTextPointer, findThis); // will be NULL if no match found
-        while (found != NULL)
+        for (size_t m = 0; m < matches[p].size(); m++)
         {
-
-            index = found - allText;
+            index = matches[p][m].start;
+            length = matches[p][m].length;
 
             // create the word(string) object and process it
-            OCR_WORD newWord = OCR_WORD(imageIn, index, index - 1 + (findLine.length()));
-            newWord.processWordandLetters(hPage, pLetters, outFileLetter, 
-                                          outputLetter, outFileWord, 
-                                          outputWord, info, modeInt);
-
-            
-            // move the current pointer up to search the rest of the text
-            allTextPointer = (found + findLine.length());
-
-            if ((allTextPointer - allText) > nLetters)
-            {
-                // break if we've searched the whole text
-                break; 
-            }
-            found = wcsstr(allTextPointer, findThis);
+            OCR_WORD newWord = OCR_WORD(page.imageId, index,
+                                        index - 1 + length);
+            newWord.processWordandLetters(page, pLetters, modeInt);
         }
-
-        // clean stuff up
-        outFileLetter.flush();
-        outFileWord.close();
-        outFileWord.flush();
-        outFileLetter.close();
-        free(findThis);
     }
      
-    free(allText);
-    kRecFreeImg(hPage);
-    rc = kRecFree(pLetters);
-    kRecQuit();
     return 0;
 }
-
-
-
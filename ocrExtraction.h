@@ -4,8 +4,14 @@
  * This is the header file for the ocrExtraction.cpp program
  ***************************************************************************/
 
+#ifndef OCR_EXTRACTION_H
+#define OCR_EXTRACTION_H
+
 // Please set the next macro to 0 if you want to use a non-OEM license!
+// (builds against the stand-in engine in fake/ pass -DUSE_OEM_LICENSE=0)
+#ifndef USE_OEM_LICENSE
 #define USE_OEM_LICENSE 1
+#endif
 
 #if USE_OEM_LICENSE
 // TODO: enter path to your license file below
@@ -34,22 +40,256 @@
 #include <fstream>
 #include <string.h>
 #include "KernelApi.h"
+#include "ocrOutput.h"
+#include "ocrBinary.h"
+#include "ocrCrop.h"
+#include "ocrTensor.h"
+#include "ocrSpatial.h"
+#include "ocrSegment.h"
+#include "ocrSearch.h"
+#include "ocrFuzzy.h"
+#include "ocrArena.h"
+#include "ocrTiming.h"
+#include "ocrMetrics.h"
 #include <iostream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <wchar.h>
 
 
+/*
+ * Counters used to name the exported bBox images ("l-<n>", "w-<n>", and
+ * "n-<n>"/"z-<n>" for lines and zones).
+ */
+struct CROP_COUNTERS
+{
+    int letter;      // number of the next letter image
+    int word;        // number of the next word image
+    int line;        // number of the next line image
+    int zone;        // number of the next zone image
+};
+
+
+class RUN_JOURNAL;
+class RECOGNITION_CACHE;
+
+
+/*
+ * The text sinks of one extractor of a manifest run (see extractBatch.cpp).
+ */
+struct EXTRACTOR_SINKS
+{
+    OCR_SINK *letters;
+    OCR_SINK *words;
+};
+
+
+/*
+ * The sinks a run writes its results to. Pages hand their buffered records
+ * to these in list order, see appendPageRecords(). Every sink starts out
+ * as none; the drivers set the ones they use by name.
+ */
+struct OUTPUT_SINKS
+{
+    OCR_SINK *letters = NULL;   // text records for letters
+    OCR_SINK *words = NULL;     // text records for words
+    BINARY_SINK *binary = NULL; // letter/word tables, NULL for text output
+    CROP_SINK *crops = NULL;    // where bBox images cut in memory go, NULL
+                                // to save them with kRecSaveImgAreaF
+    RUN_JOURNAL *journal = NULL;    // checkpoints after every page, NULL
+                                    // for none
+    RECOGNITION_CACHE *cache = NULL;    // recognition results of earlier
+                                        // runs, NULL to always recognize
+    std::vector<EXTRACTOR_SINKS> extractors;    // manifest runs: the sinks
+                                // of every extractor, for the records in
+                                // page.extractorRecords
+    RUN_METRICS *metrics = NULL;    // counters and timers of the run, NULL
+                                    // for none
+    CROP_FORMAT cropFormat = CROP_TIFF; // the format of bBox images saved by
+                                // the engine (crops cut in memory are
+                                // written by the crop sink)
+    TENSOR_SINK *tensors = NULL;    // letter tensors for training, NULL for
+                                    // none
+    OCR_SINK *lines = NULL;     // text records for lines, NULL for none
+    OCR_SINK *zones = NULL;     // text records for zones, NULL for none
+    WORD_SEGMENTER segmenter = SEGMENT_ENGINE;  // how the lines are found
+};
+
+
+/*
+ * The text records one extractor of a manifest run wrote for a page.
+ */
+struct EXTRACTOR_RECORDS
+{
+    std::wstring letterRecords;
+    std::wstring wordRecords;
+};
+
+
+/*
+ * The words of a page and the word of every letter, found once per page
+ * for the region queries (see exportRegions).
+ */
+struct PAGE_WORDS
+{
+    WORD_SEGMENTER segmenter;           // how the words were found
+    std::vector<LETTER_RANGE> words;    // the words, in page order
+    std::vector<int> wordOf;            // the word of every letter, -1 for
+                                        // none
+};
+
+
+/*
+ * PAGE_CONTEXT holds the state of the page that is currently being
+ * processed. Every page gets its own context, so pages can be processed on
+ * different threads at the same time.
+ *
+ * A page goes through three stages: loadPage(), recognizePage() and an
+ * export function (e.g. exportAll). Each stage only touches the context,
+ * so the stages of different pages can run at the same time.
+ *
+ * Letter and word records are written to the context's buffers instead of
+ * straight to the output files; appendPageRecords() hands them to the
+ * output sinks once the page is done.
+ */
+struct PAGE_CONTEXT
+{
+    int sid;                    // settings collection to use for this page
+    HPAGE hPage;                // the current page in the ocr process
+    IMG_INFO info;              // the dimensions of the current page
+    std::string imageFile;      // the current image path
+    int pageNumber;             // the page of imageFile (0 = first)
+    int pageCount;              // the number of pages in imageFile
+    uint32_t imageId;           // the image name of the records (imageFile,
+                                // with "#<page>" for multi-page files)
+                                // interned in imagePaths
+    size_t index;               // position of the page in the image list
+
+    LETTER *pLetters;           // the recognition result for the page
+    int nLetters;               // the number of LETTERS in pLetters
+
+    RECOGNITION_CACHE *cache;   // NULL to always recognize
+    std::string cacheEntry;     // the cache file of the page
+    std::vector<LETTER> cachedLetters;  // the letters of a cache hit,
+                                        // pLetters then points here
+
+    std::string namePrefix;     // put in front of the counter in image names
+    CROP_COUNTERS counters;     // numbers for the next letter/word images
+
+    bool binaryOutput;           // write binary records instead of text
+    std::wstring letterRecords;  // letter info for this page
+    std::wstring wordRecords;    // word info for this page
+    std::vector<BINARY_LETTER> binaryLetters;   // binary letter info
+    std::vector<BINARY_WORD> binaryWords;       // binary word info
+    std::vector<EXTRACTOR_RECORDS> extractorRecords;    // manifest runs:
+                                // the records of every extractor
+
+    bool lineOutput;            // export the lines of the page
+    bool zoneOutput;            // export the zones of the page
+    WORD_SEGMENTER segmenter;   // how the lines are found
+    std::wstring lineRecords;   // line info for this page
+    std::wstring zoneRecords;   // zone info for this page
+
+    CROP_SINK *cropSink;        // NULL to save bBoxes with kRecSaveImgAreaF
+    CROP_FORMAT cropFormat;     // the format kRecSaveImgAreaF saves them in
+    LPBYTE pBitmap;             // the page bitmap, fetched on the first crop
+    IMG_INFO bitmapInfo;        // the layout of pBitmap
+    bool bitmapFailed;          // the bitmap could not be fetched, or not
+                                // be cut (reported once per page)
+
+    int tensorSize;             // N of the letter tensors, 0 for none
+    std::vector<BYTE> tensorPixels;             // the page's letter tensors
+    std::vector<TENSOR_LABEL> tensorLabels;     // and their labels
+
+    LETTER_GEOMETRY geometry;   // the letter bBoxes as arrays, and the
+    LETTER_SQUARES letterSquares;   // squares of the letters on their own,
+                                    // both set by exportPage()
+    LETTER_SQUARES wordSquares; // the squares of the current word's letters
+
+    std::unique_ptr<LETTER_INDEX> letterIndex;  // the letters as an R-tree
+    std::unique_ptr<PAGE_WORDS> pageWords;      // and their words, both
+                                // built by the first region query of the
+                                // page and dropped by freePage()
+
+    PAGE_ARENA *arena;          // the page's OCR_LETTERs and OCR_WORDs,
+                                // reset by freePage(): the runner's arena
+                                // (see useArena) or ownArena
+    PAGE_ARENA ownArena;        // the arena of a page without a runner
+
+    PAGE_TIMES *times;          // time spent per stage, NULL if not timed
+
+    RUN_METRICS *metrics;       // the run's counters, NULL for none
+    PAGE_TIMES runTimes;        // the stage times of a run with metrics,
+                                // page.times points here (see useMetrics)
+
+    PAGE_CONTEXT() : sid(SID), hPage(NULL), pageNumber(PAGE_NUMBER_0),
+                     pageCount(1), imageId(0), index(0),
+                     pLetters(NULL), nLetters(0), cache(NULL),
+                     binaryOutput(false), lineOutput(false),
+                     zoneOutput(false), segmenter(SEGMENT_ENGINE),
+                     cropSink(NULL), cropFormat(CROP_TIFF), pBitmap(NULL),
+                     bitmapFailed(false), tensorSize(0), arena(&ownArena), times(NULL),
+                     metrics(NULL)
+    {
+        counters.letter = 0;
+        counters.word = 0;
+        counters.line = 0;
+        counters.zone = 0;
+    }
+
+    // writes the page's records and crops to the given sinks
+    void useSinks(OUTPUT_SINKS &sinks)
+    {
+        binaryOutput = (sinks.binary != NULL);
+        cropSink = sinks.crops;
+        cropFormat = sinks.cropFormat;
+        tensorSize = (sinks.tensors != NULL ? sinks.tensors->getSize() : 0);
+        lineOutput = (sinks.lines != NULL);
+        zoneOutput = (sinks.zones != NULL);
+        segmenter = sinks.segmenter;
+        cache = sinks.cache;
+        useMetrics(sinks.metrics);
+    }
+
+    // creates the page's objects in an arena that outlives the page, so
+    // the next page on the same thread reuses its blocks
+    void useArena(PAGE_ARENA &runArena)
+    {
+        arena = &runArena;
+    }
+
+    // counts and times the page in the given run metrics (NULL for none)
+    void useMetrics(RUN_METRICS *runMetrics)
+    {
+        metrics = runMetrics;
+        if (metrics != NULL)
+        {
+            times = &runTimes;
+        }
+    }
+};
+
+
+class OCR_WORD;
+
+
+/*
+ * OCR_LETTER and OCR_WORD are created in the page arena and dropped with
+ * it, so they only hold plain data: the image path is an id in imagePaths
+ * and strings live in the arena.
+ */
 class OCR_LETTER
 {
 private:
     
-    std::string imageFile;   // the path/name of the image this letter comes from
-    std::string bBoxFile;    // the image we will create for this letter
+    uint32_t imageId;        // the image this letter comes from, in imagePaths
+    const char *bBoxFile;    // the image we will create for this letter
     
     int error;              // error of the text, [0, 256], lower error means
                             // good recognition
-    int squareSize;         // the size of one side of the bBox square
     bool inWord;            // True if this letter is part of a word
 
     
@@ -64,16 +304,17 @@ private:
 public:
     
     // constructor
-    OCR_LETTER(std::string file, int err, wchar_t letter, int sqSize,
-               bool insideWord);
+    OCR_LETTER(uint32_t image, int err, wchar_t letter, bool insideWord);
 
-    std::string getbBoxFile() { return bBoxFile; }
+    const char *getbBoxFile() { return bBoxFile; }
 
-    void printLetterToOutput(std::wofstream& outFile, std::string letterOut);
+    void printLetterToOutput(std::wstring& out);
 
-    int exportLetter(HPAGE hPage, IMG_INFO info, std::wofstream& outFileLetter,
-                    std::string letterOut, LETTER currLetter, 
-                    std::vector<OCR_LETTER *> &letters, int modeInt);
+    void printLetterToBinary(std::vector<BINARY_LETTER>& out, uint32_t cropId);
+
+    int exportLetter(PAGE_CONTEXT &page, const LETTER &currLetter,
+                     const LETTER_SQUARES &squares, int index,
+                     OCR_WORD *word, int modeInt);
 };
 
 
@@ -81,8 +322,8 @@ class OCR_WORD
 {
 private:
     
-    std::string imageFile;             // the image the word comes from
-    std::string bBoxFile;              // the image we will create for this word
+    uint32_t imageId;                  // the image the word comes from
+    const char *bBoxFile;              // the image we will create for this word
 
 
     int averageError;                  // average error of letters in word
@@ -95,21 +336,59 @@ private:
     int right;
     int bottom;
 
-    std::wstring word;                 // the word itself
-    std::vector<OCR_LETTER *> letters;   // the letters in this word
+    const wchar_t *word;               // the word itself, in the page arena
+    OCR_LETTER **letters;              // the letters in this word, in the
+    int nLetters;                      // page arena
 
 public:
     // constructor
-    OCR_WORD(std::string file, int start, int end);
+    OCR_WORD(uint32_t image, int start, int end);
+
+    // adds an exported letter to the word
+    void addLetter(OCR_LETTER *letter) { letters[nLetters++] = letter; }
+
+    void printWordToOutput(std::wstring& out);
+
+    void printWordToBinary(std::vector<BINARY_WORD>& out, uint32_t cropId,
+                           size_t firstLetter);
+
+    int processWordandLetters(PAGE_CONTEXT &page, LETTER *pLetters,
+                              int modeInt);
+};
+
+
+/*
+ * OCR_ENGINE owns the engine session for the whole run. The license check,
+ * kRecInit and the recognition module load happen once in the constructor,
+ * and kRecQuit is called once in the destructor. Drivers create one engine
+ * before their image loop and keep it for every page.
+ */
+class OCR_ENGINE
+{
+private:
+
+    bool ready;      // true if setUp() succeeded and the engine is usable
+    int sid;         // settings collection used for recognition and export
+
+public:
+    // constructor, starts the engine
+    OCR_ENGINE();
+
+    bool isReady() { return ready; }
+    int getSID() { return sid; }
+
+    // creates and configures an extra settings collection, so each worker
+    // thread can recognize with its own settings ID. Returns 0 on success.
+    int createSettings(int &newSID);
+
+    // releases a settings collection made by createSettings()
+    void releaseSettings(int oldSID);
 
-    void printWordToOutput(std::wofstream& outFile, std::string outWord);
+    // destructor, shuts the engine down
+    ~OCR_ENGINE();
 
-    int processWordandLetters(HPAGE hPage, LETTER *pLetters, 
-                              std::wofstream& outFileLetter, std::string outLetter,
-                              std::wofstream& outFileWord, std::string outWord, 
-                              IMG_INFO info, int modeInt);
-    // destructor
-    ~OCR_WORD();
+    OCR_ENGINE(const OCR_ENGINE &) = delete;
+    OCR_ENGINE &operator=(const OCR_ENGINE &) = delete;
 };
 
 
@@ -121,10 +400,22 @@ public:
  * - sets the default recognition module.
  * The fuction returns 0 for success.
  * Right now, these things are all set to semi-default options for testing.
+ *
+ * NOTE: use OCR_ENGINE instead of calling this directly, so the engine is
+ *       only started once per process.
  */
 extern int setUp();
 
 
+/*
+ * Applies our recognition settings (recognition module, output format) to
+ * the given settings collection. Returns 0 on success.
+ *
+ * @param sid: the settings collection to configure
+ */
+extern int configureSettings(int sid);
+
+
 /*
  * The function copies our LETTER characters into the given WCHAR buffer.
  * This function returns 0 on success.
@@ -145,50 +436,194 @@ extern int fillCharBuffer(LETTER *pLetters, int nLetters, wchar_t *buffer);
  * Crops the current page image into the rectangle given and exports the
  * rectangle into its own image.
  *
+ * @param sid: the settings collection to use
  * @param hPage: the current page
  * @param rect: the RECT structure to export
  * @param name: the filename to give to the new image file
+ * @param metrics: the run metrics that time the call, or NULL
+ * @param format: the file format of the image
  */
-extern int exportRect(HPAGE hPage, RECT rect, char *name);
+extern int exportRect(int sid, HPAGE hPage, RECT rect, char *name,
+                      RUN_METRICS *metrics = NULL,
+                      IMF_FORMAT format = FF_TIFNO);
+
+
+/*
+ * Exports the rectangle of the page as the bBox image with the given name.
+ * Without a crop sink the engine saves it to "<name>.tiff" (exportRect).
+ * With a crop sink, the page bitmap is fetched once per page and the
+ * rectangle is cut out of it in memory and handed to the sink.
+ * This function returns 0 on success.
+ *
+ * @param page: the current page
+ * @param rect: the rectangle to export
+ * @param name: the name of the bBox image, without extension
+ * @param ref: set to the name the records should use for the image
+ */
+extern int exportCrop(PAGE_CONTEXT &page, RECT rect, std::string name,
+                      std::string &ref);
+
+
+/*
+ * Resamples the rectangle of the page to a page.tensorSize square tensor
+ * and adds it, with its label, to the page's tensor buffers. The page
+ * bitmap is shared with exportCrop. This function returns 0 on success.
+ *
+ * @param page: the current page
+ * @param rect: the square bBox of the letter
+ * @param code: the ocr result of the letter
+ * @param err: the error of the letter
+ * @param cropId: the number of the letter's bBox image, or BINARY_NO_CROP
+ */
+extern int exportTensor(PAGE_CONTEXT &page, RECT rect, uint32_t code,
+                        int err, uint32_t cropId);
 
 
 /*
  * This function processes just the letters from index prevEnd to currStart.
  * We can use this function to extract the letters that are not part of a word.
  *
- * @param hPage: the current page in the ocr process
- * @param info: stores the dimensions of the current page
+ * @param page: the current page in the ocr process
  * @param pLetters: the recognition result for the page
  * @param prevEnd: the index to start letter extraction
  * @param currStart: the end index for letter extraction
- * @param outFileLetter: stream to print letter info
- * @param outLetter: name of file to print letter info to
- * @param imageFile: the current image path as a string
  *
  */
-extern int processBetweenWords(HPAGE hPage, IMG_INFO info, LETTER *pLetters, 
-                           int prevEnd, int currStart, wofstream& outFileLetter, 
-                           string outLetter, string imageFile);
+extern int processBetweenWords(PAGE_CONTEXT &page, LETTER *pLetters, 
+                               int prevEnd, int currStart);
+
+
+/*
+ * Loads the image of the page and preprocesses it with default settings.
+ * This is the first stage of processing a page. The function returns 0 on
+ * success; on failure the page holds no image.
+ *
+ * @param page: the page to load, page.imageFile is the image to scan
+ */
+extern int loadPage(PAGE_CONTEXT &page);
+
+
+/*
+ * Locates the zones of a loaded page, recognizes it and gets the
+ * recognition result into page.pLetters. This is the second stage of
+ * processing a page. The function returns 0 on success, 2 if there was no
+ * text on the page and 1 on other errors.
+ *
+ * @param page: a page that went through loadPage()
+ */
+extern int recognizePage(PAGE_CONTEXT &page);
+
+
+/*
+ * Frees the recognition result and the image of the page.
+ *
+ * @param page: the page to clean up
+ */
+extern void freePage(PAGE_CONTEXT &page);
+
+
+/*
+ * Runs the export stage of a recognized page. With page.times, the time
+ * it takes is added to STAGE_SEGMENT, without the time of the crops (which
+ * exportCrop adds to STAGE_CROPS). Returns what exportFunction returns.
+ *
+ * @param page: a page that went through recognizePage()
+ * @param exportFunction: the export stage, e.g. exportAll
+ */
+extern int exportPage(PAGE_CONTEXT &page,
+                      std::function<int(PAGE_CONTEXT &)> exportFunction);
+
+
+/*
+ * Runs all stages for one page: load, recognize, the given export function
+ * and clean up. Returns the first error, or 0 on success.
+ *
+ * @param page: the page to process, page.imageFile is the image to scan
+ * @param exportFunction: the export stage, e.g. exportAll
+ */
+extern int processPage(PAGE_CONTEXT &page,
+                       std::function<int(PAGE_CONTEXT &)> exportFunction);
+
+
+/*
+ * The export stage for extractAll: exports all words and letters of a
+ * recognized page and writes their info into the page buffers.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: 0 (-l) = export letters, 1 (-w) = export words,
+ *                 2 (-b) = export both
+ * @param segmenter: how the words are found (see ocrSegment.h)
+ */
+extern int exportAll(PAGE_CONTEXT &page, int modeInt,
+                     WORD_SEGMENTER segmenter = SEGMENT_ENGINE);
+
+
+/*
+ * The export stage for extractRegions: exports the words and letters of a
+ * recognized page that lie inside the regions of a region file, found with
+ * a spatial index of the page's letters (see ocrSpatial.h).
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: 0 (-l) = export letters, 1 (-w) = export words,
+ *                 2 (-b) = export both
+ * @param regionFile: the region file of the image
+ * @param segmenter: how the words are found (see ocrSegment.h)
+ */
+extern int exportRegions(PAGE_CONTEXT &page, int modeInt,
+                         std::string regionFile,
+                         WORD_SEGMENTER segmenter = SEGMENT_ENGINE);
+
+
+/*
+ * The export stage for extractStrings: finds the strings of the toFind file
+ * in a recognized page and exports their words and letters.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: 0 = export letters, 1 = export words, 2 = export both
+ * @param toFind: the file where the strings to be found are specified
+ * @param fuzzy: -k/-e options; by default only exact matches are found
+ */
+extern int exportStrings(PAGE_CONTEXT &page, int modeInt, std::string toFind,
+                         FUZZY_OPTIONS fuzzy = FUZZY_OPTIONS());
+
+
+/*
+ * The export stage for extractExact: finds the strings of the toFind file
+ * in a recognized page and exports each match as one word.
+ *
+ * @param page: a page that went through loadPage() and recognizePage()
+ * @param modeInt: 0 = export letters, 1 = export words, 2 = export both
+ * @param toFind: the file where the strings to be found are specified
+ * @param fuzzy: -k/-e options; by default only exact matches are found
+ */
+extern int exportExact(PAGE_CONTEXT &page, int modeInt, std::string toFind,
+                       FUZZY_OPTIONS fuzzy = FUZZY_OPTIONS());
+
+
+/*
+ * Hands the letter and word records buffered in the page context to the
+ * output sinks and clears the page buffers.
+ * This function returns 0 on success.
+ *
+ * @param page: the page whose records we write
+ * @param sinks: the sinks of the run
+ */
+extern int appendPageRecords(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks);
 
 
 /*
  * This function takes in an image file name and processes it so that
  * we extract only specific words and letters. 
  *
- * @param hPage: the current page
- * @param imageIn: filename of the image to scan
- * @param outputLetter: filename of the text file where letter results will be
- *                      written
- * @param outputWord: filename of the text file where word results will be
- *                     written
+ * @param page: the page to process, page.imageFile is the image to scan.
+ *              Letter and word results are written to the page buffers.
  * @param modeInt: the mode of the program:
  *                 0 = export letters, 1 = export words, 2 = export both
  * @param toFind: the file where the strings to be found are specified.
  *                 strings in this file should be newline separated
  */
-extern int extractStrings(HPAGE hPage, std::string imageIn, 
-                          std::string outputLetter, std::string outputWord, 
-                          int modeInt, std::string toFind);
+extern int extractStrings(PAGE_CONTEXT &page, int modeInt,
+                          std::string toFind);
 
 
 /* 
@@ -196,21 +631,14 @@ extern int extractStrings(HPAGE hPage, std::string imageIn,
  * their own image. It writes ocr info (error and result) about the words and
  * letters into the specified files.
  *
- * @param hPage: the current page
- * @param ImageIn: filename of the image to scane
- * @param outputLetter: filename of the text file where letter results will be
- *                      written
- * @param outputWord: filename of the text file where word results will be
- *                     written
+ * @param page: the page to process, page.imageFile is the image to scan.
+ *              Letter and word results are written to the page buffers.
  * @param modeInt: the mode of the program:
  *                      0 (-l) = export letters
  *                      1 (-w) = export words
  *                      2 (-b) = export both
  */
-extern int extractAll(HPAGE hPage, std::string imageIn,
-                       std::string outputLetter,
-                       std::string outputWord,
-                       int modeInt);
+extern int extractAll(PAGE_CONTEXT &page, int modeInt);
 
 
 
@@ -220,19 +648,30 @@ extern int extractAll(HPAGE hPage, std::string imageIn,
  * the string down into many words. The ENTIRE string will be considered
  * one word.
  *
- * @param hPage: the current page
- * @param imageIn: filename of the image to scan
- * @param outputLetter: filename of the text file where letter results will be
- *                      written
- * @param outputWord: filename of the text file where word results will be
- *                      written
+ * @param page: the page to process, page.imageFile is the image to scan.
+ *              Letter and word results are written to the page buffers.
  * @param modeInt: the mode of the program:
  *                 0 = export letters, 1 = export words, 2 = export both
  * @param toFind: the file where the strings to be found are specified.
  *                 strings in this file should be newline separated
  */
  
-extern int extractExact(HPAGE hPage, std::string imageIn, 
-                        std::string outputLetter,
-                        std::string outputWord, 
-                        int modeInt, std::string toFind);
+extern int extractExact(PAGE_CONTEXT &page, int modeInt,
+                        std::string toFind);
+
+
+/*
+ * This function takes in an image file name and processes it so that
+ * we extract only the words and letters inside the regions of interest.
+ *
+ * @param page: the page to process, page.imageFile is the image to scan.
+ *              Letter and word results are written to the page buffers.
+ * @param modeInt: the mode of the program:
+ *                 0 = export letters, 1 = export words, 2 = export both
+ * @param regionFile: the file where the regions are specified, one
+ *                    "<left> <top> <right> <bottom>" per line
+ */
+extern int extractRegions(PAGE_CONTEXT &page, int modeInt,
+                          std::string regionFile);
+
+#endif
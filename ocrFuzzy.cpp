@@ -0,0 +1,286 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrFuzzy.h
+ *
+ * The search works in two steps:
+ *
+ *  1. find the ends j of all substrings that are at most B unit-cost edits
+ *     away from the pattern (Myers, or Sellers for long patterns). A
+ *     substitution costs at least 1 - W, so a match of weighted cost K has
+ *     at most B = floor(K / (1 - W)) unit-cost edits and is never missed.
+ *  2. for every end found, compute the weighted cost of the best match
+ *     ending there, and where it starts.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrFuzzy.h"
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <utility>
+
+
+using namespace std;
+
+
+/*
+ * Finds the ends of all substrings of the text that are at most bound
+ * unit-cost edits away from the pattern, for patterns of up to 64 letters.
+ * This is Myers' bit-vector algorithm: bit i of the vectors holds the
+ * difference between rows i and i + 1 of a column of the edit distance
+ * table, so a whole column is updated with a few word operations.
+ *
+ * @param pattern: the string to look for, 1 to 64 letters
+ * @param text: the text to search
+ * @param length: the number of letters in text
+ * @param bound: the most unit-cost edits
+ * @param ends: set to the (inclusive) ends of the candidates
+ */
+static void findEndsMyers(const wstring &pattern, const wchar_t *text,
+                          int length, int bound, vector<int> &ends)
+{
+    int m = pattern.size();
+    uint64_t mask = (m == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << m) - 1);
+    uint64_t high = (uint64_t) 1 << (m - 1);
+
+    // the positions of each letter of the pattern, sorted by letter
+    vector<pair<wchar_t, uint64_t> > peq;
+    for (int i = 0; i < m; i++)
+    {
+        peq.push_back(make_pair(pattern[i], (uint64_t) 1 << i));
+    }
+    sort(peq.begin(), peq.end());
+    size_t n = 0;
+    for (size_t i = 0; i < peq.size(); i++)
+    {
+        if (n > 0 && peq[n - 1].first == peq[i].first)
+        {
+            peq[n - 1].second |= peq[i].second;
+        }
+        else
+        {
+            peq[n++] = peq[i];
+        }
+    }
+    peq.resize(n);
+
+    uint64_t pv = mask;
+    uint64_t mv = 0;
+    int score = m;
+
+    ends.clear();
+    for (int j = 0; j < length; j++)
+    {
+        uint64_t eq = 0;
+        vector<pair<wchar_t, uint64_t> >::iterator it =
+            lower_bound(peq.begin(), peq.end(),
+                        make_pair(text[j], (uint64_t) 0));
+        if (it != peq.end() && it->first == text[j])
+        {
+            eq = it->second;
+        }
+
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & high)
+        {
+            score++;
+        }
+        else if (mh & high)
+        {
+            score--;
+        }
+
+        // a match may start anywhere, so row 0 stays 0 (no carry in)
+        ph <<= 1;
+        mh <<= 1;
+        pv = (mh | ~(xv | ph)) & mask;
+        mv = ph & xv & mask;
+
+        if (score <= bound)
+        {
+            ends.push_back(j);
+        }
+    }
+}
+
+
+/*
+ * Same as findEndsMyers for patterns of any length, with Sellers' dynamic
+ * program: one column of the edit distance table per letter of the text.
+ *
+ * @param pattern: the string to look for
+ * @param text: the text to search
+ * @param length: the number of letters in text
+ * @param bound: the most unit-cost edits
+ * @param ends: set to the (inclusive) ends of the candidates
+ */
+static void findEndsSellers(const wstring &pattern, const wchar_t *text,
+                            int length, int bound, vector<int> &ends)
+{
+    int m = pattern.size();
+    vector<int> column(m + 1);
+
+    for (int i = 0; i <= m; i++)
+    {
+        column[i] = i;
+    }
+
+    ends.clear();
+    for (int j = 0; j < length; j++)
+    {
+        int diagonal = column[0];   // a match may start anywhere
+        for (int i = 1; i <= m; i++)
+        {
+            int above = column[i];
+            int cost = diagonal + (pattern[i - 1] == text[j] ? 0 : 1);
+            cost = min(cost, above + 1);
+            cost = min(cost, column[i - 1] + 1);
+            diagonal = above;
+            column[i] = cost;
+        }
+        if (column[m] <= bound)
+        {
+            ends.push_back(j);
+        }
+    }
+}
+
+
+/*
+ * Computes the weighted cost of the best match of the pattern that ends at
+ * the letter end, by aligning the pattern backwards from there. Of the
+ * starts with the lowest cost, the one giving the length closest to the
+ * pattern's is taken.
+ *
+ * @param pattern: the string to look for
+ * @param text, errors: the text and the errors of its letters
+ * @param end: the (inclusive) end of the match
+ * @param maxLength: the longest match to consider
+ * @param weight: the error weight
+ * @param match: set to the best match ending at end
+ */
+static void bestMatchEndingAt(const wstring &pattern, const wchar_t *text,
+                              const unsigned char *errors, int end,
+                              int maxLength, double weight, FUZZY_MATCH &match)
+{
+    int m = pattern.size();
+    int n = min(maxLength, end + 1);
+
+    // row[l]: cost of the pattern suffix so far against the l letters
+    // before (and including) end
+    vector<double> row(n + 1);
+    vector<double> next(n + 1);
+    for (int l = 0; l <= n; l++)
+    {
+        row[l] = l;
+    }
+
+    for (int i = 1; i <= m; i++)
+    {
+        wchar_t p = pattern[m - i];
+        next[0] = i;
+        for (int l = 1; l <= n; l++)
+        {
+            int t = end - l + 1;
+            double substitute = (p == text[t] ? 0 :
+                                 1 - weight * errors[t] / 255.0);
+            double cost = row[l - 1] + substitute;
+            cost = min(cost, row[l] + 1);           // pattern letter missing
+            cost = min(cost, next[l - 1] + 1);      // extra text letter
+            next[l] = cost;
+        }
+        row.swap(next);
+    }
+
+    match.cost = row[1];
+    match.length = 1;
+    for (int l = 1; l <= n; l++)
+    {
+        if (row[l] < match.cost - 1e-9 ||
+            (fabs(row[l] - match.cost) <= 1e-9 &&
+             abs(l - m) < abs(match.length - m)))
+        {
+            match.cost = row[l];
+            match.length = l;
+        }
+    }
+    match.start = end - match.length + 1;
+}
+
+
+/*
+ * Finds the approximate matches of a pattern in a text. Matches do not
+ * overlap; of two overlapping candidates the cheaper one is kept. The
+ * matches are returned leftmost first.
+ *
+ * @param pattern: the string to look for
+ * @param text: the text to search
+ * @param errors: the error of every letter of the text, [0, 255]
+ * @param length: the number of letters in text
+ * @param options: the edit bound and error weight
+ * @param matches: set to the matches found
+ */
+void findApproximate(const wstring &pattern, const wchar_t *text,
+                     const unsigned char *errors, int length,
+                     const FUZZY_OPTIONS &options,
+                     vector<FUZZY_MATCH> &matches)
+{
+    int m = pattern.size();
+    double weight = options.errWeight;
+    vector<int> ends;
+
+    matches.clear();
+    if (m == 0 || length == 0)
+    {
+        return;
+    }
+
+    // with m edits the pattern can be deleted whole and every position
+    // matches, so a match keeps at least one letter of the pattern
+    double maxEdits = min(options.maxEdits, m - 1);
+
+    // the most unit-cost edits a match within maxEdits weighted edits has
+    int bound = min((int) floor(maxEdits / (1 - weight) + 1e-9), m - 1);
+
+    if (m <= 64)
+    {
+        findEndsMyers(pattern, text, length, bound, ends);
+    }
+    else
+    {
+        findEndsSellers(pattern, text, length, bound, ends);
+    }
+
+    for (size_t k = 0; k < ends.size(); k++)
+    {
+        FUZZY_MATCH match;
+        bestMatchEndingAt(pattern, text, errors, ends[k], m + bound, weight,
+                          match);
+        if (match.cost > maxEdits + 1e-9)
+        {
+            continue;
+        }
+
+        // candidates next to each other usually are the same occurrence,
+        // keep the cheapest one that does not overlap the match before
+        if (!matches.empty() &&
+            match.start < matches.back().start + matches.back().length)
+        {
+            size_t n = matches.size();
+            int before = (n > 1 ? matches[n - 2].start + matches[n - 2].length
+                                : 0);
+            if (match.cost < matches.back().cost - 1e-9 &&
+                match.start >= before)
+            {
+                matches.back() = match;
+            }
+            continue;
+        }
+        matches.push_back(match);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrFuzzy.cpp program
+ *
+ * Approximate string search for extractStrings and extractExact. When the
+ * ocr gets a letter of a to-find string wrong, an exact search misses the
+ * string; with a fuzzy search, every substring of the recognized text that
+ * is at most K edits (insertions, deletions, substitutions) away from the
+ * string is a match. K is capped at the length of the string minus one,
+ * so a match always keeps a letter of the string.
+ *
+ * Substitutions can be weighted by the error of the recognized letter: a
+ * substitution on a letter with error err costs 1 - W * err / 255, so the
+ * letters the ocr was unsure about are cheaper to replace.
+ *
+ * Candidates are found with Myers' bit-parallel algorithm (Sellers' dynamic
+ * program for strings longer than 64 letters) using unit costs, then every
+ * candidate is checked with the weighted costs.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_FUZZY_H
+#define OCR_FUZZY_H
+
+#include <string>
+#include <vector>
+#include <wchar.h>
+
+
+/*
+ * Options of the fuzzy search.
+ */
+struct FUZZY_OPTIONS
+{
+    int maxEdits;           // -k K: the most (weighted) edits of a match,
+                            //       0 for an exact search
+    double errWeight;       // -e W: how much the letter error lowers the
+                            //       cost of a substitution, in [0, 1)
+};
+
+
+/*
+ * One approximate match: the letters [start, start + length) of the text.
+ */
+struct FUZZY_MATCH
+{
+    int start;
+    int length;
+    double cost;            // the weighted edit distance to the pattern
+};
+
+
+/*
+ * Finds the approximate matches of a pattern in a text. Matches do not
+ * overlap; of two overlapping candidates the cheaper one is kept. The
+ * matches are returned leftmost first.
+ *
+ * @param pattern: the string to look for
+ * @param text: the text to search
+ * @param errors: the error of every letter of the text, [0, 255]
+ * @param length: the number of letters in text
+ * @param options: the edit bound and error weight
+ * @param matches: set to the matches found
+ */
+extern void findApproximate(const std::wstring &pattern, const wchar_t *text,
+                            const unsigned char *errors, int length,
+                            const FUZZY_OPTIONS &options,
+                            std::vector<FUZZY_MATCH> &matches);
+
+#endif
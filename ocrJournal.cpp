@@ -0,0 +1,371 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrJournal.h
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrJournal.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+using namespace std;
+
+
+/*
+ * Returns the size of a file, or -1 if it does not exist.
+ *
+ * @param path: the file
+ */
+static long long fileSize(string path)
+{
+    struct stat info;
+
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return -1;
+    }
+    return info.st_size;
+}
+
+
+/*
+ * Cuts a file back to the given size. A file that does not exist is fine
+ * if nothing of it was recorded. Returns 0 on success.
+ *
+ * @param path: the file
+ * @param size: the size the file had at the checkpoint
+ */
+static int cutFile(string path, uint64_t size)
+{
+    long long current = fileSize(path);
+
+    if (current < 0 && size == 0)
+    {
+        return 0;
+    }
+    if (current < (long long) size)
+    {
+        printf("%s is shorter than the journal says, not resuming\n",
+               path.c_str());
+        return 1;
+    }
+    if (current > (long long) size && truncate(path.c_str(), size) != 0)
+    {
+        printf("could not cut %s back to the last checkpoint\n", path.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Returns the number of lines in a file, and the size of the file up to
+ * the end of line maxLines if that is smaller.
+ *
+ * @param path: the file
+ * @param maxLines: the most lines to count
+ * @param bytes: set to the size of the first (up to maxLines) lines
+ */
+static uint64_t countLines(string path, uint64_t maxLines, uint64_t &bytes)
+{
+    FILE *in = fopen(path.c_str(), "rb");
+    uint64_t lines = 0;
+    int c;
+
+    bytes = 0;
+    if (in == NULL)
+    {
+        return 0;
+    }
+    while (lines < maxLines && (c = fgetc(in)) != EOF)
+    {
+        bytes++;
+        if (c == '\n')
+        {
+            lines++;
+        }
+    }
+    fclose(in);
+    return lines;
+}
+
+
+/*
+ * RUN_JOURNAL constructor
+ *
+ * @param journalPath: the journal file
+ */
+RUN_JOURNAL::RUN_JOURNAL(string journalPath)
+{
+    path = journalPath;
+    file = NULL;
+    memset(&state, 0, sizeof(state));
+    letterBase = 0;
+    wordBase = 0;
+}
+
+
+/*
+ * Reads the journal (if there is one), checks that it belongs to this image
+ * list, cuts the output files back to the last checkpoint and opens the
+ * journal for new checkpoints. Must be called before the binary sink is
+ * opened. Returns 0 on success.
+ *
+ * @param entries: the image list of the run
+ * @param letterPath: the letter output file
+ * @param wordPath: the word output file
+ * @param binaryPrefix: the prefix of the binary tables, "" for none
+ */
+int RUN_JOURNAL::restore(vector<BATCH_ENTRY> &entries, string letterPath,
+                         string wordPath, string binaryPrefix)
+{
+    string content;
+    size_t goodBytes = 0;
+    bool found = false;
+
+    // read the journal, a crash can leave a partial last line
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in != NULL)
+    {
+        char block[4096];
+        size_t n;
+        while ((n = fread(block, 1, sizeof(block), in)) > 0)
+        {
+            content.append(block, n);
+        }
+        fclose(in);
+    }
+
+    size_t lineStart = 0;
+    size_t lineEnd;
+    while ((lineEnd = content.find('\n', lineStart)) != string::npos)
+    {
+        string line = content.substr(lineStart, lineEnd - lineStart);
+        JOURNAL_STATE next;
+        unsigned long pages;
+        unsigned long long values[5];
+        int pathStart = -1;
+
+        memset(&next, 0, sizeof(next));
+
+        if (sscanf(line.c_str(),
+                   "%lu\t%d\t%d\t%llu\t%llu\t%llu\t%llu\t%llu\t%n",
+                   &pages, &next.counters.letter, &next.counters.word,
+                   &values[0], &values[1], &values[2], &values[3], &values[4],
+                   &pathStart) != 8 || pathStart < 0 ||
+            pages != (found ? state.pagesDone + 1 : 0))
+        {
+            break;
+        }
+        if (pages > 0 &&
+            (pages > entries.size() ||
+             line.substr(pathStart) != entries[pages - 1].imageFile))
+        {
+            printf("journal %s does not belong to this image list\n",
+                   path.c_str());
+            return 1;
+        }
+
+        next.pagesDone = pages;
+        next.letterBytes = values[0];
+        next.wordBytes = values[1];
+        next.binaryLetters = values[2];
+        next.binaryWords = values[3];
+        next.binaryImages = values[4];
+        state = next;
+        found = true;
+        goodBytes = lineEnd + 1;
+        lineStart = lineEnd + 1;
+    }
+
+    if (found)
+    {
+        // go back to the last checkpoint
+        uint64_t imageBytes = 0;
+        if (cutFile(path, goodBytes) != 0 ||
+            cutFile(letterPath, state.letterBytes) != 0 ||
+            cutFile(wordPath, state.wordBytes) != 0)
+        {
+            return 1;
+        }
+        if (!binaryPrefix.empty())
+        {
+            string letterTable = binaryPrefix + ".letters.bin";
+            string wordTable = binaryPrefix + ".words.bin";
+            string imageTable = binaryPrefix + ".images.txt";
+
+            if (countLines(imageTable, state.binaryImages, imageBytes) <
+                state.binaryImages ||
+                cutFile(imageTable, imageBytes) != 0 ||
+                (fileSize(letterTable) >= 0 &&
+                 cutFile(letterTable, sizeof(BINARY_HEADER) +
+                         state.binaryLetters * sizeof(BINARY_LETTER)) != 0) ||
+                (fileSize(wordTable) >= 0 &&
+                 cutFile(wordTable, sizeof(BINARY_HEADER) +
+                         state.binaryWords * sizeof(BINARY_WORD)) != 0))
+            {
+                printf("binary tables %s do not match the journal\n",
+                       binaryPrefix.c_str());
+                return 1;
+            }
+        }
+        if (state.pagesDone > 0)
+        {
+            printf("resuming after page %lu of %lu\n",
+                   (unsigned long) state.pagesDone,
+                   (unsigned long) entries.size());
+        }
+    }
+    else
+    {
+        // a new journal starts with the state of the outputs before the run
+        long long size;
+        uint64_t bytes;
+
+        size = fileSize(letterPath);
+        state.letterBytes = (size > 0 ? size : 0);
+        size = fileSize(wordPath);
+        state.wordBytes = (size > 0 ? size : 0);
+        if (!binaryPrefix.empty())
+        {
+            size = fileSize(binaryPrefix + ".letters.bin");
+            if (size > (long long) sizeof(BINARY_HEADER))
+            {
+                state.binaryLetters = (size - sizeof(BINARY_HEADER)) /
+                                      sizeof(BINARY_LETTER);
+            }
+            size = fileSize(binaryPrefix + ".words.bin");
+            if (size > (long long) sizeof(BINARY_HEADER))
+            {
+                state.binaryWords = (size - sizeof(BINARY_HEADER)) /
+                                    sizeof(BINARY_WORD);
+            }
+            state.binaryImages = countLines(binaryPrefix + ".images.txt",
+                                            UINT64_MAX, bytes);
+        }
+    }
+
+    letterBase = state.letterBytes;
+    wordBase = state.wordBytes;
+
+    file = fopen(path.c_str(), found ? "ab" : "wb");
+    if (file == NULL)
+    {
+        printf("could not open journal %s\n", path.c_str());
+        return 1;
+    }
+    if (!found)
+    {
+        fprintf(file, "0\t%d\t%d\t%llu\t%llu\t%llu\t%llu\t%llu\t\n",
+                state.counters.letter, state.counters.word,
+                (unsigned long long) state.letterBytes,
+                (unsigned long long) state.wordBytes,
+                (unsigned long long) state.binaryLetters,
+                (unsigned long long) state.binaryWords,
+                (unsigned long long) state.binaryImages);
+        fflush(file);
+    }
+    return 0;
+}
+
+
+/*
+ * Flushes the sinks and records that the page is done. Pages must be
+ * recorded in list order, from one thread at a time.
+ * Returns 0 on success.
+ *
+ * @param page: the page that was just handed to the sinks
+ * @param sinks: the sinks of the run
+ */
+int RUN_JOURNAL::record(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks)
+{
+    if (file == NULL)
+    {
+        return 1;
+    }
+
+    // everything the checkpoint covers has to be in the files first
+    sinks.letters->flush();
+    sinks.words->flush();
+    if (sinks.binary != NULL)
+    {
+        sinks.binary->flush();
+        state.binaryLetters = sinks.binary->getLetterCount();
+        state.binaryWords = sinks.binary->getWordCount();
+        state.binaryImages = sinks.binary->getImageCount();
+    }
+    if (sinks.crops != NULL)
+    {
+        sinks.crops->flush();
+    }
+    if (sinks.letters->hasFailed() || sinks.words->hasFailed())
+    {
+        return 1;
+    }
+
+    state.pagesDone = page.index + 1;
+    state.letterBytes = letterBase + sinks.letters->getBytesWritten();
+    state.wordBytes = wordBase + sinks.words->getBytesWritten();
+
+    // pages of a -j run name their crops after the page, only the running
+    // numbers of serial and pipeline runs have to be carried on
+    if (page.namePrefix.empty())
+    {
+        state.counters = page.counters;
+    }
+
+    fprintf(file, "%lu\t%d\t%d\t%llu\t%llu\t%llu\t%llu\t%llu\t%s\n",
+            (unsigned long) state.pagesDone,
+            state.counters.letter, state.counters.word,
+            (unsigned long long) state.letterBytes,
+            (unsigned long long) state.wordBytes,
+            (unsigned long long) state.binaryLetters,
+            (unsigned long long) state.binaryWords,
+            (unsigned long long) state.binaryImages,
+            page.imageFile.c_str());
+    if (fflush(file) != 0)
+    {
+        printf("could not write journal %s\n", path.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * RUN_JOURNAL destructor
+ */
+RUN_JOURNAL::~RUN_JOURNAL()
+{
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
+
+
+/*
+ * Where a run starts: the first page to process and the crop numbers to
+ * start with. Without a journal that is page 0 and l-0/w-0.
+ *
+ * @param sinks: the sinks of the run, with the journal if there is one
+ * @param first: set to the first page to process
+ * @param counters: set to the crop numbers to start with
+ */
+void getResumePoint(OUTPUT_SINKS &sinks, size_t &first,
+                    CROP_COUNTERS &counters)
+{
+    first = 0;
+    counters.letter = 0;
+    counters.word = 0;
+    counters.line = 0;
+    counters.zone = 0;
+    if (sinks.journal != NULL)
+    {
+        first = sinks.journal->getPagesDone();
+        counters = sinks.journal->getCounters();
+    }
+}
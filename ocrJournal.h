@@ -0,0 +1,102 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrJournal.cpp program
+ *
+ * A run with a journal (-r J) can be stopped at any point and started again
+ * with the same arguments; it then goes on after the last page that was
+ * completely written instead of starting over.
+ *
+ * The journal is a text file with one line per checkpoint. The first line
+ * is written when the run starts, and one more after every page has been
+ * handed to the output sinks:
+ *
+ *      <pages done> <next letter crop> <next word crop> <letter file bytes>
+ *      <word file bytes> <binary letters> <binary words> <binary images>
+ *      <image path of the last page done>
+ *
+ * (tab separated, on one line). On restart, the outputs are cut back to
+ * the sizes of the last complete line, so records of a page that was only
+ * partly written are dropped, the finished pages are skipped, and the crop
+ * numbering goes on where it stopped, so no earlier crop is overwritten.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_JOURNAL_H
+#define OCR_JOURNAL_H
+
+#include "ocrBatch.h"
+#include <stdio.h>
+#include <stdint.h>
+
+
+/*
+ * The state of the outputs after a number of pages.
+ */
+struct JOURNAL_STATE
+{
+    size_t pagesDone;           // pages [0, pagesDone) of the list are done
+    CROP_COUNTERS counters;     // numbers of the next letter/word crops
+    uint64_t letterBytes;       // size of the letter output file
+    uint64_t wordBytes;         // size of the word output file
+    uint64_t binaryLetters;     // records in the binary letter table
+    uint64_t binaryWords;       // records in the binary word table
+    uint64_t binaryImages;      // lines in the binary image table
+};
+
+
+class RUN_JOURNAL
+{
+private:
+
+    std::string path;
+    FILE *file;
+    JOURNAL_STATE state;        // the last checkpoint
+    uint64_t letterBase;        // size of the output files when this run
+    uint64_t wordBase;          // started writing to them
+
+public:
+    // constructor, nothing is read until restore()
+    RUN_JOURNAL(std::string journalPath);
+
+    /*
+     * Reads the journal (if there is one), checks that it belongs to this
+     * image list, cuts the output files back to the last checkpoint and
+     * opens the journal for new checkpoints. Must be called before the
+     * binary sink is opened. Returns 0 on success.
+     */
+    int restore(std::vector<BATCH_ENTRY> &entries, std::string letterPath,
+                std::string wordPath, std::string binaryPrefix);
+
+    // the first page that still needs to be processed
+    size_t getPagesDone() { return state.pagesDone; }
+
+    // the crop numbers to go on with
+    CROP_COUNTERS getCounters() { return state.counters; }
+
+    /*
+     * Flushes the sinks and records that the page is done. Pages must be
+     * recorded in list order, from one thread at a time.
+     * Returns 0 on success.
+     */
+    int record(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks);
+
+    // destructor, closes the journal
+    ~RUN_JOURNAL();
+
+    RUN_JOURNAL(const RUN_JOURNAL &) = delete;
+    RUN_JOURNAL &operator=(const RUN_JOURNAL &) = delete;
+};
+
+
+/*
+ * Where a run starts: the first page to process and the crop numbers to
+ * start with. Without a journal that is page 0 and l-0/w-0.
+ *
+ * @param sinks: the sinks of the run, with the journal if there is one
+ * @param first: set to the first page to process
+ * @param counters: set to the crop numbers to start with
+ */
+extern void getResumePoint(OUTPUT_SINKS &sinks, size_t &first,
+                           CROP_COUNTERS &counters);
+
+#endif
@@ -0,0 +1,300 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrMetrics.h
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrMetrics.h"
+#include "ocrExtraction.h"
+#include <stdio.h>
+
+
+using namespace std;
+
+
+static const char *callNames[N_CALLS] =
+{
+    "kRecLoadImgF", "kRecPreprocessImg", "kRecGetImgInfo", "kRecLocateZones",
+    "kRecRecognize", "kRecGetLetters", "kRecSaveImgAreaF", "kRecGetImgArea",
+    "kRecFree", "kRecFreeImg"
+};
+
+static const char *eventNames[N_EVENTS] =
+{
+    "pages", "load_errors", "recognize_errors", "empty_pages", "cache_hits",
+    "letters", "letter_crops", "word_crops", "line_crops", "zone_crops",
+    "letters_off_page",
+    "empty_letters", "crop_errors", "binary_bytes", "tensor_bytes"
+};
+
+static const char *stageNames[N_STAGES] =
+{
+    "load", "preprocess", "zones", "recognize", "segmentation", "crops",
+    "write"
+};
+
+#define N_OUTPUTS   7
+
+static const char *outputNames[N_OUTPUTS] =
+{
+    "letters", "words", "binary", "tensors", "crops", "lines", "zones"
+};
+
+
+/*
+ * RUN_METRICS constructor
+ *
+ * @param reportPath: the file the reports are written to
+ * @param reportInterval: write a report every reportInterval pages, or 0
+ *                        for only the one at the end
+ */
+RUN_METRICS::RUN_METRICS(string reportPath, int reportInterval)
+{
+    path = reportPath;
+    prometheus = (path.size() > 5 &&
+                  path.compare(path.size() - 5, 5, ".prom") == 0);
+    interval = reportInterval;
+    start = chrono::steady_clock::now();
+
+    for (int e = 0; e < N_EVENTS; e++)
+    {
+        events[e] = 0;
+    }
+    for (int c = 0; c < N_CALLS; c++)
+    {
+        calls[c] = 0;
+        callNanos[c] = 0;
+    }
+    for (int s = 0; s < N_STAGES; s++)
+    {
+        stageSeconds[s] = 0;
+    }
+}
+
+
+/*
+ * Adds the bytes the text sinks have written: the letter and word files,
+ * or in a manifest run the files of every extractor (sinks.letters and
+ * sinks.words are the first extractor's then).
+ */
+static void getTextBytes(OUTPUT_SINKS &sinks, long long &letterBytes,
+                         long long &wordBytes)
+{
+    letterBytes = 0;
+    wordBytes = 0;
+    if (sinks.extractors.empty())
+    {
+        letterBytes = sinks.letters->getBytesWritten();
+        wordBytes = sinks.words->getBytesWritten();
+        return;
+    }
+    for (size_t k = 0; k < sinks.extractors.size(); k++)
+    {
+        letterBytes += sinks.extractors[k].letters->getBytesWritten();
+        wordBytes += sinks.extractors[k].words->getBytesWritten();
+    }
+}
+
+
+/*
+ * Returns the bytes a sink has written, 0 for a sink that is not used.
+ */
+template <class SINK>
+static long long getSinkBytes(SINK *sink)
+{
+    return (sink != NULL ? sink->getBytesWritten() : 0);
+}
+
+
+/*
+ * Writes the report file. The report goes to "<path>.tmp" first and is
+ * renamed over the old one. Returns 0 on success.
+ *
+ * @param path: the report file
+ * @param text: the report
+ */
+static int replaceFile(const string &path, const string &text)
+{
+    string tmpPath = path + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "w");
+    if (file == NULL)
+    {
+        printf("could not write metrics file %s\n", tmpPath.c_str());
+        return 1;
+    }
+    size_t written = fwrite(text.c_str(), 1, text.size(), file);
+    if (fclose(file) != 0 || written != text.size() ||
+        rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        printf("could not write metrics file %s\n", path.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Adds a page whose records were just written and writes a report every
+ * interval pages. Returns 0 on success.
+ *
+ * @param page: the page, with its stage times if page.times is set
+ * @param sinks: the sinks of the run
+ */
+int RUN_METRICS::pageDone(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks)
+{
+    long long pages = ++events[EVENT_PAGES];
+
+    if (page.times != NULL)
+    {
+        lock_guard<mutex> guard(lock);
+        for (int s = 0; s < N_STAGES; s++)
+        {
+            stageSeconds[s] += page.times->seconds[s];
+        }
+    }
+    if (interval > 0 && pages % interval == 0)
+    {
+        return report(sinks, false);
+    }
+    return 0;
+}
+
+
+/*
+ * Writes the report. At the end of the run the text, crop, line and zone
+ * sinks are flushed first, so the bytes written include everything, and
+ * the crops the crop sink lost after write() count as crop errors.
+ * Returns 0 on success.
+ *
+ * @param sinks: the sinks of the run
+ * @param final: true for the report at the end of the run
+ */
+int RUN_METRICS::report(OUTPUT_SINKS &sinks, bool final)
+{
+    long long letterBytes;
+    long long wordBytes;
+    char line[256];
+    string text;
+
+    if (final)
+    {
+        sinks.letters->flush();
+        sinks.words->flush();
+        for (size_t k = 0; k < sinks.extractors.size(); k++)
+        {
+            sinks.extractors[k].letters->flush();
+            sinks.extractors[k].words->flush();
+        }
+        if (sinks.crops != NULL)
+        {
+            // crops written by encoder threads fail after they were counted
+            sinks.crops->flush();
+            events[EVENT_CROP_ERRORS] += sinks.crops->getLostCrops();
+        }
+        if (sinks.lines != NULL)
+        {
+            sinks.lines->flush();
+        }
+        if (sinks.zones != NULL)
+        {
+            sinks.zones->flush();
+        }
+    }
+    getTextBytes(sinks, letterBytes, wordBytes);
+
+    // bytes per output; crops saved by the engine (no crop sink) are not
+    // counted
+    long long outputBytes[N_OUTPUTS] = {letterBytes, wordBytes,
+                                        events[EVENT_BINARY_BYTES].load(),
+                                        events[EVENT_TENSOR_BYTES].load(),
+                                        getSinkBytes(sinks.crops),
+                                        getSinkBytes(sinks.lines),
+                                        getSinkBytes(sinks.zones)};
+
+    lock_guard<mutex> guard(lock);
+    double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+
+    if (prometheus)
+    {
+        snprintf(line, sizeof(line),
+                 "# TYPE ocr_run_seconds gauge\nocr_run_seconds %.6f\n"
+                 "# TYPE ocr_events_total counter\n", seconds);
+        text += line;
+        for (int e = 0; e < N_EVENTS; e++)
+        {
+            snprintf(line, sizeof(line), "ocr_events_total{event=\"%s\"} %lld\n",
+                     eventNames[e], events[e].load());
+            text += line;
+        }
+        text += "# TYPE ocr_bytes_written_total counter\n";
+        for (int o = 0; o < N_OUTPUTS; o++)
+        {
+            snprintf(line, sizeof(line),
+                     "ocr_bytes_written_total{output=\"%s\"} %lld\n",
+                     outputNames[o], outputBytes[o]);
+            text += line;
+        }
+        text += "# TYPE ocr_stage_seconds_total counter\n";
+        for (int s = 0; s < N_STAGES; s++)
+        {
+            snprintf(line, sizeof(line),
+                     "ocr_stage_seconds_total{stage=\"%s\"} %.6f\n",
+                     stageNames[s], stageSeconds[s]);
+            text += line;
+        }
+        text += "# TYPE ocr_engine_calls_total counter\n";
+        for (int c = 0; c < N_CALLS; c++)
+        {
+            snprintf(line, sizeof(line),
+                     "ocr_engine_calls_total{call=\"%s\"} %lld\n",
+                     callNames[c], calls[c].load());
+            text += line;
+        }
+        text += "# TYPE ocr_engine_call_seconds_total counter\n";
+        for (int c = 0; c < N_CALLS; c++)
+        {
+            snprintf(line, sizeof(line),
+                     "ocr_engine_call_seconds_total{call=\"%s\"} %.6f\n",
+                     callNames[c], callNanos[c].load() / 1e9);
+            text += line;
+        }
+        return replaceFile(path, text);
+    }
+
+    snprintf(line, sizeof(line), "{\n  \"seconds\": %.6f,\n  \"events\": {",
+             seconds);
+    text += line;
+    for (int e = 0; e < N_EVENTS; e++)
+    {
+        snprintf(line, sizeof(line), "%s\n    \"%s\": %lld",
+                 (e == 0 ? "" : ","), eventNames[e], events[e].load());
+        text += line;
+    }
+    text += "\n  },\n  \"bytes_written\": {";
+    for (int o = 0; o < N_OUTPUTS; o++)
+    {
+        snprintf(line, sizeof(line), "%s\n    \"%s\": %lld",
+                 (o == 0 ? "" : ","), outputNames[o], outputBytes[o]);
+        text += line;
+    }
+    text += "\n  },\n  \"stage_seconds\": {";
+    for (int s = 0; s < N_STAGES; s++)
+    {
+        snprintf(line, sizeof(line), "%s\n    \"%s\": %.6f",
+                 (s == 0 ? "" : ","), stageNames[s], stageSeconds[s]);
+        text += line;
+    }
+    text += "\n  },\n  \"engine_calls\": {";
+    for (int c = 0; c < N_CALLS; c++)
+    {
+        snprintf(line, sizeof(line),
+                 "%s\n    \"%s\": {\"calls\": %lld, \"seconds\": %.6f}",
+                 (c == 0 ? "" : ","), callNames[c], calls[c].load(),
+                 callNanos[c].load() / 1e9);
+        text += line;
+    }
+    text += "\n  }\n}\n";
+    return replaceFile(path, text);
+}
@@ -0,0 +1,184 @@
+/*
+ * _____________________________________________________________________________
+ * Run metrics
+ *
+ * With -M F, a run counts what happened to its pages and letters (crops
+ * exported and rejected, load and recognition errors, bytes written),
+ * times every engine call and adds up the stage times of its pages
+ * (PAGE_TIMES). The summary is written to F at the end of the run and,
+ * with -N N, every N pages: Prometheus text format if F ends in ".prom"
+ * (the textfile collector of node_exporter picks it up from there), JSON
+ * otherwise. The file is replaced in one rename, so a reader never sees
+ * half a report.
+ *
+ * Without metrics (page.metrics == NULL), the counting and timing helpers
+ * do nothing and do not read the clock.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_METRICS_H
+#define OCR_METRICS_H
+
+#include "ocrTiming.h"
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+
+struct PAGE_CONTEXT;
+struct OUTPUT_SINKS;
+
+
+/*
+ * The engine calls made for a page.
+ */
+enum ENGINE_CALL
+{
+    CALL_LOAD_IMG,              // kRecLoadImgF
+    CALL_PREPROCESS,            // kRecPreprocessImg
+    CALL_GET_IMG_INFO,          // kRecGetImgInfo
+    CALL_LOCATE_ZONES,          // kRecLocateZones
+    CALL_RECOGNIZE,             // kRecRecognize
+    CALL_GET_LETTERS,           // kRecGetLetters
+    CALL_SAVE_IMG_AREA,         // kRecSaveImgAreaF (exportRect)
+    CALL_GET_IMG_AREA,          // kRecGetImgArea
+    CALL_FREE,                  // kRecFree
+    CALL_FREE_IMG,              // kRecFreeImg
+    N_CALLS
+};
+
+
+/*
+ * The events a run counts.
+ */
+enum RUN_EVENT
+{
+    EVENT_PAGES,                // pages handed to the output sinks
+    EVENT_LOAD_ERRORS,          // pages that could not be loaded
+    EVENT_RECOGNIZE_ERRORS,     // pages that could not be recognized
+    EVENT_EMPTY_PAGES,          // pages without text
+    EVENT_CACHE_HITS,           // pages read from the recognition cache
+    EVENT_LETTERS,              // letters recognized
+    EVENT_LETTER_CROPS,         // letter bBox images exported
+    EVENT_WORD_CROPS,           // word bBox images exported
+    EVENT_LINE_CROPS,           // line bBox images exported (-n)
+    EVENT_ZONE_CROPS,           // zone bBox images exported (-z)
+    EVENT_OFF_PAGE,             // letters rejected, bBox beyond the page
+    EVENT_EMPTY_LETTERS,        // letters rejected, no width or height
+    EVENT_CROP_ERRORS,          // bBox images that could not be exported
+    EVENT_BINARY_BYTES,         // bytes of binary letter/word records
+    EVENT_TENSOR_BYTES,         // bytes of letter tensors and their labels
+    N_EVENTS
+};
+
+
+/*
+ * The counters and timers of a run. count() and addCall() may be called
+ * from any thread; pageDone() and report() are called where the page
+ * records are written, one page at a time.
+ */
+class RUN_METRICS
+{
+private:
+
+    std::string path;           // the report file
+    bool prometheus;            // Prometheus text instead of JSON
+    int interval;               // report every interval pages, 0 = at the end
+    std::chrono::steady_clock::time_point start;
+
+    std::atomic<long long> events[N_EVENTS];
+    std::atomic<long long> calls[N_CALLS];
+    std::atomic<long long> callNanos[N_CALLS];
+    double stageSeconds[N_STAGES];
+
+    std::mutex lock;
+
+public:
+    /*
+     * RUN_METRICS constructor
+     *
+     * @param reportPath: the file the reports are written to
+     * @param reportInterval: write a report every reportInterval pages, or
+     *                        0 for only the one at the end
+     */
+    RUN_METRICS(std::string reportPath, int reportInterval);
+
+    void count(RUN_EVENT event, long long n = 1)
+    {
+        events[event] += n;
+    }
+
+    void addCall(ENGINE_CALL call, long long nanos)
+    {
+        calls[call]++;
+        callNanos[call] += nanos;
+    }
+
+    /*
+     * Adds a page whose records were just written: its stage times, and a
+     * report if one is due. Returns 0 on success.
+     */
+    int pageDone(PAGE_CONTEXT &page, OUTPUT_SINKS &sinks);
+
+    /*
+     * Writes the report with the bytes the sinks have written so far; the
+     * final one (at the end of the run) flushes the text, crop, line and
+     * zone sinks first.
+     * Returns 0 on success.
+     */
+    int report(OUTPUT_SINKS &sinks, bool final = true);
+
+    RUN_METRICS(const RUN_METRICS &) = delete;
+    RUN_METRICS &operator=(const RUN_METRICS &) = delete;
+};
+
+
+/*
+ * Counts an event of the run, if the run has metrics.
+ */
+inline void countEvent(RUN_METRICS *metrics, RUN_EVENT event, long long n = 1)
+{
+    if (metrics != NULL)
+    {
+        metrics->count(event, n);
+    }
+}
+
+
+/*
+ * Times one engine call, from its construction to its destruction.
+ */
+class CALL_TIMER
+{
+private:
+
+    RUN_METRICS *metrics;
+    ENGINE_CALL call;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    CALL_TIMER(RUN_METRICS *runMetrics, ENGINE_CALL engineCall)
+        : metrics(runMetrics), call(engineCall)
+    {
+        if (metrics != NULL)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~CALL_TIMER()
+    {
+        if (metrics != NULL)
+        {
+            metrics->addCall(call,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    CALL_TIMER(const CALL_TIMER &) = delete;
+    CALL_TIMER &operator=(const CALL_TIMER &) = delete;
+};
+
+#endif
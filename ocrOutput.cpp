@@ -0,0 +1,158 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrOutput.h
+ *
+ * The sink encodes the wide-character records as UTF-8 into a memory buffer
+ * and only writes to the file when the buffer is full, when it is flushed,
+ * or when the sink is destroyed.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrOutput.h"
+
+
+using namespace std;
+
+
+/*
+ * Appends the UTF-8 encoding of a character to the buffer. Characters that
+ * are not valid code points (e.g. lone surrogates) become U+FFFD.
+ *
+ * @param c: the character to encode
+ * @param out: the buffer to append to
+ */
+static void appendUtf8(wchar_t c, string &out)
+{
+    unsigned long code = (unsigned long) c;
+
+    if ((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+    {
+        code = 0xFFFD;
+    }
+
+    if (code < 0x80)
+    {
+        out += (char) code;
+    }
+    else if (code < 0x800)
+    {
+        out += (char) (0xC0 | (code >> 6));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        out += (char) (0xE0 | (code >> 12));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+    else
+    {
+        out += (char) (0xF0 | (code >> 18));
+        out += (char) (0x80 | ((code >> 12) & 0x3F));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+}
+
+
+/*
+ * OCR_SINK constructor
+ *
+ * @param outputPath: the file the records are appended to
+ * @param flushSize: how much text to collect before writing it out
+ */
+OCR_SINK::OCR_SINK(string outputPath, size_t flushSize)
+{
+    path = outputPath;
+    file = NULL;
+    failed = false;
+    blockSize = flushSize;
+    bytesWritten = 0;
+    buffer.reserve(blockSize + 4096);
+}
+
+
+/*
+ * Writes the buffer to the file, opening the file the first time.
+ * The caller must hold the lock.
+ */
+void OCR_SINK::writeBuffer()
+{
+    if (buffer.empty() || failed)
+    {
+        buffer.clear();
+        return;
+    }
+
+    if (file == NULL)
+    {
+        file = fopen(path.c_str(), "ab");
+        if (file == NULL)
+        {
+            printf("could not open output file %s\n", path.c_str());
+            failed = true;
+            buffer.clear();
+            return;
+        }
+    }
+
+    size_t written = fwrite(buffer.data(), 1, buffer.size(), file);
+    bytesWritten += written;
+    if (written != buffer.size())
+    {
+        printf("could not write to %s\n", path.c_str());
+        failed = true;
+    }
+    buffer.clear();
+}
+
+
+/*
+ * Adds records to the sink. The text is encoded as UTF-8 and written to the
+ * file once the buffer holds at least one block.
+ *
+ * @param records: the records to add
+ */
+void OCR_SINK::write(const wstring &records)
+{
+    lock_guard<mutex> guard(lock);
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        appendUtf8(records[i], buffer);
+    }
+
+    if (buffer.size() >= blockSize)
+    {
+        writeBuffer();
+    }
+}
+
+
+/*
+ * Writes everything that is buffered to the file.
+ */
+void OCR_SINK::flush()
+{
+    lock_guard<mutex> guard(lock);
+
+    writeBuffer();
+    if (file != NULL)
+    {
+        fflush(file);
+    }
+}
+
+
+/*
+ * OCR_SINK destructor, flushes the buffer and closes the file.
+ */
+OCR_SINK::~OCR_SINK()
+{
+    flush();
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
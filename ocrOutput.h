@@ -0,0 +1,56 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrOutput.cpp program
+ *
+ * OCR_SINK is the writer for the letter and word output files. A sink is
+ * created once per run, keeps its file open, collects the records in memory
+ * and writes them out in large blocks.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_OUTPUT_H
+#define OCR_OUTPUT_H
+
+#include <stdio.h>
+#include <string>
+#include <mutex>
+
+
+class OCR_SINK
+{
+private:
+
+    std::string path;           // the output file
+    FILE *file;                 // NULL until the first block is written
+    bool failed;                // true once opening or writing failed
+
+    std::string buffer;         // UTF-8 text waiting to be written
+    size_t blockSize;           // write the buffer once it gets this big
+    long long bytesWritten;     // bytes written to the file so far
+
+    std::mutex lock;
+
+    void writeBuffer();
+
+public:
+    // constructor, the file is opened (in append mode) on the first write
+    OCR_SINK(std::string outputPath, size_t flushSize = 1 << 20);
+
+    // adds records to the sink, encoded as UTF-8
+    void write(const std::wstring &records);
+
+    // writes everything that is buffered to the file
+    void flush();
+
+    std::string getPath() { return path; }
+    bool hasFailed() { return failed; }
+    long long getBytesWritten() { return bytesWritten; }
+
+    // destructor, flushes and closes the file
+    ~OCR_SINK();
+
+    OCR_SINK(const OCR_SINK &) = delete;
+    OCR_SINK &operator=(const OCR_SINK &) = delete;
+};
+
+#endif
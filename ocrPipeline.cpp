@@ -0,0 +1,364 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrPipeline.h
+ *
+ * The pages of an image list go through a load -> recognize -> export
+ * pipeline. Each stage runs on its own thread(s) and hands pages to the next
+ * stage through a bounded PAGE_QUEUE.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrPipeline.h"
+#include "ocrJournal.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <map>
+
+
+using namespace std;
+
+typedef chrono::steady_clock CLOCK;
+
+
+// seconds passed since the given time
+static double secondsSince(CLOCK::time_point start)
+{
+    return chrono::duration<double>(CLOCK::now() - start).count();
+}
+
+
+/*
+ * ____________________________________________________________________________
+ *  Definitions for class: PAGE_QUEUE
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * PAGE_QUEUE constructor
+ *
+ * @param maxPages: the most pages the queue can hold
+ */
+PAGE_QUEUE::PAGE_QUEUE(size_t maxPages)
+{
+    capacity = (maxPages < 1 ? 1 : maxPages);
+    closed = false;
+    maxDepth = 0;
+    depthSum = 0;
+    nPushes = 0;
+}
+
+
+/*
+ * Adds a page to the queue, waiting while the queue is full.
+ * Returns the time spent waiting, in seconds.
+ *
+ * @param page: the page to add
+ */
+double PAGE_QUEUE::push(PIPELINE_PAGE *page)
+{
+    CLOCK::time_point start = CLOCK::now();
+    unique_lock<mutex> guard(lock);
+
+    notFull.wait(guard, [&]() { return pages.size() < capacity; });
+    double waited = secondsSince(start);
+
+    pages.push_back(page);
+    if (pages.size() > maxDepth)
+    {
+        maxDepth = pages.size();
+    }
+    depthSum += pages.size();
+    nPushes++;
+
+    notEmpty.notify_one();
+    return waited;
+}
+
+
+/*
+ * Takes the next page off the queue, waiting while the queue is empty.
+ * Returns NULL once the queue is closed and empty.
+ *
+ * @param waited: set to the time spent waiting, in seconds
+ */
+PIPELINE_PAGE *PAGE_QUEUE::pop(double &waited)
+{
+    CLOCK::time_point start = CLOCK::now();
+    unique_lock<mutex> guard(lock);
+
+    notEmpty.wait(guard, [&]() { return !pages.empty() || closed; });
+    waited = secondsSince(start);
+
+    if (pages.empty())
+    {
+        return NULL;
+    }
+    PIPELINE_PAGE *page = pages.front();
+    pages.pop_front();
+
+    notFull.notify_one();
+    return page;
+}
+
+
+/*
+ * Closes the queue. Consumers get NULL from pop() once the queue is empty.
+ */
+void PAGE_QUEUE::close()
+{
+    lock_guard<mutex> guard(lock);
+    closed = true;
+    notEmpty.notify_all();
+}
+
+
+/*
+ * ____________________________________________________________________________
+ * End class definition for: PAGE_QUEUE
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * Prints the counters of every stage and the depth of every queue.
+ *
+ * @param stats: the counters of the load, recognize and export stages
+ * @param queues: the queues after the load and the recognize stage
+ * @param queueNames: a name for each queue
+ * @param elapsed: wall time of the whole run, in seconds
+ */
+static void printPipelineStats(STAGE_STATS *stats, int nStages,
+                               PAGE_QUEUE **queues, const char **queueNames,
+                               int nQueues, double elapsed)
+{
+    printf("\npipeline: %.2f s\n", elapsed);
+    printf("%-10s %7s %8s %8s %11s %12s\n", "stage", "threads", "pages",
+           "busy %", "wait in s", "wait out s");
+    for (int s = 0; s < nStages; s++)
+    {
+        double occupancy = 0;
+        if (elapsed > 0)
+        {
+            occupancy = 100.0 * stats[s].busy / (elapsed * stats[s].nThreads);
+        }
+        printf("%-10s %7d %8ld %8.1f %11.2f %12.2f\n", stats[s].name,
+               stats[s].nThreads, stats[s].pages, occupancy, stats[s].waitIn,
+               stats[s].waitOut);
+    }
+    printf("%-10s %7s %8s %8s\n", "queue", "size", "max", "average");
+    for (int q = 0; q < nQueues; q++)
+    {
+        printf("%-10s %7zu %8zu %8.2f\n", queueNames[q],
+               queues[q]->getCapacity(), queues[q]->getMaxDepth(),
+               queues[q]->getAverageDepth());
+    }
+}
+
+
+/*
+ * Runs the pages through the load -> recognize -> export pipeline and
+ * hands the page records to the output sinks in the order of the image
+ * list.
+ *
+ * @param engine: the running engine session
+ * @param entries: the pages to process
+ * @param sinks: the sinks for letter and word results
+ * @param options: the run options (queue depth, recognize threads)
+ * @param pageFunction: the export stage for each page
+ */
+int runPipeline(OCR_ENGINE &engine, vector<BATCH_ENTRY> &entries,
+                OUTPUT_SINKS &sinks, RUN_OPTIONS &options,
+                PAGE_FUNCTION pageFunction)
+{
+    int nRecognizers = options.nWorkers;
+    int loadSID, exportSID;
+    vector<int> recognizeSIDs;
+    size_t first;
+    CROP_COUNTERS counters;
+
+    getResumePoint(sinks, first, counters);
+
+    // every stage thread gets its own settings collection
+    if (engine.createSettings(loadSID) != 0)
+    {
+        return -1;
+    }
+    if (engine.createSettings(exportSID) != 0)
+    {
+        engine.releaseSettings(loadSID);
+        return -1;
+    }
+    for (int r = 0; r < nRecognizers; r++)
+    {
+        int newSID;
+        if (engine.createSettings(newSID) != 0)
+        {
+            break;
+        }
+        recognizeSIDs.push_back(newSID);
+    }
+    if (recognizeSIDs.empty())
+    {
+        engine.releaseSettings(loadSID);
+        engine.releaseSettings(exportSID);
+        return -1;
+    }
+    nRecognizers = recognizeSIDs.size();
+
+    PAGE_QUEUE loaded(options.queueDepth);
+    PAGE_QUEUE recognized(options.queueDepth);
+
+    STAGE_STATS stats[3] = {
+        {"load", 1, 0, 0, 0, 0},
+        {"recognize", nRecognizers, 0, 0, 0, 0},
+        {"export", 1, 0, 0, 0, 0}
+    };
+    mutex statsLock;
+
+    // limits the pages in flight, so pages that are recognized out of order
+    // cannot pile up while the export stage waits for an earlier page
+    size_t freeSlots = 2 * options.queueDepth + nRecognizers + 1;
+    mutex slotLock;
+    condition_variable slotFreed;
+
+    CLOCK::time_point runStart = CLOCK::now();
+
+    // load stage
+    thread loader([&]()
+    {
+        for (size_t i = first; i < entries.size(); i++)
+        {
+            CLOCK::time_point waitStart = CLOCK::now();
+            {
+                unique_lock<mutex> guard(slotLock);
+                slotFreed.wait(guard, [&]() { return freeSlots > 0; });
+                freeSlots--;
+            }
+            stats[0].waitOut += secondsSince(waitStart);
+
+            CLOCK::time_point workStart = CLOCK::now();
+            PIPELINE_PAGE *item = new PIPELINE_PAGE;
+            item->page.sid = loadSID;
+            item->page.imageFile = entries[i].imageFile;
+            item->page.pageNumber = entries[i].pageNumber;
+            item->page.pageCount = entries[i].pageCount;
+            item->page.index = i;
+            item->page.useSinks(sinks);
+            item->err = loadPage(item->page);
+            stats[0].busy += secondsSince(workStart);
+            stats[0].pages++;
+
+            stats[0].waitOut += loaded.push(item);
+        }
+        loaded.close();
+    });
+
+    // recognize stage
+    atomic<int> recognizersLeft(nRecognizers);
+    vector<thread> recognizers;
+    for (int r = 0; r < nRecognizers; r++)
+    {
+        recognizers.push_back(thread([&](int recognizeSID)
+        {
+            STAGE_STATS mine = {"recognize", 1, 0, 0, 0, 0};
+            double waited;
+            PIPELINE_PAGE *item;
+
+            while ((item = loaded.pop(waited)) != NULL)
+            {
+                mine.waitIn += waited;
+
+                CLOCK::time_point workStart = CLOCK::now();
+                if (item->err == 0)
+                {
+                    item->page.sid = recognizeSID;
+                    item->err = recognizePage(item->page);
+                }
+                mine.busy += secondsSince(workStart);
+                mine.pages++;
+
+                mine.waitOut += recognized.push(item);
+            }
+            mine.waitIn += waited;
+
+            lock_guard<mutex> guard(statsLock);
+            stats[1].pages += mine.pages;
+            stats[1].busy += mine.busy;
+            stats[1].waitIn += mine.waitIn;
+            stats[1].waitOut += mine.waitOut;
+            if (--recognizersLeft == 0)
+            {
+                recognized.close();
+            }
+        }, recognizeSIDs[r]));
+    }
+
+    // export stage, runs on this thread and exports pages in list order
+    map<size_t, PIPELINE_PAGE *> waiting;
+    PAGE_ARENA arena;
+    size_t nextExport = first;
+    int failed = 0;
+    double waited;
+    PIPELINE_PAGE *item;
+
+    while ((item = recognized.pop(waited)) != NULL)
+    {
+        stats[2].waitIn += waited;
+        waiting[item->page.index] = item;
+
+        while (!waiting.empty() && waiting.begin()->first == nextExport)
+        {
+            item = waiting.begin()->second;
+            waiting.erase(waiting.begin());
+
+            CLOCK::time_point workStart = CLOCK::now();
+            item->page.sid = exportSID;
+            item->page.useArena(arena);
+            item->page.namePrefix = "";
+            item->page.counters = counters;
+            if (item->err == 0)
+            {
+                item->err = exportPage(item->page, [&](PAGE_CONTEXT &p)
+                                       { return pageFunction(p,
+                                                 entries[nextExport]); });
+            }
+            if (item->err != 0)
+            {
+                failed++;
+            }
+            counters = item->page.counters;
+            freePage(item->page);
+            appendPageRecords(item->page, sinks);
+            delete item;
+            stats[2].busy += secondsSince(workStart);
+            stats[2].pages++;
+
+            {
+                lock_guard<mutex> guard(slotLock);
+                freeSlots++;
+            }
+            slotFreed.notify_one();
+            nextExport++;
+        }
+    }
+    stats[2].waitIn += waited;
+
+    loader.join();
+    for (size_t r = 0; r < recognizers.size(); r++)
+    {
+        recognizers[r].join();
+        engine.releaseSettings(recognizeSIDs[r]);
+    }
+    engine.releaseSettings(loadSID);
+    engine.releaseSettings(exportSID);
+
+    PAGE_QUEUE *queues[2] = {&loaded, &recognized};
+    const char *queueNames[2] = {"loaded", "recognized"};
+    printPipelineStats(stats, 3, queues, queueNames, 2,
+                       secondsSince(runStart));
+
+    return (failed == 0 ? 0 : 1);
+}
@@ -0,0 +1,117 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrPipeline.cpp program
+ *
+ * The staged pipeline splits the work for a page into three stages that run
+ * on their own threads:
+ *
+ *      load      : kRecLoadImgF, kRecPreprocessImg, kRecGetImgInfo
+ *      recognize : kRecLocateZones, kRecRecognize, kRecGetLetters
+ *      export    : finding words/strings, saving bBox images, writing records
+ *
+ * The stages are connected by bounded queues, so page N+1 is loaded while
+ * page N is recognized and page N-1 is exported.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_PIPELINE_H
+#define OCR_PIPELINE_H
+
+#include "ocrBatch.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+
+/*
+ * A page on its way through the pipeline, and the result of its stages.
+ */
+struct PIPELINE_PAGE
+{
+    PAGE_CONTEXT page;
+    int err;                    // first error of any stage, 0 if none
+};
+
+
+/*
+ * Time and page counts for one pipeline stage. Times are in seconds and
+ * summed over all threads of the stage.
+ */
+struct STAGE_STATS
+{
+    const char *name;
+    int nThreads;               // threads running this stage
+    long pages;                 // pages that went through the stage
+    double busy;                // time spent doing the stage's work
+    double waitIn;              // time spent waiting for a page to work on
+    double waitOut;             // time spent waiting for room downstream
+};
+
+
+/*
+ * A bounded queue of pages between two stages. push() blocks while the queue
+ * is full and pop() blocks while it is empty. The queue keeps track of how
+ * full it was, so we can see which stage is the bottleneck.
+ */
+class PAGE_QUEUE
+{
+private:
+
+    std::deque<PIPELINE_PAGE *> pages;
+    size_t capacity;            // the most pages the queue can hold
+    bool closed;                // true once the producer is done
+
+    size_t maxDepth;            // the most pages the queue ever held
+    double depthSum;            // sum of the depth seen by every push
+    long nPushes;
+
+    std::mutex lock;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+public:
+    // constructor
+    PAGE_QUEUE(size_t maxPages);
+
+    // adds a page, returns the time spent waiting for room (seconds)
+    double push(PIPELINE_PAGE *page);
+
+    // takes a page off the queue, NULL once the queue is closed and empty.
+    // waited is set to the time spent waiting for a page (seconds)
+    PIPELINE_PAGE *pop(double &waited);
+
+    // tells the consumer that no more pages will come
+    void close();
+
+    size_t getCapacity() { return capacity; }
+    size_t getMaxDepth() { return maxDepth; }
+    double getAverageDepth() { return nPushes > 0 ? depthSum / nPushes : 0; }
+};
+
+
+/*
+ * Runs the pages through the load -> recognize -> export pipeline and
+ * hands the page records to the output sinks in the order of the image
+ * list. The recognize stage runs on options.nWorkers threads, the load and
+ * export stages on one thread each. Every thread has its own settings ID.
+ *
+ * Pages are exported in list order, so bBox images are named l-0, l-1, ...
+ * across the whole run just like a serial run.
+ *
+ * At the end, the per-stage counters and queue depths are printed.
+ *
+ * This function returns 0 if every page was processed successfully, 1 if
+ * some pages failed, and -1 if the pipeline could not be started (in which
+ * case nothing was processed).
+ *
+ * @param engine: the running engine session
+ * @param entries: the pages to process
+ * @param sinks: the sinks for letter and word results
+ * @param options: the run options (queue depth, recognize threads)
+ * @param pageFunction: the export stage for each page
+ */
+extern int runPipeline(OCR_ENGINE &engine, std::vector<BATCH_ENTRY> &entries,
+                       OUTPUT_SINKS &sinks, RUN_OPTIONS &options,
+                       PAGE_FUNCTION pageFunction);
+
+#endif
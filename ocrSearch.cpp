@@ -0,0 +1,276 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrSearch.h
+ *
+ * The automaton is built as a trie of the patterns with failure links.
+ * The edges of all nodes are kept in flat arrays sorted by character, so a
+ * step is a binary search over the few edges of one node.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrSearch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <algorithm>
+
+
+using namespace std;
+
+
+/*
+ * Reads a to-find file and compiles its lines. Lines are converted to wide
+ * characters with mbstowcs, like the rest of the program does.
+ * Returns 0 on success and 1 if the file could not be read.
+ *
+ * @param path: the to-find file, one string per line
+ */
+int PATTERN_SET::load(string path)
+{
+    ifstream findFile(path.c_str());
+    vector<wstring> findLines;
+    string findLine;
+
+    if (!findFile)
+    {
+        printf("could not open %s\n", path.c_str());
+        return 1;
+    }
+
+    while (getline(findFile, findLine))
+    {
+        vector<wchar_t> wide(findLine.length() + 1);
+        size_t length = mbstowcs(&wide[0], findLine.c_str(), wide.size());
+        if (length == (size_t) -1)
+        {
+            printf("skipping line that is not valid text in %s\n",
+                   path.c_str());
+            continue;
+        }
+        findLines.push_back(wstring(&wide[0], length));
+    }
+
+    compile(findLines);
+    return 0;
+}
+
+
+/*
+ * Compiles the given lines into the automaton. Repeated and empty lines
+ * are skipped.
+ *
+ * @param findLines: the strings to look for, in the order they are reported
+ */
+void PATTERN_SET::compile(const vector<wstring> &findLines)
+{
+    set<wstring> seen;
+
+    patterns.clear();
+    for (size_t i = 0; i < findLines.size(); i++)
+    {
+        if (!findLines[i].empty() && seen.insert(findLines[i]).second)
+        {
+            patterns.push_back(findLines[i]);
+        }
+    }
+    build();
+}
+
+
+/*
+ * Returns the node reached from node with the character c, or -1 if the
+ * trie has no such edge.
+ */
+int PATTERN_SET::step(int node, wchar_t c) const
+{
+    const wchar_t *first = edgeChar.data() + edgeStart[node];
+    const wchar_t *last = edgeChar.data() + edgeStart[node + 1];
+    const wchar_t *found = lower_bound(first, last, c);
+
+    if (found == last || *found != c)
+    {
+        return -1;
+    }
+    return edgeNext[found - edgeChar.data()];
+}
+
+
+/*
+ * Builds the trie of the patterns, flattens its edges and adds the failure
+ * and output links.
+ */
+void PATTERN_SET::build()
+{
+    vector<map<wchar_t, int> > trie(1);
+    vector<int> order;      // the nodes in breadth first order
+
+    output.assign(1, -1);
+    for (size_t p = 0; p < patterns.size(); p++)
+    {
+        int node = 0;
+        for (size_t i = 0; i < patterns[p].size(); i++)
+        {
+            map<wchar_t, int>::iterator it = trie[node].find(patterns[p][i]);
+            if (it == trie[node].end())
+            {
+                trie.push_back(map<wchar_t, int>());
+                output.push_back(-1);
+                it = trie[node].insert(make_pair(patterns[p][i],
+                                                 (int) trie.size() - 1)).first;
+            }
+            node = it->second;
+        }
+        output[node] = p;
+    }
+
+    // flatten the edges, map iterates in character order
+    size_t nNodes = trie.size();
+    edgeStart.assign(nNodes + 1, 0);
+    edgeChar.clear();
+    edgeNext.clear();
+    for (size_t n = 0; n < nNodes; n++)
+    {
+        edgeStart[n] = edgeChar.size();
+        for (map<wchar_t, int>::iterator it = trie[n].begin();
+             it != trie[n].end(); ++it)
+        {
+            edgeChar.push_back(it->first);
+            edgeNext.push_back(it->second);
+        }
+    }
+    edgeStart[nNodes] = edgeChar.size();
+
+    // failure links, breadth first so a node's fail is done before it
+    fail.assign(nNodes, 0);
+    outputLink.assign(nNodes, -1);
+    order.push_back(0);
+    for (size_t k = 0; k < order.size(); k++)
+    {
+        int node = order[k];
+        for (int e = edgeStart[node]; e < edgeStart[node + 1]; e++)
+        {
+            int child = edgeNext[e];
+            int f = fail[node];
+            int next = -1;
+
+            if (node != 0)
+            {
+                while ((next = step(f, edgeChar[e])) == -1 && f != 0)
+                {
+                    f = fail[f];
+                }
+            }
+            fail[child] = (next == -1 ? 0 : next);
+            outputLink[child] = (output[fail[child]] != -1 ?
+                                 fail[child] : outputLink[fail[child]]);
+            order.push_back(child);
+        }
+    }
+}
+
+
+/*
+ * Finds all patterns in the text in one pass. matches[p] is set to the
+ * start positions of pattern p's matches, leftmost first and without
+ * overlaps between matches of the same pattern.
+ *
+ * @param text: the text to search
+ * @param length: the number of characters in text
+ * @param matches: one vector of start positions per pattern
+ */
+void PATTERN_SET::findAll(const wchar_t *text, int length,
+                          vector<vector<int> > &matches) const
+{
+    // every occurrence of every pattern, in order of their start for each
+    // pattern (occurrences of one pattern end in order, so they start in
+    // order too)
+    vector<vector<int> > found(patterns.size());
+    int node = 0;
+
+    for (int i = 0; i < length; i++)
+    {
+        int next;
+        while ((next = step(node, text[i])) == -1 && node != 0)
+        {
+            node = fail[node];
+        }
+        node = (next == -1 ? 0 : next);
+
+        int out = (output[node] != -1 ? node : outputLink[node]);
+        while (out != -1)
+        {
+            int p = output[out];
+            found[p].push_back(i + 1 - (int) patterns[p].size());
+            out = outputLink[out];
+        }
+    }
+
+    // keep the matches a left to right wcsstr search would find
+    matches.assign(patterns.size(), vector<int>());
+    for (size_t p = 0; p < patterns.size(); p++)
+    {
+        int size = patterns[p].size();
+        int end = 0;
+        for (size_t k = 0; k < found[p].size(); k++)
+        {
+            if (found[p][k] >= end)
+            {
+                matches[p].push_back(found[p][k]);
+                end = found[p][k] + size;
+            }
+        }
+    }
+}
+
+
+/*
+ * ____________________________________________________________________________
+ *  Definitions for class: PATTERN_CACHE
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * Returns the compiled set of a to-find file, loading it on first use.
+ * Files are compiled outside the lock, so threads that need different
+ * files do not wait for each other. Returns NULL if the file could not be
+ * read; such files are tried again on the next call.
+ *
+ * @param path: the to-find file
+ */
+shared_ptr<const PATTERN_SET> PATTERN_CACHE::get(string path)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        map<string, shared_ptr<const PATTERN_SET> >::iterator it =
+            sets.find(path);
+        if (it != sets.end())
+        {
+            return it->second;
+        }
+    }
+
+    shared_ptr<PATTERN_SET> compiled(new PATTERN_SET());
+    if (compiled->load(path) != 0)
+    {
+        return shared_ptr<const PATTERN_SET>();
+    }
+
+    // if another thread compiled the file meanwhile, use its set
+    lock_guard<mutex> guard(lock);
+    return sets.insert(make_pair(path,
+                       shared_ptr<const PATTERN_SET>(compiled))).first->second;
+}
+
+
+/*
+ * Drops all cached sets.
+ */
+void PATTERN_CACHE::clear()
+{
+    lock_guard<mutex> guard(lock);
+    sets.clear();
+}
@@ -0,0 +1,106 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrSearch.cpp program
+ *
+ * extractStrings and extractExact look for every line of a to-find file in
+ * the recognized text of a page. Instead of one wcsstr pass per line, the
+ * lines are compiled once into an Aho-Corasick automaton that finds all of
+ * them in a single pass over the text. Compiled files are cached by path
+ * and shared by all pages and threads of a run.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_SEARCH_H
+#define OCR_SEARCH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <wchar.h>
+
+
+/*
+ * The compiled lines of one to-find file.
+ *
+ * Every distinct line is one pattern, in the order the lines first appear
+ * in the file; repeated and empty lines are skipped. Matches are reported
+ * per pattern, like searching for each line with wcsstr: the leftmost
+ * match first, then the next match that starts after its end.
+ *
+ * A compiled set is never changed, so one set can be searched by several
+ * threads at the same time.
+ */
+class PATTERN_SET
+{
+private:
+
+    std::vector<std::wstring> patterns;     // the distinct lines, in order
+
+    // the automaton, node 0 is the root. The edges of node n are
+    // [edgeStart[n], edgeStart[n + 1]) in edgeChar/edgeNext, sorted by
+    // character.
+    std::vector<int> edgeStart;
+    std::vector<wchar_t> edgeChar;
+    std::vector<int> edgeNext;
+    std::vector<int> fail;          // longest proper suffix that is a node
+    std::vector<int> output;        // pattern ending at the node, or -1
+    std::vector<int> outputLink;    // next node on the fail chain with an
+                                    // output, or -1
+
+    // the node reached from node with c, or -1
+    int step(int node, wchar_t c) const;
+
+    // builds the automaton from the patterns
+    void build();
+
+public:
+    // reads and compiles a to-find file, returns 0 on success
+    int load(std::string path);
+
+    // compiles the given lines
+    void compile(const std::vector<std::wstring> &findLines);
+
+    size_t getPatternCount() const { return patterns.size(); }
+
+    const std::wstring &getPattern(size_t pattern) const
+    {
+        return patterns[pattern];
+    }
+
+    /*
+     * Finds all patterns in the text in one pass. matches[p] is set to the
+     * start positions of pattern p's matches, leftmost first and without
+     * overlaps between matches of the same pattern.
+     *
+     * @param text: the text to search
+     * @param length: the number of characters in text
+     * @param matches: one vector of start positions per pattern
+     */
+    void findAll(const wchar_t *text, int length,
+                 std::vector<std::vector<int> > &matches) const;
+};
+
+
+/*
+ * Compiled to-find files by path. The first page that asks for a file
+ * loads and compiles it; every later page (on any thread) gets the same
+ * set. get() is thread-safe.
+ */
+class PATTERN_CACHE
+{
+private:
+
+    std::map<std::string, std::shared_ptr<const PATTERN_SET> > sets;
+    std::mutex lock;
+
+public:
+    // the compiled set of the file, NULL if it could not be read
+    std::shared_ptr<const PATTERN_SET> get(std::string path);
+
+    // drops all sets (pages still holding a set keep it alive)
+    void clear();
+};
+
+#endif
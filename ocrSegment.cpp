@@ -0,0 +1,379 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrSegment.h
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrSegment.h"
+#include <algorithm>
+
+
+using namespace std;
+
+
+/*
+ * Copies the bBoxes of the letters into the arrays.
+ *
+ * @param pLetters: the recognition result for the page
+ * @param nLetters: the number of LETTERS in pLetters
+ */
+void LETTER_GEOMETRY::assign(const LETTER *pLetters, int nLetters)
+{
+    left.resize(nLetters);
+    top.resize(nLetters);
+    right.resize(nLetters);
+    bottom.resize(nLetters);
+    for (int i = 0; i < nLetters; i++)
+    {
+        left[i] = pLetters[i].left;
+        top[i] = pLetters[i].top;
+        right[i] = pLetters[i].left + pLetters[i].width;
+        bottom[i] = pLetters[i].top + pLetters[i].height;
+    }
+}
+
+
+/*
+ * Sets the number of letters, keeping the memory of earlier pages.
+ *
+ * @param nLetters: the number of letters on the page
+ */
+void LETTER_SQUARES::resize(size_t nLetters)
+{
+    left.resize(nLetters);
+    top.resize(nLetters);
+    right.resize(nLetters);
+    bottom.resize(nLetters);
+    onPage.resize(nLetters);
+}
+
+
+/*
+ * Fits n letters into squares, see fitSquares(). The arrays do not overlap
+ * (__restrict), so the compiler needs no run-time alias checks to keep the
+ * loop in SIMD registers. The margin is side / SQUARE_MARGIN, truncated
+ * towards zero: the same pixels the export got from
+ * "rect.left -= side * 0.05", but in integers.
+ */
+static void fitSquareRun(const int32_t *__restrict left,
+                         const int32_t *__restrict top,
+                         const int32_t *__restrict right,
+                         const int32_t *__restrict bottom, int n,
+                         int squareSize, int pageWidth, int pageHeight,
+                         int32_t *__restrict squareLeft,
+                         int32_t *__restrict squareTop,
+                         int32_t *__restrict squareRight,
+                         int32_t *__restrict squareBottom,
+                         uint8_t *__restrict onPage)
+{
+    for (int i = 0; i < n; i++)
+    {
+        int32_t width = right[i] - left[i];
+        int32_t height = bottom[i] - top[i];
+        int32_t side = squareSize;
+        if (squareSize == 0)
+        {
+            side = (width > height ? width : height);
+        }
+
+        // center the letter in the square, the square keeps its side when
+        // the difference is odd
+        int32_t squareX = left[i] - (side - width) / 2;
+        int32_t squareY = top[i] - (side - height) / 2;
+
+        int32_t l = (SQUARE_MARGIN * squareX - side) / SQUARE_MARGIN;
+        int32_t t = (SQUARE_MARGIN * squareY - side) / SQUARE_MARGIN;
+        int32_t r = (SQUARE_MARGIN * (squareX + side) + side) / SQUARE_MARGIN;
+        int32_t b = (SQUARE_MARGIN * (squareY + side) + side) / SQUARE_MARGIN;
+        squareLeft[i] = l;
+        squareTop[i] = t;
+        squareRight[i] = r;
+        squareBottom[i] = b;
+        onPage[i] = (l >= 0) & (t >= 0) & (r <= pageWidth) & (b <= pageHeight);
+    }
+}
+
+
+/*
+ * Fits the letters from first to last (exclusive) into squares (see
+ * ocrSegment.h).
+ *
+ * @param geometry: the bBoxes of the page's letters
+ * @param first, last: the letters to fit
+ * @param squareSize: the side of the squares, 0 for each letter's own
+ * @param pageWidth, pageHeight: the page, for LETTER_SQUARES::onPage
+ * @param squares: entries first to last are set
+ */
+void fitSquares(const LETTER_GEOMETRY &geometry, int first, int last,
+                int squareSize, int pageWidth, int pageHeight,
+                LETTER_SQUARES &squares)
+{
+    if (last <= first)
+    {
+        return;
+    }
+    fitSquareRun(&geometry.left[first], &geometry.top[first],
+                 &geometry.right[first], &geometry.bottom[first],
+                 last - first, squareSize, pageWidth, pageHeight,
+                 &squares.left[first], &squares.top[first],
+                 &squares.right[first], &squares.bottom[first],
+                 &squares.onPage[first]);
+}
+
+
+/*
+ * Finds the bBox and the largest letter of the letters from first to last
+ * (inclusive), in one pass over the arrays, and the word's export box: the
+ * bBox with half the largest letter added on every side, clipped to the
+ * page.
+ *
+ * @param geometry: the bBoxes of the page's letters
+ * @param first, last: the letters to measure
+ * @param pageWidth, pageHeight: the page to clip the word box to
+ * @param extent: set to the bBox, largest letter and word box
+ */
+void measureLetters(const LETTER_GEOMETRY &geometry, int first, int last,
+                    int pageWidth, int pageHeight, LETTER_EXTENT &extent)
+{
+    const int32_t *left = &geometry.left[0];
+    const int32_t *top = &geometry.top[0];
+    const int32_t *right = &geometry.right[0];
+    const int32_t *bottom = &geometry.bottom[0];
+    int32_t unionLeft = left[first];
+    int32_t unionTop = top[first];
+    int32_t unionRight = right[first];
+    int32_t unionBottom = bottom[first];
+    int32_t largestWidth = 0;
+    int32_t largestHeight = 0;
+
+    for (int k = first; k <= last; k++)
+    {
+        int32_t width = right[k] - left[k];
+        int32_t height = bottom[k] - top[k];
+        int32_t unsized = (min(width, height) > 0) - 1;    // all ones or 0
+
+        // a letter without a size takes part with edges that change
+        // nothing (page coordinates are not negative); masks instead of
+        // branches keep the loop in SIMD registers
+        largestWidth = max(largestWidth, width);
+        largestHeight = max(largestHeight, height);
+        unionLeft = min(unionLeft, left[k] | (unsized & INT32_MAX));
+        unionTop = min(unionTop, top[k] | (unsized & INT32_MAX));
+        unionRight = max(unionRight, right[k] & ~unsized);
+        unionBottom = max(unionBottom, bottom[k] & ~unsized);
+    }
+
+    extent.rect.left = unionLeft;
+    extent.rect.top = unionTop;
+    extent.rect.right = unionRight;
+    extent.rect.bottom = unionBottom;
+    extent.largestWidth = largestWidth;
+    extent.largestHeight = largestHeight;
+
+    extent.wordRect.left = max(unionLeft - largestWidth / 2, 0);
+    extent.wordRect.top = max(unionTop - largestHeight / 2, 0);
+    extent.wordRect.right = min(unionRight + largestWidth / 2, pageWidth);
+    extent.wordRect.bottom = min(unionBottom + largestHeight / 2,
+                                 pageHeight);
+}
+
+
+/*
+ * Finds the words and lines from the engine's makeup flags.
+ *
+ * @param pLetters: the recognition result for the page
+ * @param nLetters: the number of LETTERS in pLetters
+ * @param words: set to the letter ranges of the words
+ * @param lines: set to the letter ranges of the lines, or NULL
+ */
+static void findEngineWords(const LETTER *pLetters, int nLetters,
+                            vector<LETTER_RANGE> &words,
+                            vector<LETTER_RANGE> *lines)
+{
+    int start = 0;           // index of the first letter in the current word
+    int lineStart = -1;      // index of the first letter in the current line
+    bool foundEnd = FALSE;
+    bool foundStart = TRUE;
+
+    for (int i = 0; i < nLetters; i++)
+    {
+        // ignore the character if it has no width (newline, etc...)
+        if (pLetters[i].width == 0 || pLetters[i].height == 0)
+        {
+            foundStart = FALSE;
+            foundEnd = TRUE;
+            continue;
+        }
+
+        // a line runs up to the letter with the ENDOFLINE flag
+        if (lines != NULL)
+        {
+            if (lineStart < 0)
+            {
+                lineStart = i;
+            }
+            if (pLetters[i].makeup & R_ENDOFLINE)
+            {
+                LETTER_RANGE line = {lineStart, i};
+                lines->push_back(line);
+                lineStart = -1;
+            }
+        }
+
+        // the end of a word is marked by the ENDOFWORD flag
+        if (foundStart && pLetters[i].makeup == R_ENDOFWORD)
+        {
+            LETTER_RANGE word = {start, i};
+            words.push_back(word);
+            foundStart = FALSE;
+            foundEnd = TRUE;
+        }
+
+        // the start of a word is marked by the first non-space letter after
+        // the end of a word
+        else if (foundEnd && (pLetters[i].spcInfo).spcCount < 1 &&
+                 pLetters[i].width > 0)
+        {
+            start = i;
+            foundStart = TRUE;
+            foundEnd = FALSE;
+        }
+    }
+
+    // a last line without the flag
+    if (lines != NULL && lineStart >= 0)
+    {
+        int last = nLetters - 1;
+        while (pLetters[last].width == 0 || pLetters[last].height == 0)
+        {
+            last--;
+        }
+        LETTER_RANGE line = {lineStart, last};
+        lines->push_back(line);
+    }
+}
+
+
+/*
+ * Finds the words and lines from the letter geometry, in one pass over the
+ * arrays (see ocrSegment.h for the rules).
+ *
+ * @param geometry: the bBoxes of the page's letters
+ * @param words: set to the letter ranges of the words
+ * @param lines: set to the letter ranges of the lines, or NULL
+ */
+static void findGeometryWords(const LETTER_GEOMETRY &geometry,
+                              vector<LETTER_RANGE> &words,
+                              vector<LETTER_RANGE> *lines)
+{
+    int n = (int) geometry.left.size();
+    const int32_t *left = n > 0 ? &geometry.left[0] : NULL;
+    const int32_t *top = n > 0 ? &geometry.top[0] : NULL;
+    const int32_t *right = n > 0 ? &geometry.right[0] : NULL;
+    const int32_t *bottom = n > 0 ? &geometry.bottom[0] : NULL;
+
+    int wordFirst = -1;     // first letter of the current word
+    int lineFirst = -1;     // first letter of the current line
+    int prev = -1;          // the last letter with a size
+    double bandTop = 0;     // the line's band: the average top and bottom
+    double bandBottom = 0;  // of its full-height letters
+    int bandCount = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        int height = bottom[i] - top[i];
+        if (right[i] <= left[i] || height <= 0)
+        {
+            continue;
+        }
+
+        bool newLine = (prev < 0);
+        bool newWord = newLine;
+        if (!newLine)
+        {
+            double lineHeight = bandBottom - bandTop;
+            double overlap = min((double) bottom[i], bandBottom) -
+                             max((double) top[i], bandTop);
+            double gap = left[i] - right[prev];
+
+            newLine = overlap < 0.5 * min((double) height, lineHeight) ||
+                      left[i] < left[prev] - 0.5 * lineHeight ||
+                      gap > GEOMETRY_COLUMN_GAP * lineHeight;
+            newWord = newLine || gap > GEOMETRY_WORD_GAP * lineHeight;
+        }
+
+        if (newWord && wordFirst >= 0)
+        {
+            LETTER_RANGE word = {wordFirst, prev};
+            words.push_back(word);
+        }
+        if (newWord)
+        {
+            wordFirst = i;
+        }
+        if (newLine && lineFirst >= 0 && lines != NULL)
+        {
+            LETTER_RANGE line = {lineFirst, prev};
+            lines->push_back(line);
+        }
+
+        // punctuation and hyphens do not move the band of the line
+        if (newLine)
+        {
+            lineFirst = i;
+            bandTop = top[i];
+            bandBottom = bottom[i];
+            bandCount = 1;
+        }
+        else if (height >= 0.5 * (bandBottom - bandTop))
+        {
+            bandCount++;
+            bandTop += (top[i] - bandTop) / bandCount;
+            bandBottom += (bottom[i] - bandBottom) / bandCount;
+        }
+        prev = i;
+    }
+
+    if (prev >= 0)
+    {
+        LETTER_RANGE word = {wordFirst, prev};
+        words.push_back(word);
+        if (lines != NULL)
+        {
+            LETTER_RANGE line = {lineFirst, prev};
+            lines->push_back(line);
+        }
+    }
+}
+
+
+/*
+ * Finds the words and lines of a page, in page order.
+ *
+ * @param pLetters: the recognition result for the page
+ * @param nLetters: the number of LETTERS in pLetters
+ * @param segmenter: the engine flags or the geometry
+ * @param words: set to the letter ranges of the words
+ * @param lines: set to the letter ranges of the lines, or NULL
+ */
+void findWords(const LETTER *pLetters, int nLetters, WORD_SEGMENTER segmenter,
+               vector<LETTER_RANGE> &words, vector<LETTER_RANGE> *lines)
+{
+    words.clear();
+    if (lines != NULL)
+    {
+        lines->clear();
+    }
+
+    if (segmenter == SEGMENT_GEOMETRY)
+    {
+        LETTER_GEOMETRY geometry;
+        geometry.assign(pLetters, nLetters);
+        findGeometryWords(geometry, words, lines);
+    }
+    else
+    {
+        findEngineWords(pLetters, nLetters, words, lines);
+    }
+}
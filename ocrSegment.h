@@ -0,0 +1,175 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrSegment.cpp program
+ *
+ * Word and line segmentation of a recognized page. The engine segmenter
+ * follows the engine's makeup flags: a word ends at a letter with
+ * R_ENDOFWORD and starts at the next letter without spaces before it, and
+ * letters without width or height (newlines, etc.) end a word. Hyphens and
+ * tightly kerned or widely spaced letters make the flags split or merge
+ * words.
+ *
+ * The geometry segmenter (-g) ignores the flags and looks at the bBoxes
+ * only. It copies the letter geometry into separate left/top/right/bottom
+ * arrays and makes one pass over them in the engine's reading order:
+ *
+ *  - a letter is on the current line if its box overlaps the line's band
+ *    (the running average top and bottom of the line's full-height
+ *    letters) by at least half of the smaller height, and it does not go
+ *    back to the left; otherwise, or after a gap of more than
+ *    GEOMETRY_COLUMN_GAP line heights, it starts a new line
+ *  - on a line, a gap of more than GEOMETRY_WORD_GAP line heights to the
+ *    previous letter starts a new word
+ *
+ * Letters without width or height are skipped, they neither end nor start
+ * a word. Every letter with a size ends up in exactly one word and line.
+ *
+ * Both return the words and lines as ranges of pLetters, the ranges that
+ * OCR_WORD takes.
+ *
+ * The same arrays give the export boxes: fitSquares() fits a run of letters
+ * into their squares (with the 5% margin) and checks them against the page,
+ * measureLetters() finds the bBox and largest letter of a word in one pass
+ * and pads and clips the word's export box to the page.
+ * Both are plain loops over the arrays without branches on the letters, so
+ * the compiler turns them into SIMD code; a page's own-size squares are
+ * fitted once for all its letters before anything is exported.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_SEGMENT_H
+#define OCR_SEGMENT_H
+
+#include "KernelApi.h"
+#include <stdint.h>
+#include <vector>
+
+
+#define GEOMETRY_WORD_GAP   0.35    // word gap, in line heights
+#define GEOMETRY_COLUMN_GAP 3.0     // gap that ends a line, in line heights
+#define SQUARE_MARGIN       20      // room around a letter square: 1/20 side
+
+
+/*
+ * How the words of a page are found.
+ */
+enum WORD_SEGMENTER
+{
+    SEGMENT_ENGINE,             // the engine's makeup flags (default)
+    SEGMENT_GEOMETRY            // bBox gaps, baselines and font height (-g)
+};
+
+
+/*
+ * A run of letters in pLetters, from first to last (inclusive).
+ */
+struct LETTER_RANGE
+{
+    int first;
+    int last;
+};
+
+
+/*
+ * The geometry of a page's letters as separate arrays, so the segmenter
+ * reads only the coordinates, one array after the other.
+ */
+struct LETTER_GEOMETRY
+{
+    std::vector<int32_t> left;
+    std::vector<int32_t> top;
+    std::vector<int32_t> right;     // exclusive
+    std::vector<int32_t> bottom;    // exclusive
+
+    // copies the bBoxes of the letters
+    void assign(const LETTER *pLetters, int nLetters);
+};
+
+
+/*
+ * The squares the letter bBox images are cut from, one entry per letter of
+ * the page, in the same layout as LETTER_GEOMETRY.
+ */
+struct LETTER_SQUARES
+{
+    std::vector<int32_t> left;
+    std::vector<int32_t> top;
+    std::vector<int32_t> right;     // exclusive
+    std::vector<int32_t> bottom;    // exclusive
+    std::vector<uint8_t> onPage;    // 1 if the square lies inside the page
+
+    // sets the number of letters, keeping the memory of earlier pages
+    void resize(size_t nLetters);
+
+    // the square of a letter as a RECT
+    RECT getRect(int i) const
+    {
+        RECT rect;
+        rect.left = left[i];
+        rect.top = top[i];
+        rect.right = right[i];
+        rect.bottom = bottom[i];
+        return rect;
+    }
+};
+
+
+/*
+ * The bBox of a run of letters and its largest letter.
+ */
+struct LETTER_EXTENT
+{
+    RECT rect;                  // the union of the letters with a size
+    int largestWidth;
+    int largestHeight;
+    RECT wordRect;              // rect with half the largest letter added on
+                                // every side, clipped to the page
+};
+
+
+/*
+ * Fits the letters from first to last (exclusive) into squares, centered on
+ * the letter, and adds a margin of 1 / SQUARE_MARGIN sides around them.
+ *
+ * @param geometry: the bBoxes of the page's letters
+ * @param first, last: the letters to fit
+ * @param squareSize: the side of the squares, or 0 to give every letter a
+ *                    square of its own larger side
+ * @param pageWidth, pageHeight: the page, for LETTER_SQUARES::onPage
+ * @param squares: entries first to last are set, it must hold the page
+ */
+extern void fitSquares(const LETTER_GEOMETRY &geometry, int first, int last,
+                       int squareSize, int pageWidth, int pageHeight,
+                       LETTER_SQUARES &squares);
+
+
+/*
+ * Finds the bBox of the letters from first to last (inclusive) and their
+ * largest width and height. The bBox starts as the first letter's and grows
+ * by the letters with a width and a height.
+ *
+ * @param geometry: the bBoxes of the page's letters
+ * @param first, last: the letters to measure
+ * @param pageWidth, pageHeight: the page, for LETTER_EXTENT::wordRect
+ * @param extent: set to the bBox, largest letter and word box
+ */
+extern void measureLetters(const LETTER_GEOMETRY &geometry, int first,
+                           int last, int pageWidth, int pageHeight,
+                           LETTER_EXTENT &extent);
+
+
+/*
+ * Finds the words and lines of a page, in page order.
+ *
+ * @param pLetters: the recognition result for the page
+ * @param nLetters: the number of LETTERS in pLetters
+ * @param segmenter: the engine flags or the geometry
+ * @param words: set to the letter ranges of the words
+ * @param lines: set to the letter ranges of the lines, or NULL
+ */
+extern void findWords(const LETTER *pLetters, int nLetters,
+                      WORD_SEGMENTER segmenter,
+                      std::vector<LETTER_RANGE> &words,
+                      std::vector<LETTER_RANGE> *lines = NULL);
+
+#endif
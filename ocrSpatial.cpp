@@ -0,0 +1,229 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrSpatial.h
+ *
+ * The index keeps every level of the tree in a plain array: the children of
+ * node i are the entries i * INDEX_NODE_SIZE to i * INDEX_NODE_SIZE + 15 of
+ * the level below, so there are no child pointers to follow.
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrSpatial.h"
+#include <math.h>
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+
+using namespace std;
+
+
+/*
+ * Returns the box around the boxes from first to last (exclusive).
+ */
+static INDEX_BOX boundBoxes(const vector<INDEX_BOX> &boxes, size_t first,
+                            size_t last)
+{
+    INDEX_BOX box = boxes[first];
+
+    for (size_t i = first + 1; i < last; i++)
+    {
+        box.left = min(box.left, boxes[i].left);
+        box.top = min(box.top, boxes[i].top);
+        box.right = max(box.right, boxes[i].right);
+        box.bottom = max(box.bottom, boxes[i].bottom);
+    }
+    return box;
+}
+
+
+/*
+ * LETTER_INDEX constructor, packs the letters with a width and a height into
+ * the tree.
+ *
+ * @param pLetters: the recognition result of the page
+ * @param nLetters: the number of LETTERS in pLetters
+ */
+LETTER_INDEX::LETTER_INDEX(const LETTER *pLetters, int nLetters)
+{
+    for (int i = 0; i < nLetters; i++)
+    {
+        if (pLetters[i].width > 0 && pLetters[i].height > 0)
+        {
+            letterIds.push_back(i);
+        }
+    }
+    size_t n = letterIds.size();
+    if (n == 0)
+    {
+        return;
+    }
+
+    // Sort-Tile-Recursive: cut the letters into vertical slices of about
+    // sqrt(leaves) leaves each by the x of their centers, then sort every
+    // slice top to bottom, so each run of INDEX_NODE_SIZE is a compact tile
+    size_t nLeaves = (n + INDEX_NODE_SIZE - 1) / INDEX_NODE_SIZE;
+    size_t nSlices = (size_t) ceil(sqrt((double) nLeaves));
+    size_t sliceSize = ((nLeaves + nSlices - 1) / nSlices) * INDEX_NODE_SIZE;
+
+    sort(letterIds.begin(), letterIds.end(), [&](int a, int b)
+         {
+             return 2 * pLetters[a].left + pLetters[a].width <
+                    2 * pLetters[b].left + pLetters[b].width;
+         });
+    for (size_t first = 0; first < n; first += sliceSize)
+    {
+        size_t last = min(first + sliceSize, n);
+        sort(letterIds.begin() + first, letterIds.begin() + last,
+             [&](int a, int b)
+             {
+                 return 2 * pLetters[a].top + pLetters[a].height <
+                        2 * pLetters[b].top + pLetters[b].height;
+             });
+    }
+
+    letterBoxes.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const LETTER &letter = pLetters[letterIds[i]];
+        letterBoxes[i].left = letter.left;
+        letterBoxes[i].top = letter.top;
+        letterBoxes[i].right = letter.left + letter.width;
+        letterBoxes[i].bottom = letter.top + letter.height;
+    }
+
+    // every level bounds runs of INDEX_NODE_SIZE entries of the one below,
+    // up to a single root
+    const vector<INDEX_BOX> *below = &letterBoxes;
+    do
+    {
+        vector<INDEX_BOX> level;
+        for (size_t first = 0; first < below->size(); first += INDEX_NODE_SIZE)
+        {
+            level.push_back(boundBoxes(*below, first,
+                min(first + INDEX_NODE_SIZE, below->size())));
+        }
+        levels.push_back(level);
+        below = &levels.back();
+    }
+    while (below->size() > 1);
+}
+
+
+/*
+ * Adds the letters whose bBox lies inside the region to letters, in page
+ * order (the order of pLetters).
+ *
+ * @param region: the region, right and bottom exclusive
+ * @param letters: the vector to add the letter indices to
+ */
+void LETTER_INDEX::query(RECT region, vector<int> &letters) const
+{
+    size_t first = letters.size();
+    vector<pair<int, size_t> > stack;   // (level, node) still to visit
+
+    if (levels.empty())
+    {
+        return;
+    }
+
+    stack.push_back(make_pair((int) levels.size() - 1, (size_t) 0));
+    while (!stack.empty())
+    {
+        int level = stack.back().first;
+        size_t node = stack.back().second;
+        stack.pop_back();
+
+        // a node can only hold letters inside the region if it meets it
+        const INDEX_BOX &box = levels[level][node];
+        if (box.right <= region.left || box.left >= region.right ||
+            box.bottom <= region.top || box.top >= region.bottom)
+        {
+            continue;
+        }
+
+        const vector<INDEX_BOX> &below = (level == 0 ? letterBoxes
+                                                     : levels[level - 1]);
+        size_t last = min((node + 1) * INDEX_NODE_SIZE, below.size());
+        for (size_t child = node * INDEX_NODE_SIZE; child < last; child++)
+        {
+            if (level > 0)
+            {
+                stack.push_back(make_pair(level - 1, child));
+            }
+            else if (below[child].left >= region.left &&
+                     below[child].right <= region.right &&
+                     below[child].top >= region.top &&
+                     below[child].bottom <= region.bottom)
+            {
+                letters.push_back(letterIds[child]);
+            }
+        }
+    }
+    sort(letters.begin() + first, letters.end());
+}
+
+
+/*
+ * Reads the regions of one page from a region file: the regions before the
+ * first "page <n>" line, and the ones after "page <pageNumber>".
+ * This function returns 0 on success.
+ *
+ * @param path: the region file
+ * @param pageNumber: the page of the image (0 = first)
+ * @param regions: set to the regions for the page
+ */
+int readRegions(string path, int pageNumber, vector<RECT> &regions)
+{
+    ifstream in(path);
+    string line;
+    int lineNumber = 0;
+    int page = -1;          // -1 until the first page line: every page
+
+    regions.clear();
+    if (!in.is_open())
+    {
+        printf("could not open region file %s\n", path.c_str());
+        return 1;
+    }
+
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string first;
+        RECT region;
+
+        lineNumber++;
+        if (!(fields >> first) || first[0] == '#')
+        {
+            continue;
+        }
+        if (first == "page")
+        {
+            if (!(fields >> page) || page < 0)
+            {
+                printf("ERROR, %s line %d: page needs a page number\n",
+                       path.c_str(), lineNumber);
+                return 1;
+            }
+            continue;
+        }
+
+        istringstream numbers(line);
+        if (!(numbers >> region.left >> region.top >> region.right
+                      >> region.bottom) ||
+            region.right <= region.left || region.bottom <= region.top)
+        {
+            printf("ERROR, %s line %d: a region is <left> <top> <right> "
+                   "<bottom>\n", path.c_str(), lineNumber);
+            return 1;
+        }
+        if (page == -1 || page == pageNumber)
+        {
+            regions.push_back(region);
+        }
+    }
+    return 0;
+}
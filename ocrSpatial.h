@@ -0,0 +1,96 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrSpatial.cpp program
+ *
+ * LETTER_INDEX is a packed R-tree over the bBoxes of the recognized letters
+ * of a page, for questions like "which letters are inside this form
+ * field". The tree is built once per page with Sort-Tile-Recursive
+ * packing: the letters are sorted into vertical slices by x, each slice by
+ * y, and runs of INDEX_NODE_SIZE letters become the leaves; the levels
+ * above group runs of nodes the same way. A query only descends into
+ * nodes whose box meets the query, so it costs O(log n) plus the letters
+ * it returns instead of a pass over the page.
+ *
+ * extractRegions uses the index to export only the letters and words inside
+ * the regions of interest of a region file:
+ *
+ *      <left> <top> <right> <bottom>
+ *
+ * one region per line, in pixels of the preprocessed page (right and bottom
+ * exclusive, like a RECT). Regions listed after a line "page <n>" only apply
+ * to page n of a multi-page file, the ones before the first such line to
+ * every page. Empty lines and lines starting with '#' are skipped.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_SPATIAL_H
+#define OCR_SPATIAL_H
+
+#include "KernelApi.h"
+#include <string>
+#include <vector>
+
+
+#define INDEX_NODE_SIZE 16      // letters per leaf, children per node
+
+
+/*
+ * A bBox in the index, right and bottom exclusive.
+ */
+struct INDEX_BOX
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+
+/*
+ * The packed R-tree of a page. An index is not changed by queries, so one
+ * index can be queried by several threads at the same time.
+ */
+class LETTER_INDEX
+{
+private:
+
+    std::vector<INDEX_BOX> letterBoxes;     // the letter bBoxes, in tree order
+    std::vector<int> letterIds;             // their indices in pLetters
+    std::vector<std::vector<INDEX_BOX> > levels;    // levels[0] holds the
+                                // leaves (node i covers letters i * 16 to
+                                // i * 16 + 15), levels[k] the nodes over
+                                // levels[k - 1]; the last level is the root
+
+public:
+    /*
+     * LETTER_INDEX constructor, indexes the letters of a page that have a
+     * width and a height.
+     *
+     * @param pLetters: the recognition result of the page
+     * @param nLetters: the number of LETTERS in pLetters
+     */
+    LETTER_INDEX(const LETTER *pLetters, int nLetters);
+
+    // the number of letters in the index
+    size_t size() const { return letterIds.size(); }
+
+    /*
+     * Adds the indices (in pLetters) of the letters whose bBox lies inside
+     * the region to letters, in page order.
+     */
+    void query(RECT region, std::vector<int> &letters) const;
+};
+
+
+/*
+ * Reads the regions of one page from a region file.
+ * This function returns 0 on success.
+ *
+ * @param path: the region file
+ * @param pageNumber: the page of the image (0 = first)
+ * @param regions: set to the regions for the page
+ */
+extern int readRegions(std::string path, int pageNumber,
+                       std::vector<RECT> &regions);
+
+#endif
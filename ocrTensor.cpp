@@ -0,0 +1,265 @@
+/*
+ * _____________________________________________________________________________
+ * This program contains function definitions for ocrTensor.h
+ *
+ * The resampling kernel and the tensor tables. The tables are written like
+ * the binary letter/word tables (see ocrBinary.cpp).
+ *
+ * ____________________________________________________________________________
+ */
+
+#include "ocrTensor.h"
+#include <string.h>
+
+
+using namespace std;
+
+
+/*
+ * Fills the area averaging weights of one axis: weights[s * size + o] is
+ * the share of source pixel s in output pixel o. Each output pixel covers
+ * length / size source pixels, so its weights add up to 1.
+ *
+ * @param length: the number of source pixels
+ * @param size: the number of output pixels
+ * @param weights: length * size floats
+ */
+static void fillWeights(int length, int size, vector<float> &weights)
+{
+    double scale = (double) length / size;
+
+    weights.assign((size_t) length * size, 0.0f);
+    for (int o = 0; o < size; o++)
+    {
+        double from = o * scale;
+        double to = from + scale;
+        for (int s = (int) from; s < length && s < to; s++)
+        {
+            double overlap = (s + 1 < to ? s + 1 : to) - (s > from ? s : from);
+            weights[(size_t) s * size + o] = (float) (overlap / scale);
+        }
+    }
+}
+
+
+/*
+ * Resamples a crop to size x size bytes by area averaging, ink is 255.
+ * This function returns 0 on success.
+ *
+ * @param crop: the crop to resample
+ * @param size: N, the width and height of the tensor
+ * @param out: size * size bytes
+ */
+int resampleCrop(const OCR_CROP &crop, int size, BYTE *out)
+{
+    int bpp = crop.bitsPerPixel;
+    vector<float> ink(crop.width);
+    vector<float> xWeights;
+    vector<float> yWeights;
+    vector<float> rows((size_t) crop.height * size, 0.0f);
+    vector<float> tensor((size_t) size * size, 0.0f);
+
+    if (crop.width <= 0 || crop.height <= 0 || size <= 0 ||
+        (bpp != 1 && bpp != 8 && bpp != 24))
+    {
+        return 1;
+    }
+    fillWeights(crop.width, size, xWeights);
+    fillWeights(crop.height, size, yWeights);
+
+    // horizontal pass: every crop row becomes size values
+    for (int y = 0; y < crop.height; y++)
+    {
+        const BYTE *src = &crop.pixels[(size_t) y * crop.bytesPerLine];
+        float *row = &rows[(size_t) y * size];
+
+        for (int x = 0; x < crop.width; x++)
+        {
+            if (bpp == 1)
+            {
+                ink[x] = ((src[x / 8] >> (7 - x % 8)) & 1) ? 255.0f : 0.0f;
+            }
+            else if (bpp == 8)
+            {
+                ink[x] = 255.0f - src[x];
+            }
+            else
+            {
+                ink[x] = 255.0f - (0.299f * src[3 * x] +
+                                   0.587f * src[3 * x + 1] +
+                                   0.114f * src[3 * x + 2]);
+            }
+        }
+        for (int x = 0; x < crop.width; x++)
+        {
+            const float *w = &xWeights[(size_t) x * size];
+            float value = ink[x];
+            if (value == 0.0f)
+            {
+                continue;
+            }
+            for (int o = 0; o < size; o++)
+            {
+                row[o] += value * w[o];
+            }
+        }
+    }
+
+    // vertical pass: every output row is a weighted sum of the crop rows
+    for (int y = 0; y < crop.height; y++)
+    {
+        const float *w = &yWeights[(size_t) y * size];
+        const float *row = &rows[(size_t) y * size];
+        for (int o = 0; o < size; o++)
+        {
+            float share = w[o];
+            if (share == 0.0f)
+            {
+                continue;
+            }
+            float *dst = &tensor[(size_t) o * size];
+            for (int i = 0; i < size; i++)
+            {
+                dst[i] += share * row[i];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < tensor.size(); i++)
+    {
+        float value = tensor[i] + 0.5f;
+        out[i] = (BYTE) (value < 0.0f ? 0 : (value > 255.0f ? 255 : value));
+    }
+    return 0;
+}
+
+
+/*
+ * ____________________________________________________________________________
+ *  Definitions for class: TENSOR_SINK
+ * ____________________________________________________________________________
+ */
+
+
+/*
+ * TENSOR_SINK constructor
+ *
+ * @param filePrefix: the tables are written to <filePrefix>.tensors.bin,
+ *                    <filePrefix>.labels.bin and <filePrefix>.images.txt
+ * @param tensorSize: N, the tensors are N x N bytes
+ */
+TENSOR_SINK::TENSOR_SINK(string filePrefix, int tensorSize)
+{
+    uint64_t nLabels;
+
+    prefix = filePrefix;
+    size = tensorSize;
+    nImages = 0;
+    failed = false;
+
+    tensorFile = openBinaryTable(prefix + ".tensors.bin", TENSOR_MAGIC,
+                                 size * size, nTensors);
+    labelFile = openBinaryTable(prefix + ".labels.bin", TENSOR_LABEL_MAGIC,
+                                sizeof(TENSOR_LABEL), nLabels);
+
+    // count the images that are already in the image table
+    imageFile = fopen((prefix + ".images.txt").c_str(), "a+");
+    if (imageFile != NULL)
+    {
+        int c;
+        fseek(imageFile, 0, SEEK_SET);
+        while ((c = fgetc(imageFile)) != EOF)
+        {
+            if (c == '\n')
+            {
+                nImages++;
+            }
+        }
+        fseek(imageFile, 0, SEEK_END);
+    }
+
+    if (tensorFile == NULL || labelFile == NULL || imageFile == NULL)
+    {
+        printf("could not open tensor output %s\n", prefix.c_str());
+        failed = true;
+    }
+    else if (nLabels != nTensors)
+    {
+        printf("tensor output %s has %llu tensors but %llu labels\n",
+               prefix.c_str(), (unsigned long long) nTensors,
+               (unsigned long long) nLabels);
+        failed = true;
+    }
+}
+
+
+/*
+ * Appends the tensors and labels of one page to the tables.
+ * Returns 0 on success.
+ *
+ * @param imagePath: the image the tensors come from
+ * @param pageNumber: the page of the image (0 = first)
+ * @param namePrefix: the prefix of the page's bBox image names
+ * @param tensors: size * size bytes per letter of the page
+ * @param labels: one label per letter of the page
+ */
+int TENSOR_SINK::writePage(string imagePath, int pageNumber,
+                           string namePrefix, vector<BYTE> &tensors,
+                           vector<TENSOR_LABEL> &labels)
+{
+    lock_guard<mutex> guard(lock);
+
+    if (failed)
+    {
+        return 1;
+    }
+
+    for (size_t i = 0; i < labels.size(); i++)
+    {
+        labels[i].imageId = nImages;
+    }
+
+    fprintf(imageFile, "%s\t%s\t%d\n", imagePath.c_str(), namePrefix.c_str(),
+            pageNumber);
+    nImages++;
+
+    if (!labels.empty() &&
+        (fwrite(&tensors[0], 1, tensors.size(), tensorFile) != tensors.size() ||
+         fwrite(&labels[0], sizeof(TENSOR_LABEL), labels.size(), labelFile)
+             != labels.size()))
+    {
+        printf("could not write tensor output %s\n", prefix.c_str());
+        failed = true;
+        return 1;
+    }
+
+    nTensors += labels.size();
+    return 0;
+}
+
+
+/*
+ * Writes everything buffered to the three files.
+ */
+void TENSOR_SINK::flush()
+{
+    lock_guard<mutex> guard(lock);
+
+    if (tensorFile != NULL) fflush(tensorFile);
+    if (labelFile != NULL) fflush(labelFile);
+    if (imageFile != NULL) fflush(imageFile);
+}
+
+
+/*
+ * TENSOR_SINK destructor, finishes the headers and closes the files.
+ */
+TENSOR_SINK::~TENSOR_SINK()
+{
+    closeBinaryTable(tensorFile, nTensors);
+    closeBinaryTable(labelFile, nTensors);
+    if (imageFile != NULL)
+    {
+        fclose(imageFile);
+    }
+}
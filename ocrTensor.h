@@ -0,0 +1,107 @@
+/*
+ * _____________________________________________________________________________
+ * This is the header file for the ocrTensor.cpp program
+ *
+ * Letter tensors are the square bBoxes of the letters resampled to a fixed
+ * N x N grayscale image, for training a classifier without a separate
+ * resize job. With -T <prefix> (and -S N, default 32) a run writes
+ *
+ *      <prefix>.tensors.bin : header + N * N bytes per letter, rows top to
+ *                             bottom, 0 for paper and 255 for ink
+ *      <prefix>.labels.bin  : header + one TENSOR_LABEL per letter, in the
+ *                             same order
+ *      <prefix>.images.txt  : one line per image (page of an image file),
+ *                             "<path>\t<name prefix>\t<page number>"
+ *
+ * The files use the BINARY_HEADER of the binary tables (recordSize is
+ * N * N for the tensors), so a training job can mmap them and read tensor
+ * i at offset 64 + i * N * N. Running again with the same prefix and size
+ * appends.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_TENSOR_H
+#define OCR_TENSOR_H
+
+#include "ocrBinary.h"
+#include "ocrCrop.h"
+
+
+#define TENSOR_MAGIC        "OCRTNS01"
+#define TENSOR_LABEL_MAGIC  "OCRLBL01"
+#define TENSOR_SIZE         32          // default N of -S
+
+
+/*
+ * The label of one letter tensor.
+ */
+struct TENSOR_LABEL
+{
+    uint32_t code;              // the ocr result (LETTER.code)
+    uint32_t imageId;           // line of the image in the image table
+    uint32_t cropId;            // number of the letter's bBox image, or
+                                // BINARY_NO_CROP
+    uint16_t err;               // error of the letter, [0, 255]
+    uint16_t reserved;
+};
+
+static_assert(sizeof(TENSOR_LABEL) == 16, "TENSOR_LABEL must be 16 bytes");
+
+
+/*
+ * TENSOR_SINK writes the tensor, label and image tables of a run.
+ * Pages hand over their tensors with writePage(), in list order.
+ */
+class TENSOR_SINK
+{
+private:
+
+    std::string prefix;
+    int size;                   // N, the tensors are N x N
+    FILE *tensorFile;
+    FILE *labelFile;
+    FILE *imageFile;
+
+    uint64_t nTensors;          // records in the tensor and label tables
+    uint32_t nImages;           // lines in the image table
+    bool failed;
+
+    std::mutex lock;
+
+public:
+    // constructor, opens (or creates) the three files
+    TENSOR_SINK(std::string filePrefix, int tensorSize);
+
+    bool isOpen() { return !failed; }
+    int getSize() { return size; }
+
+    // appends the tensors and labels of one page, returns 0 on success
+    int writePage(std::string imagePath, int pageNumber,
+                  std::string namePrefix, std::vector<BYTE> &tensors,
+                  std::vector<TENSOR_LABEL> &labels);
+
+    // writes everything buffered to the files
+    void flush();
+
+    // destructor, writes the counts into the headers and closes the files
+    ~TENSOR_SINK();
+
+    TENSOR_SINK(const TENSOR_SINK &) = delete;
+    TENSOR_SINK &operator=(const TENSOR_SINK &) = delete;
+};
+
+
+/*
+ * Resamples a crop to size x size bytes by area averaging: every output
+ * pixel is the mean of the crop area it covers. Ink is 255: set bits of
+ * black and white crops, and 255 - gray (or luma) otherwise. The two
+ * passes are separable multiply-adds over contiguous rows, which the
+ * compiler vectorizes. This function returns 0 on success.
+ *
+ * @param crop: the crop to resample
+ * @param size: N, the width and height of the tensor
+ * @param out: size * size bytes
+ */
+extern int resampleCrop(const OCR_CROP &crop, int size, BYTE *out);
+
+#endif
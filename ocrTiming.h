@@ -0,0 +1,83 @@
+/*
+ * _____________________________________________________________________________
+ * Per-stage timing of a page
+ *
+ * A page with a PAGE_TIMES (page.times, NULL by default) adds the time it
+ * spends in each stage of loading, recognizing and exporting to it. The
+ * benchmark uses this to report where the time of a page goes. Without
+ * PAGE_TIMES, a STAGE_TIMER does not even read the clock.
+ * ____________________________________________________________________________
+ */
+
+#ifndef OCR_TIMING_H
+#define OCR_TIMING_H
+
+#include <chrono>
+
+
+enum PAGE_STAGE
+{
+    STAGE_LOAD,                 // kRecLoadImgF
+    STAGE_PREPROCESS,           // kRecPreprocessImg, kRecGetImgInfo
+    STAGE_ZONES,                // kRecLocateZones
+    STAGE_RECOGNIZE,            // kRecRecognize, kRecGetLetters (or cache)
+    STAGE_SEGMENT,              // splitting into words and matching strings,
+                                // the export stage without STAGE_CROPS
+    STAGE_CROPS,                // cutting and writing the bBox images
+    STAGE_WRITE,                // handing the records to the output sinks
+    N_STAGES
+};
+
+
+/*
+ * The seconds a page spent in each stage.
+ */
+struct PAGE_TIMES
+{
+    double seconds[N_STAGES];
+
+    PAGE_TIMES()
+    {
+        for (int s = 0; s < N_STAGES; s++)
+        {
+            seconds[s] = 0;
+        }
+    }
+};
+
+
+/*
+ * Adds the time from its construction to its destruction to one stage.
+ */
+class STAGE_TIMER
+{
+private:
+
+    PAGE_TIMES *times;
+    PAGE_STAGE stage;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    STAGE_TIMER(PAGE_TIMES *pageTimes, PAGE_STAGE pageStage)
+        : times(pageTimes), stage(pageStage)
+    {
+        if (times != NULL)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~STAGE_TIMER()
+    {
+        if (times != NULL)
+        {
+            times->seconds[stage] += std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    STAGE_TIMER(const STAGE_TIMER &) = delete;
+    STAGE_TIMER &operator=(const STAGE_TIMER &) = delete;
+};
+
+#endif